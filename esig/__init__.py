@@ -6,7 +6,11 @@
 #
 
 import functools
+import numbers
+import operator
 import os
+import re
+import warnings
 
 import numpy
 
@@ -25,7 +29,26 @@ try:
 except AttributeError:
     pass
 
-from esig.backends import get_backend, set_backend, list_backends
+from esig.backends import get_backend, set_backend, list_backends, tosig, LibalgebraBackend
+from esig.estimates import estimate
+
+try:
+    from esig.expected_signature import ExpectedSignature
+except ImportError:
+    ExpectedSignature = None
+
+try:
+    from esig.out_of_core import stream2sig_chunked, stream2logsig_chunked
+except ImportError:
+    stream2sig_chunked = stream2logsig_chunked = None
+
+try:
+    from esig import tuning
+    from esig.tuning import tune
+except ImportError:
+    tuning = None
+    def tune(*args, **kwargs):
+        raise NotImplementedError
 
 try:
     from esig.tosig import recombine
@@ -42,11 +65,26 @@ __all__ = [
     "get_library_load_error",
     "stream2sig",
     "stream2logsig",
+    "stream2sig_ragged",
+    "stream2logsig_ragged",
+    "stream2sig_weighted",
+    "weightedsigdim",
+    "weightedsigkeys",
     "logsigdim",
     "sigdim",
     "sigkeys",
     "logsigkeys",
+    "tensorexp",
+    "tensorlog",
+    "tensorinverse",
+    "get_num_threads",
+    "set_num_threads",
+    "ExpectedSignature",
+    "stream2sig_chunked",
+    "stream2logsig_chunked",
     "recombine",
+    "tune",
+    "estimate",
     "get_backend",
     "set_backend",
     "list_backends",
@@ -54,6 +92,19 @@ __all__ = [
 ]
 
 
+# a calibration saved by tune() is loaded for the "auto" backend, which is used
+# only once set_backend("auto") asks for it; a calibration that cannot be read,
+# or is not of the form tune() writes, is ignored with a warning, as if tune()
+# had never been run
+if tuning is not None:
+    try:
+        tuning.load_calibration()
+    except (OSError, ValueError) as exc:
+        tuning.set_calibration(None)
+        warnings.warn("esig: ignoring the calibration at %s: %s"
+                      % (tuning.default_calibration_path(), exc), RuntimeWarning)
+
+
 def get_version():
     """
     Returns the version number of the ESig package.
@@ -138,18 +189,93 @@ def _verify_stream_arg(*types):
     return decorator
 
 
+# a key of the signature in the notation of sigkeys, spaces allowed within it
+_SIG_KEY = re.compile(r"\(([\d,\s]*)\)")
+
+
+def _sig_key_indices(keys, dimension, depth):
+    """
+    The positions in the output of stream2sig of keys, each a word either in
+    the notation of sigkeys, such as "(1,2)", or as a sequence of its letters,
+    such as [1, 2], counted from 1 as there; a single string may hold several
+    keys, as the output of sigkeys does, and a 2 dimensional array a word per row
+    """
+    if isinstance(keys, str):
+        if _SIG_KEY.sub("", keys).strip():
+            raise ValueError("%r is not a list of keys in the notation of sigkeys" % keys)
+        keys = _SIG_KEY.findall(keys)
+    ans = []
+    for key in keys:
+        if isinstance(key, str):
+            letters = key.strip().strip("()").strip()
+            word = [int(letter) for letter in letters.split(",")] if letters else []
+        elif isinstance(key, numbers.Integral):
+            raise TypeError("a key is a word, not the integer %r; "
+                            "pass positions in the signature as indices" % (key,))
+        else:
+            word = [operator.index(letter) for letter in key]
+        if len(word) > depth or any(letter < 1 or letter > dimension for letter in word):
+            raise ValueError("%s is not a key of the signature of a stream of dimension "
+                             "%d to depth %d" % (key, dimension, depth))
+        position = 0
+        for letter in word:
+            position = position * dimension + letter - 1
+        ans.append(sum(dimension ** k for k in range(len(word))) + position)
+    return numpy.asarray(ans, dtype=numpy.intp)
+
+
+def _sig_indices(indices, dimension, depth):
+    """
+    The integer positions indices in the output of stream2sig, checked
+    """
+    size = sum(dimension ** k for k in range(depth + 1))
+    ans = []
+    for index in indices:
+        index = operator.index(index)
+        if not 0 <= index < size:
+            raise IndexError("signature index %d out of range" % index)
+        ans.append(index)
+    return numpy.asarray(ans, dtype=numpy.intp)
+
+
 @_verify_stream_arg
-def stream2sig(stream, depth):
+def stream2sig(stream, depth, num_threads=1, min_chunk_rows=None, keys=None, indices=None):
     """
     Compute the signature of a stream
+
+    Unless num_threads is 1, a long stream is split into chunks of at least
+    min_chunk_rows increments whose signatures are computed in parallel, on
+    up to num_threads threads (0 uses get_num_threads()), and multiplied together.
+    Only the libalgebra backend splits streams; the others ignore these.
+
+    If keys is given, only the coordinates of the words it names are
+    returned, in its order: keys is a list of words, each a key in the
+    notation of sigkeys, such as "(1,2)", or a sequence or array of its
+    letters, such as [1, 2], a string holding several keys, or a 2
+    dimensional integer array with a word per row. Likewise indices, instead
+    of keys, gives the coordinates by their integer positions in the full
+    signature. The libalgebra backend computes just those coordinates and the
+    ones of the prefixes of their words, so the cost grows with the number
+    asked for and not with the depth.
     """
     if depth <= 0:
         raise ValueError("Depth must be at least 1")
+    if keys is not None and indices is not None:
+        raise ValueError("give the coordinates as keys or as indices, not both")
+    if keys is not None:
+        indices = _sig_key_indices(keys, stream.shape[-1], depth)
+    elif indices is not None:
+        indices = _sig_indices(indices, stream.shape[-1], depth)
+    if indices is not None:
+        return get_backend().compute_signature_subset(stream, depth, indices)
     elif depth == 1:
         return numpy.concatenate([[1.0], numpy.sum(numpy.diff(stream, axis=0), axis=0)])
 
     backend = get_backend()
-    return backend.compute_signature(stream, depth)
+    if num_threads == 1 or not isinstance(backend, LibalgebraBackend):
+        return backend.compute_signature(stream, depth)
+    return backend.compute_signature(stream, depth, num_threads=num_threads,
+                                     min_chunk_rows=min_chunk_rows)
 
 
 @_verify_stream_arg
@@ -166,6 +292,78 @@ def stream2logsig(stream, depth):
     return backend.compute_log_signature(stream, depth)
 
 
+def _ragged_increments(data, offsets):
+    """
+    The total increment of each segment of a ragged batch, zero for empty segments
+    """
+    starts, ends = offsets[:-1], offsets[1:]
+    ans = numpy.zeros((len(starts), data.shape[1]), dtype=numpy.float64)
+    nonempty = ends > starts
+    ans[nonempty] = data[ends[nonempty] - 1] - data[starts[nonempty]]
+    return ans
+
+
+def stream2sig_ragged(data, offsets, depth, num_threads=0):
+    """
+    Compute the signatures of a batch of streams of different lengths
+
+    The streams are stored one after another in the rows of data, stream i
+    being data[offsets[i]:offsets[i + 1]]. Returns an array with a row per
+    stream, computed natively on num_threads threads (0 uses get_num_threads()).
+    """
+    data = numpy.asarray(data, dtype=numpy.float64)
+    offsets = numpy.asarray(offsets, dtype=numpy.intp)
+    if depth <= 0:
+        raise ValueError("Depth must be at least 1")
+    elif depth == 1:
+        increments = _ragged_increments(data, offsets)
+        return numpy.concatenate([numpy.ones((len(increments), 1)), increments], axis=1)
+    return tosig.stream2sig_ragged(data, offsets, depth, num_threads=num_threads)
+
+
+def stream2logsig_ragged(data, offsets, depth, num_threads=0):
+    """
+    Compute the log signatures of a batch of streams of different lengths,
+    stored as for stream2sig_ragged
+    """
+    data = numpy.asarray(data, dtype=numpy.float64)
+    offsets = numpy.asarray(offsets, dtype=numpy.intp)
+    if depth <= 0:
+        raise ValueError("Depth must be at least 1")
+    elif depth == 1:
+        return _ragged_increments(data, offsets)
+    return tosig.stream2logsig_ragged(data, offsets, depth, num_threads=num_threads)
+
+
+def stream2sig_weighted(stream, weights, budget):
+    """
+    Compute the signature of a stream truncated by weighted length
+
+    Channel i has the positive integer weight weights[i] and a word is kept
+    while the weights of its letters add up to at most budget, so heavy
+    channels such as volume or time appear only in short words while light
+    ones go deep. The coordinates are those of the full signature with the
+    other words left out, in the same order, and weightedsigkeys lists them.
+    """
+    stream = numpy.asarray(stream, dtype=numpy.float64)
+    return tosig.stream2sig_weighted(stream, numpy.asarray(weights, dtype=numpy.intp), budget)
+
+
+def weightedsigdim(weights, budget):
+    """
+    Get the number of elements in the signature truncated by weighted length
+    """
+    return tosig.weightedsigdim(numpy.asarray(weights, dtype=numpy.intp), budget)
+
+
+def weightedsigkeys(weights, budget):
+    """
+    Get the keys that correspond to the elements in the signature truncated
+    by weighted length
+    """
+    return tosig.weightedsigkeys(numpy.asarray(weights, dtype=numpy.intp), budget)
+
+
 def logsigdim(dimension, depth):
     """
     Get the number of elements in the log signature
@@ -200,3 +398,47 @@ def sigkeys(dimension, depth):
     Get the keys that correspond to the elements in the signature
     """
     return get_backend().sig_keys(dimension, depth)
+
+
+def tensorexp(tensors, dimension, depth):
+    """
+    Compute the truncated exponential of each tensor along the last axis of
+    an array, the tensors being flattened as in the output of stream2sig
+    """
+    return tosig.tensorexp(numpy.asarray(tensors, dtype=numpy.float64), dimension, depth)
+
+
+def tensorlog(tensors, dimension, depth):
+    """
+    Compute the truncated logarithm of each tensor along the last axis of
+    an array, the tensors being flattened as in the output of stream2sig
+    """
+    return tosig.tensorlog(numpy.asarray(tensors, dtype=numpy.float64), dimension, depth)
+
+
+def tensorinverse(tensors, dimension, depth):
+    """
+    Compute the truncated inverse of each tensor along the last axis of an
+    array, the tensors being flattened as in the output of stream2sig. The
+    inverse of a signature is the signature of the reversed path.
+    """
+    return tosig.tensorinverse(numpy.asarray(tensors, dtype=numpy.float64), dimension, depth)
+
+
+def get_num_threads():
+    """
+    Get the number of threads of the native pool shared by every parallel
+    computation in esig, used wherever num_threads is 0
+    """
+    return tosig.get_num_threads()
+
+
+def set_num_threads(num_threads=0):
+    """
+    Set the number of threads of the native pool shared by every parallel
+    computation in esig. 0 restores the default: the environment variable
+    ESIG_NUM_THREADS if it is set, and otherwise the cores this process may
+    run on, capped by the cpu quota of its cgroup. The pool is created on
+    first use and again in a child process after a fork.
+    """
+    tosig.set_num_threads(num_threads)
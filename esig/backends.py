@@ -74,6 +74,14 @@ class BackendBase(abc.ABC):
         Compute the signature of the stream to required depth
         """
 
+    def compute_signature_subset(self, stream, depth, indices):
+        """
+        Compute the coordinates of the signature of the stream at the given
+        positions in the flattened signature; by default the whole
+        signature is computed and indexed
+        """
+        return self.compute_signature(stream, depth)[indices]
+
     @abc.abstractmethod
     def compute_log_signature(self, stream, depth):
         """
@@ -114,8 +122,14 @@ class LibalgebraBackend(BackendBase):
     def __repr__(self):
         return "LibalgebraBackend"
 
-    def compute_signature(self, stream, depth):
-        return tosig.stream2sig(stream, depth)
+    def compute_signature(self, stream, depth, num_threads=1, min_chunk_rows=None):
+        if min_chunk_rows is None:
+            return tosig.stream2sig(stream, depth, num_threads=num_threads)
+        return tosig.stream2sig(stream, depth, num_threads=num_threads,
+                                min_chunk_rows=min_chunk_rows)
+
+    def compute_signature_subset(self, stream, depth, indices):
+        return tosig.stream2sig_subset(stream, depth, indices)
 
     def compute_log_signature(self, stream, depth):
         return tosig.stream2logsig(stream, depth)
@@ -0,0 +1,289 @@
+# Timing the registered backends against each other on synthetic streams
+#
+#   python -m esig.bench --widths 2,3,5 --depths 2,3 --lengths 100,1000 --output results.json
+
+import argparse
+import json
+import platform
+import sys
+import threading
+import time
+
+import numpy
+
+from esig import backends
+
+
+DEFAULT_WIDTHS = (2, 3, 5)
+DEFAULT_DEPTHS = (2, 3, 4)
+DEFAULT_LENGTHS = (100, 1000)
+DEFAULT_BATCH_SIZES = (1, 32)
+KINDS = ("sig", "logsig")
+
+
+def _make_backend(backend):
+    """
+    A backend instance from a name in backends.BACKENDS, a subclass of
+    BackendBase or an instance of one
+    """
+    if isinstance(backend, str):
+        if backend not in backends.BACKENDS:
+            raise ValueError("%s does not name a valid backend" % backend)
+        return backends.BACKENDS[backend]()
+    if isinstance(backend, backends.BackendBase):
+        return backend
+    if isinstance(backend, type) and issubclass(backend, backends.BackendBase):
+        return backend()
+    raise TypeError("Backend must be a subclass of the BackendBase class or str")
+
+
+def make_streams(width, length, batch_size, seed=0):
+    """
+    batch_size random walks of length rows and width columns, their steps
+    scaled so that the walks stay of order one whatever their length
+    """
+    rng = numpy.random.RandomState(seed)
+    steps = rng.normal(scale=1.0 / numpy.sqrt(length), size=(batch_size, length, width))
+    return numpy.cumsum(steps, axis=1)
+
+
+def _compute(backend, kind, streams, depth):
+    if kind == "sig":
+        return [backend.compute_signature(stream, depth) for stream in streams]
+    return [backend.compute_log_signature(stream, depth) for stream in streams]
+
+
+def _first_call(backend, kind, streams, depth):
+    """
+    The answers of the untimed first call of a case, made on a thread of its
+    own, whose arena starts empty, so that the memory it takes does not
+    depend on the cases before it
+    """
+    result = {}
+
+    def call():
+        try:
+            result["answers"] = _compute(backend, kind, streams, depth)
+        except Exception as exc:
+            result["error"] = exc
+
+    thread = threading.Thread(target=call)
+    thread.start()
+    thread.join()
+    if "error" in result:
+        raise result["error"]
+    return result["answers"]
+
+
+def _time_case(backend, kind, streams, depth, min_time, min_repeats):
+    """
+    Compute the batch repeatedly for at least min_time seconds and
+    min_repeats times, after one untimed call on a fresh thread
+    @return the answers of the untimed call, the heap memory tosig took for
+    it and the time of each repeat
+    """
+    tosig = backends.tosig
+    if tosig is not None and hasattr(tosig, "reset_memory_stats"):
+        tosig.reset_memory_stats()
+    answers = _first_call(backend, kind, streams, depth)
+    memory = _memory_stats(kind)
+    times = []
+    while len(times) < min_repeats or sum(times) < min_time:
+        start = time.perf_counter()
+        _compute(backend, kind, streams, depth)
+        times.append(time.perf_counter() - start)
+    return answers, memory, times
+
+
+def _memory_stats(kind):
+    """
+    The heap memory taken by tosig since the last reset, in total and by the
+    calls of the entry point of kind, or None without it
+    """
+    tosig = backends.tosig
+    if tosig is None or not hasattr(tosig, "get_memory_stats"):
+        return None
+    stats = tosig.get_memory_stats()
+    calls = stats["calls"]["signature" if kind == "sig" else "log_signature"]
+    return {
+        "allocations": stats["allocations"],
+        "bytes_allocated": stats["bytes_allocated"],
+        "peak_bytes_in_use": stats["peak_bytes_in_use"],
+        "calls": calls["calls"],
+        "peak_bytes_per_call": calls["peak_bytes_in_use"],
+    }
+
+
+def _process_peak_rss_bytes():
+    # the peak resident memory of the process over its lifetime, not that of any case
+    tosig = backends.tosig
+    if tosig is None or not hasattr(tosig, "get_memory_stats"):
+        return None
+    return tosig.get_memory_stats()["peak_rss_bytes"]
+
+
+def _keys(backend, kind, width, depth):
+    try:
+        if kind == "sig":
+            return backend.sig_keys(width, depth)
+        return backend.log_sig_keys(width, depth)
+    except Exception:
+        return None
+
+
+def _compare(reference, answers, rtol, atol):
+    """
+    Whether two lists of answers agree to the tolerances, and the largest
+    absolute difference between them
+    """
+    if any(numpy.shape(a) != numpy.shape(b) for a, b in zip(reference, answers)):
+        return False, None
+    difference = max(float(numpy.max(numpy.abs(numpy.asarray(a) - numpy.asarray(b))))
+                     if numpy.size(a) else 0.0 for a, b in zip(reference, answers))
+    agrees = all(numpy.allclose(a, b, rtol=rtol, atol=atol) for a, b in zip(reference, answers))
+    return agrees, difference
+
+
+def run(widths=DEFAULT_WIDTHS, depths=DEFAULT_DEPTHS, lengths=DEFAULT_LENGTHS,
+        batch_sizes=DEFAULT_BATCH_SIZES, kinds=KINDS, backend_list=None,
+        min_time=0.2, min_repeats=3, rtol=1e-7, atol=1e-9, seed=0, log=None):
+    """
+    Time every backend on every combination of width, depth, stream length,
+    batch size and kind of answer, checking that each backend agrees with
+    the first.
+
+    Args:
+        widths, depths, lengths, batch_sizes: the grid of the benchmark
+        kinds: "sig" for signatures, "logsig" for log signatures
+        backend_list: names, classes or instances of backends, by default
+            every registered one; the first is the reference for agreement
+        min_time (float): the least time in seconds spent timing each case
+        min_repeats (int): the fewest timed calls of each case
+        rtol, atol (float): the tolerances of the agreement check
+        seed (int): the seed of the random walks
+        log: a file receiving a line per case as it is timed, or None
+
+    Returns:
+        a dict, ready for json, of the environment and a list of cases, each
+        holding the seconds per batch and per stream, the rows and streams
+        per second, the heap memory tosig took for the first, untimed, batch
+        of the case under "memory", made on a fresh thread so that it does not
+        depend on the cases before, with the most any one call held at once
+        (zero for backends that do not call it), and whether it agrees with the reference backend; and
+        the peak resident memory of the process over the whole run. Log
+        signatures are only compared when both backends use the same keys,
+        otherwise "agrees" is None. A backend that cannot compute a case has
+        "error" set instead of timings.
+    """
+    for kind in kinds:
+        if kind not in KINDS:
+            raise ValueError("kind must be one of %s, not %r" % (KINDS, kind))
+    if backend_list is None:
+        backend_list = backends.list_backends()
+    instances = [(backend, _make_backend(backend)) for backend in backend_list]
+    names = [b if isinstance(b, str) else repr(instance) for b, instance in instances]
+
+    cases = []
+    for width in widths:
+        for depth in depths:
+            for length in lengths:
+                for batch_size in batch_sizes:
+                    streams = make_streams(width, length, batch_size, seed)
+                    for kind in kinds:
+                        reference = reference_keys = None
+                        for name, (_, backend) in zip(names, instances):
+                            case = {
+                                "backend": name, "kind": kind, "width": width, "depth": depth,
+                                "length": length, "batch_size": batch_size,
+                            }
+                            try:
+                                answers, memory, times = _time_case(backend, kind, streams, depth,
+                                                            min_time, min_repeats)
+                            except Exception as exc:
+                                case["error"] = "%s: %s" % (type(exc).__name__, exc)
+                                cases.append(case)
+                                continue
+                            best = min(times)
+                            case.update({
+                                "repeats": len(times),
+                                "seconds_per_batch": {
+                                    "min": best,
+                                    "median": float(numpy.median(times)),
+                                    "max": max(times),
+                                },
+                                "seconds_per_stream": best / batch_size,
+                                "streams_per_second": batch_size / best,
+                                "rows_per_second": batch_size * length / best,
+                                "memory": memory,
+                            })
+                            keys = _keys(backend, kind, width, depth)
+                            if reference is None:
+                                reference, reference_keys = answers, keys
+                                case["agrees"], case["max_abs_difference"] = True, 0.0
+                            elif kind == "logsig" and keys != reference_keys:
+                                case["agrees"], case["max_abs_difference"] = None, None
+                            else:
+                                case["agrees"], case["max_abs_difference"] = _compare(
+                                    reference, answers, rtol, atol)
+                            cases.append(case)
+                            if log is not None:
+                                log.write("%-24s %-6s width %2d depth %2d length %6d batch %4d: "
+                                          "%10.1f streams/s%s\n" % (
+                                              name, kind, width, depth, length, batch_size,
+                                              case["streams_per_second"],
+                                              "" if case["agrees"] is not False else "  DISAGREES"))
+
+    return {
+        "backends": names,
+        "python": platform.python_version(),
+        "numpy": numpy.__version__,
+        "machine": platform.machine(),
+        "system": platform.system(),
+        "kernels": backends.tosig.get_kernels() if backends.tosig is not None else None,
+        "min_time": min_time,
+        "rtol": rtol,
+        "atol": atol,
+        "process_peak_rss_bytes": _process_peak_rss_bytes(),
+        "cases": cases,
+    }
+
+
+def _int_list(text):
+    return tuple(int(item) for item in text.split(",") if item)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        prog="python -m esig.bench",
+        description="Time the esig backends against each other on random walks")
+    parser.add_argument("--widths", type=_int_list, default=DEFAULT_WIDTHS)
+    parser.add_argument("--depths", type=_int_list, default=DEFAULT_DEPTHS)
+    parser.add_argument("--lengths", type=_int_list, default=DEFAULT_LENGTHS)
+    parser.add_argument("--batch-sizes", type=_int_list, default=DEFAULT_BATCH_SIZES)
+    parser.add_argument("--kinds", default=",".join(KINDS),
+                        help="sig, logsig or both, comma separated")
+    parser.add_argument("--backends", default=None,
+                        help="comma separated names, the first being the reference "
+                             "(default %s)" % ",".join(backends.list_backends()))
+    parser.add_argument("--min-time", type=float, default=0.2,
+                        help="the least time in seconds spent on each case")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", default=None,
+                        help="write the JSON results to this file rather than stdout")
+    args = parser.parse_args(argv)
+
+    backend_list = args.backends.split(",") if args.backends else None
+    results = run(args.widths, args.depths, args.lengths, args.batch_sizes,
+                  kinds=tuple(args.kinds.split(",")), backend_list=backend_list,
+                  min_time=args.min_time, seed=args.seed, log=sys.stderr)
+    if args.output is None:
+        json.dump(results, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+    else:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    return 1 if any(case.get("agrees") is False for case in results["cases"]) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,203 @@
+# What a computation will cost, from closed forms, before running it
+#
+#   esig.estimate(width=2, depth=16, length=10000, kind="sig")
+
+import math
+
+
+KINDS = ("sig", "logsig", "recombine")
+
+# the arenas of scratch space are allocated in blocks of at least this many bytes
+ARENA_BLOCK_BYTES = 1 << 16
+
+DOUBLE_BYTES = 8
+INDEX_BYTES = 8
+
+
+def _mobius(n):
+    """
+    The Mobius function of a positive integer
+    """
+    ans = 1
+    p = 2
+    while p * p <= n:
+        if n % p == 0:
+            n //= p
+            if n % p == 0:
+                return 0
+            ans = -ans
+        p += 1
+    return -ans if n > 1 else ans
+
+
+def lie_level_size(width, k):
+    """
+    The number of Hall basis elements of degree k in width letters, by the Witt formula
+    (1/k) sum over d dividing k of mu(d) width^(k/d)
+    """
+    return sum(_mobius(d) * width ** (k // d) for d in range(1, k + 1) if k % d == 0) // k
+
+
+def sig_size(width, depth):
+    """
+    The number of coordinates of the signature, the scalar term included, as sigdim
+    """
+    return sum(width ** k for k in range(depth + 1))
+
+
+def log_sig_size(width, depth):
+    """
+    The number of coordinates of the log signature, as logsigdim
+    """
+    return sum(lie_level_size(width, k) for k in range(1, depth + 1))
+
+
+def monomial_count(dimension, degree):
+    """
+    The number of monomials of degree at most degree in dimension variables,
+    as EvaluateAllMonomials::F: the size of the vectors recombine reduces
+    """
+    return math.factorial(dimension + degree) // (math.factorial(dimension) * math.factorial(degree))
+
+
+def _mul_flops(width, max_level):
+    # dense::mul_inplace: a scaling of each level k and k outer products into it
+    return sum((1 + 2 * k) * width ** k for k in range(max_level + 1))
+
+
+def _mul_exp_flops(width, depth):
+    # dense::mul_exp_inplace, the Chen update for one increment, by Horner's rule on each level
+    ans = 2 * width
+    for m in range(2, depth + 1):
+        ans += width
+        ans += sum(2 * width ** i + width ** (i + 1) for i in range(1, m - 1))
+        ans += 2 * width ** (m - 1) + 2 * width ** m
+    return ans
+
+
+def _log_flops(width, depth):
+    # dense::log, Horner's rule on the nilpotent part
+    size = sig_size(width, depth)
+    return size + sum(_mul_flops(width, depth - j) for j in range(1, depth)) + _mul_flops(width, depth)
+
+
+def _word_nonzeros(width, k):
+    # a word of degree k maps onto the Hall elements with its letters; a right normed
+    # bracket of k letters expands into at most (k - 1)! of them, the dimension of the
+    # multilinear part of degree k, a bound that is only reached for small k
+    return min(lie_level_size(width, k), math.factorial(k - 1)) if k > 0 else 0
+
+
+def _projection_nonzeros(width, depth):
+    return sum(width ** k * _word_nonzeros(width, k) for k in range(1, depth + 1))
+
+
+def _projection_setup_flops(width, depth):
+    # maps::t2l on each word of the tensor basis: the right normed bracket of a word of
+    # degree k is its first letter bracketed with that of the rest, each of whose Hall
+    # elements expands into those of degree k, and is then divided by k
+    return sum(width ** k * (2 * _word_nonzeros(width, k - 1) + 1) * _word_nonzeros(width, k)
+               for k in range(1, depth + 1))
+
+
+def _arena_bytes(temporaries):
+    # the arena of a thread grows in blocks of at least ARENA_BLOCK_BYTES, each aligned
+    # allocation taking up to 64 bytes of padding
+    needed = sum(DOUBLE_BYTES * n + 64 for n in temporaries)
+    return max(needed, ARENA_BLOCK_BYTES)
+
+
+def _signature_estimate(width, depth, length):
+    size = sig_size(width, depth)
+    increments = max(length - 1, 0)
+    scratch = 2 * width ** (depth - 1) + width
+    return {
+        "output_size": size,
+        "flops": increments * (width + _mul_exp_flops(width, depth)),
+        "input_bytes": DOUBLE_BYTES * length * width,
+        "output_bytes": DOUBLE_BYTES * size,
+        "scratch_bytes": _arena_bytes([scratch, width]),
+        "table_bytes": 0,
+        "setup_flops": 0,
+    }
+
+
+def _log_signature_estimate(width, depth, length):
+    ans = _signature_estimate(width, depth, length)
+    size = sig_size(width, depth)
+    nonzeros = _projection_nonzeros(width, depth)
+    output_size = log_sig_size(width, depth)
+    # the signature, its logarithm and the nilpotent part log works on, beside the
+    # scratch of the signature, and the projection onto the Hall basis, tabulated once
+    # for each width and depth and kept
+    ans.update({
+        "output_size": output_size,
+        "flops": ans["flops"] + _log_flops(width, depth) + 2 * nonzeros,
+        "output_bytes": DOUBLE_BYTES * output_size,
+        "scratch_bytes": _arena_bytes([size, size, size, 2 * width ** (depth - 1) + width, width]),
+        "table_bytes": (DOUBLE_BYTES + INDEX_BYTES) * nonzeros + INDEX_BYTES * (size + 1),
+        "setup_flops": _projection_setup_flops(width, depth),
+    })
+    return ans
+
+
+def _recombine_estimate(dimension, degree, points):
+    monomials = monomial_count(dimension, degree)
+    # the expansion of the points into their monomials and the reduction, whose cost
+    # grows as monomials * points + monomials^3 * log(points / monomials)
+    reductions = math.log2(points / monomials) if points > monomials else 0.0
+    return {
+        "output_size": monomials,
+        "flops": int(points * (monomials + 4 * dimension) + monomials ** 3 * reductions),
+        "input_bytes": DOUBLE_BYTES * points * (dimension + 1),
+        "output_bytes": (INDEX_BYTES + DOUBLE_BYTES) * monomials,
+        "scratch_bytes": INDEX_BYTES * points + DOUBLE_BYTES * (points * monomials + 4 * monomials ** 2),
+        "table_bytes": 0,
+        "setup_flops": 0,
+    }
+
+
+def estimate(width, depth, length, kind="sig"):
+    """
+    Estimate the size of the answer, the memory and the floating point
+    operations of a computation before running it, from closed forms and
+    without building any basis. The estimates are for one stream computed
+    on one thread, with every increment dense, and are upper bounds where
+    the count depends on the data, as for sparse increments.
+
+    Args:
+        width (int): the width of the stream, or the dimension of the points for recombine
+        depth (int): the depth of the signature, or the degree of the cubature for recombine
+        length (int): the rows of the stream, or the number of points for recombine
+        kind (str): "sig", "logsig" or "recombine"
+
+    Returns:
+        a dict of
+            output_size: the coordinates of the answer, at most the points kept by recombine
+            output_bytes: the bytes of the answer
+            input_bytes: the bytes of the input as float64
+            scratch_bytes: the bytes of the temporaries, the arena of a thread rounded up
+                to its smallest block
+            table_bytes: the bytes of the tables kept for each width and depth after the
+                first call, the projection onto the Hall basis of log signatures
+            peak_bytes: the sum of the above, what a first call needs at once
+            flops: the floating point operations of each call, a multiply and add
+                counting two
+            setup_flops: the floating point operations of the first call for each width
+                and depth on top of flops, in tabulating the projection onto the Hall
+                basis from t2l of every word of the signature
+    """
+    if kind not in KINDS:
+        raise ValueError("kind must be one of %s, not %r" % (KINDS, kind))
+    if width < 1 or depth < 1 or length < 0:
+        raise ValueError("width and depth must be at least 1 and length at least 0")
+    if kind == "sig":
+        ans = _signature_estimate(width, depth, length)
+    elif kind == "logsig":
+        ans = _log_signature_estimate(width, depth, length)
+    else:
+        ans = _recombine_estimate(width, depth, length)
+    ans["peak_bytes"] = (ans["input_bytes"] + ans["output_bytes"] + ans["scratch_bytes"]
+                         + ans["table_bytes"])
+    ans.update({"kind": kind, "width": width, "depth": depth, "length": length})
+    return ans
@@ -0,0 +1,94 @@
+# Streaming estimator of the expected signature of a family of streams
+
+import numpy
+
+from esig import tosig
+
+
+class ExpectedSignature(object):
+    """
+    Running estimate of the expected signature of a family of streams.
+
+    Streams are consumed in batches with `update`; the signatures of each
+    batch are computed natively and folded into one accumulator per thread,
+    so the memory used is proportional to the size of the signature and the
+    number of threads, not the number of streams consumed.
+
+    Args:
+        dimension (int): the width of the streams
+        depth (int): the depth of the signatures
+        second_moment (bool): also accumulate the sum of squared deviations
+            of each coordinate, giving access to `variance`
+        num_threads (int): number of threads used per batch, 0 uses esig.get_num_threads()
+    """
+
+    def __init__(self, dimension, depth, second_moment=False, num_threads=0):
+        self.dimension = dimension
+        self.depth = depth
+        self.num_threads = num_threads
+        size = tosig.sigdim(dimension, depth)
+        self._count = 0
+        self._mean = numpy.zeros(size, dtype=numpy.float64)
+        self._m2 = numpy.zeros(size, dtype=numpy.float64) if second_moment else None
+
+    def __repr__(self):
+        return "ExpectedSignature(dimension={}, depth={}, count={})".format(
+            self.dimension, self.depth, self._count
+        )
+
+    def update(self, streams):
+        """
+        Fold a batch of streams into the estimate. The batch is either a 3
+        dimensional array (no_streams x no_of_ticks x dimension) or a sequence
+        of 2 dimensional arrays, possibly of different lengths.
+        """
+        if isinstance(streams, numpy.ndarray) and streams.ndim == 2:
+            streams = streams[numpy.newaxis]
+        self._count = tosig.accumulatesig(
+            streams, self.depth, self._count, self._mean, self._m2,
+            num_threads=self.num_threads
+        )
+        return self
+
+    def merge(self, other):
+        """
+        Fold the estimate held by another ExpectedSignature into this one.
+        """
+        if (other.dimension, other.depth) != (self.dimension, self.depth):
+            raise ValueError("Cannot merge estimates of different shapes")
+        if other._count == 0:
+            return self
+        total = self._count + other._count
+        delta = other._mean - self._mean
+        if self._m2 is not None:
+            if other._m2 is None:
+                raise ValueError("Cannot merge an estimate without second moments")
+            self._m2 += other._m2 + delta * delta * (self._count * other._count / total)
+        self._mean += delta * (other._count / total)
+        self._count = total
+        return self
+
+    @property
+    def count(self):
+        """
+        The number of streams consumed so far
+        """
+        return self._count
+
+    @property
+    def mean(self):
+        """
+        The running mean of the signatures
+        """
+        return self._mean.copy()
+
+    @property
+    def variance(self):
+        """
+        The unbiased sample variance of each coordinate of the signature
+        """
+        if self._m2 is None:
+            raise ValueError("Second moments were not requested")
+        if self._count < 2:
+            return numpy.full_like(self._m2, numpy.nan)
+        return self._m2 / (self._count - 1)
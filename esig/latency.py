@@ -0,0 +1,54 @@
+# Percentiles of the time taken by the calls of tosig, from its latency histograms
+#
+#   tosig.set_latency_recording()
+#   ...
+#   esig.latency.percentiles((50, 99, 99.9))
+#       # {("signature", 2, 4): array([1.2e-05, 3.1e-05, 4.0e-05]), ...}
+
+import numpy
+
+from esig.backends import tosig
+
+
+DEFAULT_PERCENTILES = (50.0, 90.0, 99.0, 99.9)
+
+
+def snapshot():
+    """
+    The histograms of tosig.get_latency_histograms(): a dict of "bounds",
+    the edges of the buckets in seconds, and "histograms", by entry point,
+    width and depth
+    """
+    return tosig.get_latency_histograms()
+
+
+def percentiles(q=DEFAULT_PERCENTILES, histograms=None):
+    """
+    The percentiles q of the time of the calls of each entry point and shape.
+    As in an HDR histogram, each is the upper edge of the bucket holding it, so
+    within 1/64 above the true value, and never above the slowest call.
+
+    Args:
+        q: the percentiles, between 0 and 100
+        histograms: a snapshot(), by default taken now
+
+    Returns:
+        a dict from (entry, width, depth) to a numpy array of seconds, one per percentile
+    """
+    if histograms is None:
+        histograms = snapshot()
+    q = numpy.asarray(q, dtype=numpy.float64)
+    if numpy.any((q < 0.0) | (q > 100.0)):
+        raise ValueError("percentiles must be between 0 and 100")
+    upper = histograms["bounds"][1:]
+    ans = {}
+    for key, histogram in histograms["histograms"].items():
+        cumulative = numpy.cumsum(histogram["counts"])
+        calls = cumulative[-1]
+        if calls == 0:
+            continue
+        # the rank of each percentile, counting from one
+        ranks = numpy.maximum(numpy.ceil(q / 100.0 * calls), 1)
+        buckets = numpy.searchsorted(cumulative, ranks, side="left")
+        ans[key] = numpy.minimum(upper[buckets], histogram["max_seconds"])
+    return ans
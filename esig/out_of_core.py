@@ -0,0 +1,103 @@
+# Signatures of streams too large to hold in memory, read in bounded pieces
+
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy
+
+from esig import tosig
+
+
+DEFAULT_CHUNK_ROWS = 1 << 18
+
+
+def _open_stream(source):
+    """
+    Memory map a path to a .npy file; anything else is used as it is
+    """
+    if isinstance(source, (str, bytes, os.PathLike)):
+        source = numpy.load(source, mmap_mode="r")
+    if source.ndim != 2:
+        raise ValueError("The stream must have two dimensions")
+    return source
+
+
+def _read_rows(stream, start, stop):
+    # copying a slice of a memory map is what reads it from disk
+    return numpy.ascontiguousarray(stream[start:stop], dtype=numpy.float64)
+
+
+def iter_chunks(source, chunk_rows=DEFAULT_CHUNK_ROWS, read_ahead=True):
+    """
+    Iterate over the rows of a stream in contiguous float64 blocks of at
+    most chunk_rows rows. With read_ahead the next block is read on a
+    background thread while the caller works on the current one, so at
+    most two blocks are held in memory.
+
+    Args:
+        source: a path to a .npy file, a numpy.memmap or any 2 dimensional array
+        chunk_rows (int): the number of rows read at a time
+        read_ahead (bool): overlap reading the next block with the caller
+    """
+    if chunk_rows < 1:
+        raise ValueError("chunk_rows must be at least 1")
+    stream = _open_stream(source)
+    rows = stream.shape[0]
+    starts = range(0, rows, chunk_rows)
+    if not read_ahead:
+        for start in starts:
+            yield _read_rows(stream, start, start + chunk_rows)
+        return
+
+    with ThreadPoolExecutor(max_workers=1) as reader:
+        pending = reader.submit(_read_rows, stream, 0, chunk_rows)
+        for start in starts:
+            current = pending.result()
+            following = start + chunk_rows
+            if following < rows:
+                pending = reader.submit(_read_rows, stream, following, following + chunk_rows)
+            yield current
+
+
+def stream2sig_chunked(source, depth, chunk_rows=DEFAULT_CHUNK_ROWS, read_ahead=True):
+    """
+    Compute the signature of a stream held in a .npy file or memory map,
+    reading chunk_rows rows at a time and updating the signature as each
+    block arrives, so the memory used does not depend on the length of
+    the stream. The answer is that of stream2sig.
+
+    Args:
+        source: a path to a .npy file, a numpy.memmap or any 2 dimensional array
+        depth (int): the depth of the signature
+        chunk_rows (int): the number of rows read at a time
+        read_ahead (bool): read the next block while the current one is processed
+    """
+    if depth <= 0:
+        raise ValueError("Depth must be at least 1")
+    stream = _open_stream(source)
+    rows, width = stream.shape
+    if depth == 1:
+        if rows == 0:
+            return numpy.concatenate([[1.0], numpy.zeros(width)])
+        return numpy.concatenate([[1.0], _read_rows(stream, rows - 1, rows)[0] - _read_rows(stream, 0, 1)[0]])
+
+    sig = numpy.zeros(tosig.sigdim(width, depth), dtype=numpy.float64)
+    sig[0] = 1.0
+    previous = None
+    for chunk in iter_chunks(stream, chunk_rows, read_ahead):
+        tosig.extendsig(sig, chunk, depth, previous)
+        previous = chunk[-1]
+    return sig
+
+
+def stream2logsig_chunked(source, depth, chunk_rows=DEFAULT_CHUNK_ROWS, read_ahead=True):
+    """
+    Compute the log signature of a stream held in a .npy file or memory
+    map in bounded memory, as stream2sig_chunked does for the signature.
+    The answer is that of stream2logsig.
+    """
+    stream = _open_stream(source)
+    sig = stream2sig_chunked(stream, depth, chunk_rows, read_ahead)
+    if depth == 1:
+        return sig[1:]
+    return tosig.sig2logsig(sig, stream.shape[1], depth)
@@ -0,0 +1,65 @@
+import json
+import unittest
+
+import numpy as np
+
+from esig import bench
+from esig.backends import LibalgebraBackend
+
+
+class ScaledBackend(LibalgebraBackend):
+    # a backend that gets the signature wrong, for the agreement check to catch
+
+    def __repr__(self):
+        return "ScaledBackend"
+
+    def compute_signature(self, stream, depth, num_threads=1, min_chunk_rows=None):
+        return 2.0 * super().compute_signature(stream, depth)
+
+
+class TestBench(unittest.TestCase):
+
+    def run_small(self, backend_list):
+        return bench.run(widths=(2, 3), depths=(2,), lengths=(20,), batch_sizes=(1, 4),
+                         kinds=("sig",), backend_list=backend_list, min_time=0.0, min_repeats=1)
+
+    def test_cases_cover_grid_and_serialise(self):
+        results = self.run_small(["libalgebra", LibalgebraBackend()])
+        self.assertEqual(len(results["cases"]), 2 * 2 * 2)
+        for case in results["cases"]:
+            self.assertNotIn("error", case)
+            self.assertTrue(case["agrees"])
+            self.assertGreater(case["streams_per_second"], 0.0)
+            self.assertAlmostEqual(case["rows_per_second"], 20 * case["streams_per_second"])
+        self.assertEqual(json.loads(json.dumps(results))["cases"], results["cases"])
+
+    def test_disagreement_is_reported(self):
+        results = self.run_small(["libalgebra", ScaledBackend])
+        scaled = [case for case in results["cases"] if case["backend"] == "ScaledBackend"]
+        self.assertEqual(len(scaled), 4)
+        self.assertTrue(all(case["agrees"] is False for case in scaled))
+
+    def test_failing_case_records_error(self):
+        results = bench.run(widths=(2,), depths=(0,), lengths=(10,), batch_sizes=(1,),
+                            kinds=("sig",), backend_list=["libalgebra"], min_time=0.0)
+        self.assertIn("error", results["cases"][0])
+
+    def test_first_call_memory_does_not_depend_on_the_cases_before(self):
+        def memory(depths):
+            results = bench.run(widths=(5,), depths=depths, lengths=(20,), batch_sizes=(1,),
+                                kinds=("sig",), backend_list=["libalgebra"], min_time=0.0, min_repeats=1)
+            return [case["memory"] for case in results["cases"] if case["depth"] == 4][0]
+        alone = memory((4,))
+        if alone is None:
+            self.skipTest("tosig does not count memory")
+        # the first call builds an arena, of at least the smallest block, whatever came before
+        self.assertGreaterEqual(alone["peak_bytes_per_call"], 1 << 16)
+        self.assertEqual(memory((6, 4))["peak_bytes_per_call"], alone["peak_bytes_per_call"])
+
+    def test_streams_are_reproducible(self):
+        np.testing.assert_array_equal(bench.make_streams(3, 10, 2, seed=4),
+                                      bench.make_streams(3, 10, 2, seed=4))
+
+
+if __name__ == "__main__":
+    unittest.main()
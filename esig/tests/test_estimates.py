@@ -0,0 +1,83 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig import estimates
+
+
+class TestEstimates(unittest.TestCase):
+
+    def test_sizes_match_closed_forms(self):
+        self.assertEqual(estimates.log_sig_size(2, 4), 8)
+        self.assertEqual(estimates.log_sig_size(3, 3), 14)
+        self.assertEqual(estimates.log_sig_size(40, 3), 40 + 780 + 21320)
+        self.assertEqual(estimates.sig_size(2, 16), 2 ** 17 - 1)
+        self.assertEqual(estimates.monomial_count(4, 2), 15)
+        self.assertEqual(estimates.monomial_count(6, 4), 210)
+        for width, depth in ((2, 3), (3, 4), (5, 2)):
+            self.assertEqual(esig.estimate(width, depth, 10, "sig")["output_size"],
+                             esig.tosig.sigdim(width, depth))
+
+    def test_witt_formula_counts_lyndon_words(self):
+        # the Lyndon words of each length, counted by brute force
+        def lyndon(width, k):
+            count = 0
+            for n in range(width ** k):
+                word = np.base_repr(n, width).zfill(k) if width > 1 else "0" * k
+                if all(word < word[i:] + word[:i] for i in range(1, k)):
+                    count += 1
+            return count
+        for width, k in ((2, 5), (3, 4), (4, 3)):
+            self.assertEqual(estimates.lie_level_size(width, k), lyndon(width, k))
+
+    def test_costs_grow_with_the_shape(self):
+        short = esig.estimate(3, 4, 100)
+        long = esig.estimate(3, 4, 1000)
+        self.assertGreater(long["flops"], 9 * short["flops"])
+        self.assertEqual(long["output_bytes"], short["output_bytes"])
+        logsig = esig.estimate(3, 4, 100, "logsig")
+        self.assertGreater(logsig["flops"], short["flops"])
+        self.assertGreater(logsig["table_bytes"], 0)
+        self.assertEqual(logsig["peak_bytes"], logsig["input_bytes"] + logsig["output_bytes"]
+                         + logsig["scratch_bytes"] + logsig["table_bytes"])
+
+    def test_projection_nonzeros_bound_the_table(self):
+        # column w of the projection is t2l of the word w, the log signature of exp(w)
+        for width, depth in ((2, 5), (3, 4), (4, 3)):
+            size = esig.tosig.sigdim(width, depth)
+            unit = np.zeros(size)
+            total = 0
+            for degree in range(1, depth + 1):
+                for i in range(estimates.sig_size(width, degree - 1), estimates.sig_size(width, degree)):
+                    unit[:] = 0.0
+                    unit[i] = 1.0
+                    column = esig.tosig.sig2logsig(esig.tosig.tensorexp(unit, width, depth), width, depth)
+                    nonzeros = int(np.count_nonzero(np.abs(column) > 1e-12))
+                    self.assertLessEqual(nonzeros, estimates._word_nonzeros(width, degree), (width, i))
+                    total += nonzeros
+            self.assertLessEqual(total, estimates._projection_nonzeros(width, depth))
+
+    def test_setup_is_counted_apart(self):
+        logsig = esig.estimate(3, 4, 100, "logsig")
+        self.assertGreater(logsig["setup_flops"], 0)
+        self.assertEqual(esig.estimate(3, 4, 1000, "logsig")["setup_flops"], logsig["setup_flops"])
+        self.assertEqual(esig.estimate(3, 4, 100)["setup_flops"], 0)
+        self.assertEqual(esig.estimate(4, 2, 100, "recombine")["setup_flops"], 0)
+
+    def test_recombine(self):
+        ans = esig.estimate(4, 2, 10000, "recombine")
+        self.assertEqual(ans["output_size"], 15)
+        self.assertGreater(ans["flops"], 10000 * 15)
+        few = esig.estimate(4, 2, 10, "recombine")
+        self.assertEqual(few["flops"], 10 * (15 + 16))
+
+    def test_bad_arguments_raise(self):
+        with self.assertRaises(ValueError):
+            esig.estimate(3, 2, 10, "lie")
+        with self.assertRaises(ValueError):
+            esig.estimate(0, 2, 10)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,65 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestExpectedSignature(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(4321)
+        self.width = 2
+        self.depth = 3
+        self.batch = np.cumsum(np.random.uniform(-1., 1., size=(50, 12, self.width)), axis=1)
+        self.sigs = np.stack([esig.stream2sig(s, self.depth) for s in self.batch])
+
+    def test_mean_and_variance_of_batch(self):
+        est = esig.ExpectedSignature(self.width, self.depth, second_moment=True)
+        est.update(self.batch)
+        self.assertEqual(est.count, 50)
+        self.assert_allclose(est.mean, self.sigs.mean(axis=0))
+        self.assert_allclose(est.variance, self.sigs.var(axis=0, ddof=1))
+
+    def test_thread_count_does_not_change_answer(self):
+        for threads in (1, 3, 8):
+            with self.subTest(num_threads=threads):
+                est = esig.ExpectedSignature(self.width, self.depth, num_threads=threads)
+                est.update(self.batch)
+                self.assert_allclose(est.mean, self.sigs.mean(axis=0))
+
+    def test_incremental_batches_and_merge(self):
+        first = esig.ExpectedSignature(self.width, self.depth, second_moment=True)
+        second = esig.ExpectedSignature(self.width, self.depth, second_moment=True)
+        first.update(self.batch[:20]).update(self.batch[20:30])
+        second.update(self.batch[30:])
+        first.merge(second)
+        self.assertEqual(first.count, 50)
+        self.assert_allclose(first.mean, self.sigs.mean(axis=0))
+        self.assert_allclose(first.variance, self.sigs.var(axis=0, ddof=1))
+
+    def test_streams_of_different_lengths(self):
+        streams = [self.batch[0], self.batch[1][:5], self.batch[2][:9]]
+        est = esig.ExpectedSignature(self.width, self.depth)
+        est.update(streams)
+        expected = np.mean([esig.stream2sig(s, self.depth) for s in streams], axis=0)
+        self.assert_allclose(est.mean, expected)
+
+    def test_bad_arguments_raise_even_without_streams(self):
+        mean = np.zeros(esig.tosig.sigdim(self.width, self.depth))
+        empty = self.batch[:0]
+        for streams in (empty, []):
+            with self.subTest(streams=type(streams).__name__):
+                self.assertEqual(esig.tosig.accumulatesig(streams, self.depth, 7, mean), 7)
+                with self.assertRaises(ValueError):
+                    esig.tosig.accumulatesig(streams, 0, 0, mean)
+                with self.assertRaises(ValueError):
+                    esig.tosig.accumulatesig(streams, self.depth, 0, mean[:-1], mean)
+        with self.assertRaises(ValueError):
+            esig.tosig.accumulatesig(empty, self.depth + 1, 0, mean)
+        # a width the build has no signatures for raises, and does not return NULL without an error
+        with self.assertRaises((ValueError, RuntimeError)):
+            esig.tosig.accumulatesig(np.zeros((1, 2, 1000)), self.depth, 0, mean)
@@ -0,0 +1,72 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.backends import tosig
+from esig.tests.test_package_interface import ArrayTestCase, STREAM, SIGNATURE
+
+
+@unittest.skipIf(tosig is None, "the tosig extension is not available")
+class TestKernelSelection(ArrayTestCase):
+    RTOL = 1e-12
+    ATOL = 1e-14
+
+    def setUp(self):
+        np.random.seed(4321)
+        self.initial = tosig.get_kernels()
+        self.path = np.cumsum(np.random.uniform(-1., 1., size=(50, 5)), axis=0)
+
+    def tearDown(self):
+        tosig.set_kernels(self.initial)
+
+    def test_generic_always_available(self):
+        self.assertEqual(tosig.available_kernels()[0], "generic")
+        self.assertIn(tosig.get_kernels(), tosig.available_kernels())
+
+    def test_kernels_agree(self):
+        tosig.set_kernels("generic")
+        expected = esig.stream2sig(self.path, 4)
+        for name in tosig.available_kernels():
+            tosig.set_kernels(name)
+            self.assertEqual(tosig.get_kernels(), name)
+            self.assert_allclose(esig.stream2sig(self.path, 4), expected)
+            self.assert_allclose(esig.stream2sig(STREAM, 2), SIGNATURE)
+
+    def test_non_contiguous_stream(self):
+        expected = esig.stream2sig(np.ascontiguousarray(self.path[::2]), 3)
+        self.assert_allclose(tosig.stream2sig(self.path[::2], 3), expected)
+
+    def test_unsupported_kernels_raise(self):
+        with self.assertRaises(ValueError):
+            tosig.set_kernels("no-such-kernels")
+        self.assertEqual(tosig.get_kernels(), self.initial)
+
+
+@unittest.skipIf(tosig is None, "the tosig extension is not available")
+class TestChunkedSignature(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(2468)
+        self.path = np.cumsum(np.random.uniform(-0.1, 0.1, size=(1001, 3)), axis=0)
+        self.expected = esig.stream2sig(self.path, 4)
+
+    def test_chunked_matches_serial(self):
+        for threads in (0, 2, 3, 7):
+            sig = esig.stream2sig(self.path, 4, num_threads=threads, min_chunk_rows=10)
+            self.assert_allclose(sig, self.expected)
+
+    def test_chunks_share_boundary_rows(self):
+        # 1000 increments in 1000 chunks of a single increment each
+        sig = tosig.stream2sig(self.path, 4, num_threads=1000, min_chunk_rows=1)
+        self.assert_allclose(sig, self.expected)
+
+    def test_short_stream_is_not_split(self):
+        sig = tosig.stream2sig(STREAM, 2, num_threads=4, min_chunk_rows=2)
+        self.assert_allclose(sig, SIGNATURE)
+
+    def test_negative_arguments_raise(self):
+        with self.assertRaises(ValueError):
+            tosig.stream2sig(STREAM, 2, num_threads=-1)
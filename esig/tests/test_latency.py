@@ -0,0 +1,59 @@
+import unittest
+
+import numpy as np
+
+from esig import latency, tosig
+
+
+class TestLatencyHistograms(unittest.TestCase):
+
+    def setUp(self):
+        self.was_recording = tosig.set_latency_recording(True)
+        tosig.reset_latency_histograms()
+        np.random.seed(97531)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(40, 3)), axis=0)
+
+    def tearDown(self):
+        tosig.set_latency_recording(self.was_recording)
+        tosig.reset_latency_histograms()
+
+    def test_calls_are_counted_by_entry_point_and_shape(self):
+        for _ in range(5):
+            tosig.stream2sig(self.stream, 3)
+        tosig.stream2sig(self.stream, 2)
+        tosig.stream2logsig(self.stream, 3)
+        snapshot = tosig.get_latency_histograms()
+        histograms = snapshot["histograms"]
+        self.assertEqual(set(histograms), {("signature", 3, 3), ("signature", 3, 2), ("log_signature", 3, 3)})
+        signature = histograms[("signature", 3, 3)]
+        self.assertEqual(signature["calls"], 5)
+        self.assertEqual(signature["counts"].dtype, np.uint64)
+        self.assertEqual(signature["counts"].sum(), 5)
+        self.assertEqual(len(snapshot["bounds"]), len(signature["counts"]) + 1)
+        self.assertTrue(np.all(np.diff(snapshot["bounds"]) > 0))
+        self.assertGreater(signature["max_seconds"], 0.0)
+        self.assertLessEqual(signature["max_seconds"], signature["total_seconds"])
+
+    def test_percentiles_are_bounded_by_the_slowest_call(self):
+        for _ in range(20):
+            tosig.stream2sig(self.stream, 4)
+        histogram = tosig.get_latency_histograms()["histograms"][("signature", 3, 4)]
+        p50, p99, p100 = latency.percentiles((50, 99, 100))[("signature", 3, 4)]
+        self.assertLessEqual(p50, p99)
+        self.assertLessEqual(p99, p100)
+        self.assertEqual(p100, histogram["max_seconds"])
+        self.assertGreater(p50, 0.0)
+
+    def test_failed_calls_reset_and_off(self):
+        with self.assertRaises(Exception):
+            tosig.stream2sig(self.stream, -1)
+        tosig.stream2sig(self.stream, 2)
+        tosig.reset_latency_histograms()
+        self.assertEqual(tosig.get_latency_histograms()["histograms"], {})
+        self.assertTrue(tosig.set_latency_recording(False))
+        tosig.stream2sig(self.stream, 2)
+        self.assertEqual(tosig.get_latency_histograms()["histograms"], {})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,82 @@
+import threading
+import unittest
+
+import numpy as np
+
+from esig import tosig
+
+
+class TestMemoryStats(unittest.TestCase):
+
+    def setUp(self):
+        tosig.reset_memory_stats()
+        np.random.seed(1357)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(50, 3)), axis=0)
+
+    def _on_new_thread(self, fn):
+        # a fresh thread starts with an empty arena, so its first call allocates
+        thread = threading.Thread(target=fn)
+        thread.start()
+        thread.join()
+
+    def test_calls_are_counted_by_entry_point(self):
+        tosig.stream2sig(self.stream, 3)
+        tosig.stream2sig(self.stream, 2)
+        tosig.stream2logsig(self.stream, 3)
+        calls = tosig.get_memory_stats()["calls"]
+        self.assertEqual(set(calls), {"signature", "log_signature", "recombine"})
+        self.assertEqual(calls["signature"]["calls"], 2)
+        self.assertEqual(calls["log_signature"]["calls"], 1)
+        self.assertEqual(calls["recombine"]["calls"], 0)
+
+    def test_allocations_and_peak_of_a_cold_call(self):
+        self._on_new_thread(lambda: tosig.stream2sig(self.stream, 4))
+        stats = tosig.get_memory_stats()
+        signature = stats["calls"]["signature"]
+        self.assertGreater(signature["allocations"], 0)
+        # the scratch of depth 4 holds at least the signature itself
+        self.assertGreaterEqual(signature["peak_bytes_in_use"], 8 * tosig.sigdim(3, 4))
+        self.assertEqual(signature["last_peak_bytes_in_use"], signature["peak_bytes_in_use"])
+        self.assertGreaterEqual(stats["bytes_allocated"], signature["bytes_allocated"])
+        self.assertGreaterEqual(stats["peak_bytes_in_use"], signature["peak_bytes_in_use"])
+        self.assertGreater(stats["peak_rss_bytes"], 0)
+
+    def test_a_warm_call_counts_its_answer(self):
+        def twice():
+            tosig.stream2sig(self.stream, 4)
+            tosig.reset_memory_stats()
+            tosig.stream2sig(self.stream, 4)
+        self._on_new_thread(twice)
+        signature = tosig.get_memory_stats()["calls"]["signature"]
+        self.assertEqual(signature["calls"], 1)
+        # the arena is warm, but the numpy array of the answer is still the call's
+        self.assertGreaterEqual(signature["bytes_allocated"], 8 * tosig.sigdim(3, 4))
+        self.assertGreaterEqual(signature["peak_bytes_in_use"], 8 * tosig.sigdim(3, 4))
+
+    def test_the_vectors_of_a_subset_are_counted(self):
+        tosig.stream2sig_subset(self.stream, 4, np.array([0, 5, 40], dtype=np.intp))
+        signature = tosig.get_memory_stats()["calls"]["signature"]
+        # the tree of the words and the vectors of its nodes and values, beyond the answer
+        self.assertGreater(signature["allocations"], 1)
+        self.assertGreater(signature["bytes_allocated"], 3 * 8)
+
+    def test_the_peak_is_that_of_the_call(self):
+        # memory held before the call began is not part of its peak
+        held = [tosig.stream2sig(self.stream, 6) for _ in range(4)]
+        tosig.reset_memory_stats()
+        tosig.stream2sig(self.stream, 2)
+        signature = tosig.get_memory_stats()["calls"]["signature"]
+        self.assertLess(signature["peak_bytes_in_use"], 8 * tosig.sigdim(3, 6))
+        del held
+
+    def test_reset_zeroes_the_counters(self):
+        self._on_new_thread(lambda: tosig.stream2sig(self.stream, 3))
+        tosig.reset_memory_stats()
+        stats = tosig.get_memory_stats()
+        self.assertEqual(stats["allocations"], 0)
+        self.assertEqual(stats["bytes_allocated"], 0)
+        self.assertEqual(stats["calls"]["signature"]["calls"], 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
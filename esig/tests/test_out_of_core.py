@@ -0,0 +1,49 @@
+import os
+import shutil
+import tempfile
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase, STREAM, SIGNATURE
+
+
+@unittest.skipIf(esig.stream2sig_chunked is None, "the tosig extension is not available")
+class TestOutOfCoreSignature(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(97531)
+        self.path = np.cumsum(np.random.uniform(-0.2, 0.2, size=(257, 3)), axis=0)
+        self.directory = tempfile.mkdtemp()
+        self.filename = os.path.join(self.directory, "stream.npy")
+        np.save(self.filename, self.path)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def test_file_matches_in_memory(self):
+        expected = esig.stream2sig(self.path, 4)
+        for chunk_rows in (1, 2, 10, 256, 257, 1000):
+            for read_ahead in (True, False):
+                sig = esig.stream2sig_chunked(self.filename, 4, chunk_rows=chunk_rows,
+                                              read_ahead=read_ahead)
+                self.assert_allclose(sig, expected)
+
+    def test_memmap(self):
+        stream = np.load(self.filename, mmap_mode="r")
+        self.assert_allclose(esig.stream2sig_chunked(stream, 3, chunk_rows=16),
+                             esig.stream2sig(self.path, 3))
+
+    def test_depth_one(self):
+        self.assert_allclose(esig.stream2sig_chunked(self.filename, 1, chunk_rows=7),
+                             esig.stream2sig(self.path, 1))
+
+    def test_small_stream(self):
+        self.assert_allclose(esig.stream2sig_chunked(STREAM, 2, chunk_rows=1), SIGNATURE)
+
+    def test_log_signature(self):
+        self.assert_allclose(esig.stream2logsig_chunked(self.filename, 3, chunk_rows=50),
+                             esig.stream2logsig(self.path, 3))
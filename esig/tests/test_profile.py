@@ -0,0 +1,45 @@
+import unittest
+
+import numpy as np
+
+from esig import tosig
+
+
+class TestProfile(unittest.TestCase):
+
+    def setUp(self):
+        self.was_on = tosig.set_profiling(True)
+        tosig.reset_profile()
+        np.random.seed(2468)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(50, 3)), axis=0)
+
+    def tearDown(self):
+        tosig.set_profiling(self.was_on)
+        tosig.reset_profile()
+
+    def test_phases_of_signature_are_counted(self):
+        tosig.stream2sig(np.asfortranarray(self.stream), 3)
+        tosig.stream2sig(self.stream, 3)
+        phases = tosig.get_profile()[(3, 3)]
+        self.assertEqual(set(phases), {"convert", "signature", "log", "project"})
+        self.assertEqual(phases["convert"][0], 2)
+        self.assertEqual(phases["signature"][0], 2)
+        self.assertEqual(phases["log"], (0, 0.0))
+        self.assertGreaterEqual(phases["signature"][1], 0.0)
+
+    def test_counters_are_kept_by_shape_and_reset(self):
+        tosig.stream2sig(self.stream, 2)
+        tosig.stream2sig(self.stream[:, :2], 4)
+        self.assertEqual(set(tosig.get_profile()), {(3, 2), (2, 4)})
+        tosig.reset_profile()
+        self.assertEqual(tosig.get_profile(), {})
+
+    def test_nothing_is_counted_when_off(self):
+        self.assertTrue(tosig.set_profiling(False))
+        tosig.stream2sig(self.stream, 3)
+        self.assertEqual(tosig.get_profile(), {})
+        self.assertFalse(tosig.set_profiling())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,64 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase, STREAM, SIGNATURE, LOG_SIGNATURE
+
+
+class TestRaggedBatch(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(8642)
+        self.lengths = [5, 0, 1, 40, 17, 2, 90]
+        self.offsets = np.concatenate([[0], np.cumsum(self.lengths)])
+        self.data = np.cumsum(np.random.uniform(-0.5, 0.5, size=(self.offsets[-1], 3)), axis=0)
+        self.streams = [self.data[self.offsets[i]:self.offsets[i + 1]] for i in range(len(self.lengths))]
+
+    def expected(self, fn, depth, size):
+        return np.stack([fn(s, depth) if len(s) > 1 else self.trivial(fn, size) for s in self.streams])
+
+    def trivial(self, fn, size):
+        ans = np.zeros(size)
+        if fn is esig.stream2sig:
+            ans[0] = 1.0
+        return ans
+
+    def test_signatures_match_single_streams(self):
+        for threads in (1, 2, 0, 16):
+            sigs = esig.stream2sig_ragged(self.data, self.offsets, 4, num_threads=threads)
+            self.assertEqual(sigs.shape, (len(self.lengths), esig.sigdim(3, 4)))
+            self.assert_allclose(sigs, self.expected(esig.stream2sig, 4, sigs.shape[1]))
+
+    def test_skewed_batch_matches_single_streams(self):
+        # one stream long enough to be split into pieces combined afterwards
+        lengths = [3, 20000, 7, 0, 50]
+        offsets = np.concatenate([[0], np.cumsum(lengths)])
+        data = np.cumsum(np.random.uniform(-0.5, 0.5, size=(offsets[-1], 2)), axis=0)
+        expected = np.stack([esig.stream2sig(data[offsets[i]:offsets[i + 1]], 3) if lengths[i] > 1
+                             else self.trivial(esig.stream2sig, esig.sigdim(2, 3)) for i in range(len(lengths))])
+        for threads in (1, 2, 4, 0):
+            self.assert_allclose(esig.stream2sig_ragged(data, offsets, 3, num_threads=threads), expected)
+
+    def test_log_signatures_match_single_streams(self):
+        logsigs = esig.stream2logsig_ragged(self.data, self.offsets, 3, num_threads=3)
+        self.assertEqual(logsigs.shape, (len(self.lengths), esig.logsigdim(3, 3)))
+        self.assert_allclose(logsigs, self.expected(esig.stream2logsig, 3, logsigs.shape[1]))
+
+    def test_known_values(self):
+        data = np.concatenate([STREAM, STREAM])
+        offsets = [0, 4, 8]
+        self.assert_allclose(esig.stream2sig_ragged(data, offsets, 2), np.stack([SIGNATURE] * 2))
+        self.assert_allclose(esig.stream2logsig_ragged(data, offsets, 2), np.stack([LOG_SIGNATURE] * 2))
+
+    def test_depth_one(self):
+        sigs = esig.stream2sig_ragged(self.data, self.offsets, 1)
+        self.assert_allclose(sigs, self.expected(esig.stream2sig, 1, 4))
+
+    def test_bad_offsets_raise(self):
+        with self.assertRaises(ValueError):
+            esig.stream2sig_ragged(self.data, [0, 10, 5], 2)
+        with self.assertRaises(ValueError):
+            esig.stream2sig_ragged(self.data, [0, len(self.data) + 1], 2)
@@ -0,0 +1,33 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestShapeKernels(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def test_keys_of_widths_in_several_ranges(self):
+        # each width below lives in a different tosig_shapes_<min>_<max>
+        for width in (2, 3, 5, 12):
+            keys = esig.sigkeys(width, 2).split()
+            self.assertEqual(len(keys), esig.sigdim(width, 2))
+            self.assertEqual(keys[width + 1], "(1,1)")
+            self.assertEqual(len(esig.logsigkeys(width, 2).split()), esig.logsigdim(width, 2))
+
+    def test_log_signature_of_plane_path(self):
+        # the increments and the Levy area of the path (0,0) -> (1,0) -> (1,1)
+        stream = np.array([[0.0, 0.0], [1.0, 0.0], [1.0, 1.0]])
+        self.assertEqual(esig.logsigkeys(2, 2).split(), ["1", "2", "[1,2]"])
+        self.assert_allclose(esig.stream2logsig(stream, 2), np.array([1.0, 1.0, 0.5]))
+
+    def test_width_out_of_range_raises(self):
+        with self.assertRaises(RuntimeError):
+            esig.tosig.logsigkeys(300, 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,78 @@
+import math
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestSigSubset(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(2468)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(300, 3)), axis=0)
+
+    def test_indices_match_full_signature(self):
+        full = esig.stream2sig(self.stream, 4)
+        indices = np.random.choice(len(full), size=25, replace=False)
+        self.assert_allclose(esig.stream2sig(self.stream, 4, indices=indices), full[indices])
+
+    def test_keys_match_sigkeys(self):
+        full = esig.stream2sig(self.stream, 3)
+        names = esig.sigkeys(3, 3).split()
+        chosen = [names[i] for i in (0, 2, 5, 17, 39)]
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=chosen), full[[0, 2, 5, 17, 39]])
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=" ".join(chosen)), full[[0, 2, 5, 17, 39]])
+
+    def test_key_notation(self):
+        full = esig.stream2sig(self.stream, 3)
+        # level 2 starts at 1 + 3, and (2,1) is its fourth word
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=["()", "(2,1)", "3"]), full[[0, 7, 3]])
+
+    def test_words_as_letters(self):
+        full = esig.stream2sig(self.stream, 3)
+        # the letters are counted from 1, as in sigkeys
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=[[], [2, 1], (3,), np.array([3, 3, 1])]),
+                             full[[0, 7, 3, 37]])
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=np.array([[1, 2], [2, 1]])), full[[5, 7]])
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys=["(1,2)", [2, 1]]), full[[5, 7]])
+
+    def test_spaced_keys_in_one_string(self):
+        full = esig.stream2sig(self.stream, 3)
+        self.assert_allclose(esig.stream2sig(self.stream, 3, keys="() (1, 2) ( 2,1 )\t(3, 3, 1)"),
+                             full[[0, 5, 7, 37]])
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 3, keys="(1, 2) 3")
+
+    def test_deeper_than_full_signature(self):
+        # the signature of a straight line x is the product of x along a word over its length factorial
+        x = np.array([0.3, -0.7])
+        line = np.array([[0.0, 0.0], x])
+        word = [1, 2, 2, 1, 2, 1, 1, 2, 1, 2, 2, 2]
+        key = "(" + ",".join(map(str, word)) + ")"
+        expected = np.prod(x[np.array(word) - 1]) / math.factorial(len(word))
+        self.assert_allclose(esig.stream2sig(line, len(word), keys=[key]), np.array([expected]))
+
+    def test_bad_keys_raise(self):
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 2, keys=["(1,2,3)"])
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 2, keys=["(4)"])
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 2, keys=[[1, 4]])
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 2, keys=[[0]])
+        # positions are not words, and are given as indices
+        with self.assertRaises(TypeError):
+            esig.stream2sig(self.stream, 2, keys=[1, 2])
+        with self.assertRaises(IndexError):
+            esig.stream2sig(self.stream, 2, indices=[13])
+        with self.assertRaises(ValueError):
+            esig.stream2sig(self.stream, 2, keys=["(1)"], indices=[1])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,39 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestSparseIncrements(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(8642)
+        # a one-hot categorical channel of width 24 and a price that changes on a few rows
+        categories = np.eye(24)[np.random.randint(0, 24, size=120)]
+        price = np.cumsum(np.where(np.random.uniform(size=120) < 0.1,
+                                   np.random.normal(size=120), 0.0))
+        self.stream = np.column_stack([categories, price])
+
+    def test_matches_word_by_word_signature(self):
+        # stream2sig(indices=...) updates each word separately, not through the tensor kernels
+        depth = 3
+        full = esig.stream2sig(self.stream, depth)
+        self.assert_allclose(full, esig.stream2sig(self.stream, depth, indices=np.arange(len(full))))
+
+    def test_repeated_rows_change_nothing(self):
+        repeated = np.repeat(self.stream, 3, axis=0)
+        self.assert_allclose(esig.stream2sig(repeated, 3), esig.stream2sig(self.stream, 3))
+
+    def test_extend_skips_constant_rows(self):
+        sig = esig.stream2sig(self.stream[:1], 3)
+        constant = np.repeat(self.stream[:1], 50, axis=0)
+        esig.tosig.extendsig(sig, constant, 3, previous=self.stream[0])
+        self.assert_allclose(sig, esig.stream2sig(self.stream[:1], 3))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,51 @@
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests import auxiliaryfunct as ax
+from esig.tests.test_package_interface import ArrayTestCase, STREAM, SIGNATURE
+
+
+class TestTensorFunctions(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(1234)
+        self.width = 3
+        self.depth = 4
+        self.path = np.cumsum(np.random.uniform(-1., 1., size=(20, self.width)), axis=0)
+        self.sig = esig.stream2sig(self.path, self.depth)
+
+    def test_inverse_is_signature_of_reversed_path(self):
+        inv = esig.tensorinverse(self.sig, self.width, self.depth)
+        self.assert_allclose(inv, esig.stream2sig(self.path[::-1], self.depth))
+
+    def test_exp_of_log_is_identity(self):
+        log_sig = esig.tensorlog(self.sig, self.width, self.depth)
+        self.assertEqual(log_sig[0], 0.0)
+        self.assert_allclose(esig.tensorexp(log_sig, self.width, self.depth), self.sig)
+
+    def test_log_matches_log_signature_as_tensor(self):
+        path = np.array(ax.random_path(10, [-1, 0, 1], 2), dtype=np.float64)
+        sig = esig.stream2sig(path, 3)
+        self.assert_allclose(
+            esig.tensorlog(sig, 2, 3),
+            ax.Logsigastensor(path, 3)
+        )
+
+    def test_batched_shape_and_values(self):
+        batch = np.stack([SIGNATURE, esig.stream2sig(STREAM[::-1], 2)])
+        inv = esig.tensorinverse(batch, 2, 2)
+        self.assertEqual(inv.shape, batch.shape)
+        self.assert_allclose(inv[0], batch[1])
+        self.assert_allclose(inv[1], batch[0])
+
+    def test_wrong_size_raises(self):
+        with self.assertRaises(ValueError):
+            esig.tensorexp(np.zeros(5), 2, 2)
+
+    def test_log_requires_positive_scalar_term(self):
+        with self.assertRaises(RuntimeError):
+            esig.tensorlog(np.zeros(7), 2, 2)
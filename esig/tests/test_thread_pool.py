@@ -0,0 +1,97 @@
+import os
+import sys
+import threading
+import time
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestThreadPool(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(9753)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(2000, 3)), axis=0)
+        self.default = esig.get_num_threads()
+
+    def tearDown(self):
+        esig.set_num_threads(0)
+
+    def test_default_is_positive(self):
+        self.assertGreaterEqual(self.default, 1)
+
+    def test_set_and_restore(self):
+        esig.set_num_threads(3)
+        self.assertEqual(esig.get_num_threads(), 3)
+        esig.set_num_threads(0)
+        self.assertEqual(esig.get_num_threads(), self.default)
+
+    def test_negative_raises(self):
+        with self.assertRaises(ValueError):
+            esig.set_num_threads(-1)
+
+    def test_results_do_not_depend_on_pool_size(self):
+        expected = esig.stream2sig(self.stream, 4)
+        for size in (1, 2, 5):
+            esig.set_num_threads(size)
+            self.assert_allclose(esig.stream2sig(self.stream, 4, num_threads=0, min_chunk_rows=100), expected)
+
+    @unittest.skipUnless(hasattr(os, "fork"), "needs os.fork")
+    def test_pool_works_after_fork(self):
+        esig.set_num_threads(4)
+        expected = esig.stream2sig(self.stream, 3, num_threads=0, min_chunk_rows=100)
+        pid = os.fork()
+        if pid == 0:
+            try:
+                sig = esig.stream2sig(self.stream, 3, num_threads=0, min_chunk_rows=100)
+                os._exit(0 if np.allclose(sig, expected, rtol=self.RTOL, atol=self.ATOL) else 1)
+            except BaseException:
+                os._exit(2)
+        _, status = os.waitpid(pid, 0)
+        self.assertTrue(os.WIFEXITED(status))
+        self.assertEqual(os.WEXITSTATUS(status), 0)
+
+
+class TestReleasesTheGil(unittest.TestCase):
+    # a serial signature or log signature lets other Python threads run while it computes;
+    # with a switch interval too long for the interpreter to take the GIL from this thread,
+    # a thread waiting for it can only count while a call has let it go
+
+    def _counts_meanwhile(self, fn):
+        np.random.seed(8642)
+        stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(20000, 3)), axis=0)
+        counter = [0]
+        stop = threading.Event()
+
+        def count():
+            while not stop.is_set():
+                counter[0] += 1
+                time.sleep(0.0001)
+
+        interval = sys.getswitchinterval()
+        thread = threading.Thread(target=count)
+        thread.start()
+        sys.setswitchinterval(1000.0)
+        try:
+            # a few calls, in case the counting thread was not waiting for the GIL during one
+            for _ in range(20):
+                before = counter[0]
+                fn(stream)
+                if counter[0] != before:
+                    return True
+            return False
+        finally:
+            sys.setswitchinterval(interval)
+            stop.set()
+            thread.join()
+
+    def test_signature(self):
+        self.assertTrue(self._counts_meanwhile(lambda stream: esig.tosig.stream2sig(stream, 5)))
+
+    def test_log_signature(self):
+        self.assertTrue(self._counts_meanwhile(lambda stream: esig.tosig.stream2logsig(stream, 5)))
@@ -0,0 +1,51 @@
+import json
+import random
+import unittest
+
+import numpy as np
+
+from esig import tick_replay
+
+
+class TestTickReplay(unittest.TestCase):
+
+    def run_small(self, **options):
+        return tick_replay.run(thread_counts=(1, 2), batch_every=150, keys=30, ticks=400,
+                               widths=(2, 3), depths=(2, 3), window=12, logsig_fraction=0.0, **options)
+
+    def test_workload_covers_every_tick(self):
+        workload = tick_replay.make_workload(keys=10, ticks=200, widths=(2, 3), depths=(2,), window=8,
+                                             skew=1.5, seed=3)
+        self.assertEqual(len(workload["order"]), 200)
+        for key, path in enumerate(workload["path"]):
+            self.assertEqual(path.shape, (8 + (workload["order"] == key).sum(), workload["width"][key]))
+        # the skew gives the first key more ticks than the last
+        self.assertGreater((workload["order"] == 0).sum(), (workload["order"] == 9).sum())
+
+    def test_workload_is_reproducible_and_leaves_random_alone(self):
+        random.seed(11)
+        expected = random.random()
+        random.seed(11)
+        first = tick_replay.make_workload(keys=5, ticks=50, window=4, seed=7)
+        self.assertEqual(random.random(), expected)
+        second = tick_replay.make_workload(keys=5, ticks=50, window=4, seed=7)
+        for a, b in zip(first["path"], second["path"]):
+            np.testing.assert_array_equal(a, b)
+
+    def test_runs_agree_and_serialise(self):
+        results = self.run_small()
+        self.assertEqual([result["threads"] for result in results["runs"]], [1, 2])
+        for result in results["runs"]:
+            self.assertTrue(result["agrees"])
+            self.assertEqual(result["ticks"], 400)
+            self.assertEqual(result["batches"], 3)
+            self.assertGreater(result["ticks_per_second"], 0.0)
+            ticks = result["tick_seconds"]
+            self.assertLessEqual(ticks["p50"], ticks["p99"])
+            self.assertLessEqual(ticks["p99.9"], ticks["max"])
+            self.assertEqual(set(result["tick_seconds_by_kind_and_depth"]), {"sig/2", "sig/3"})
+        self.assertEqual(json.loads(json.dumps(results))["runs"], results["runs"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,72 @@
+import json
+import threading
+import unittest
+
+import numpy as np
+
+from esig import tosig
+
+
+class TestTrace(unittest.TestCase):
+
+    def setUp(self):
+        self.was_tracing = tosig.set_tracing(True)
+        tosig.reset_trace()
+        np.random.seed(2468)
+        self.data = np.cumsum(np.random.uniform(-0.5, 0.5, size=(60, 2)), axis=0)
+        self.offsets = np.array([0, 20, 40, 60], dtype=np.int64)
+
+    def tearDown(self):
+        tosig.set_tracing(self.was_tracing)
+        tosig.reset_trace()
+
+    def _events(self):
+        trace = json.loads(tosig.get_trace())
+        return [event for event in trace["traceEvents"] if event["ph"] == "X"], trace
+
+    def test_ragged_streams_are_traced(self):
+        tosig.stream2sig_ragged(self.data, self.offsets, 3, num_threads=2)
+        events, trace = self._events()
+        names = [event["name"] for event in events]
+        self.assertEqual(names.count("ragged_signatures"), 1)
+        streams = sorted(event["args"]["index"] for event in events if event["name"] in ("signature", "piece"))
+        self.assertEqual(sorted(set(streams)), [0, 1, 2])
+        for event in events:
+            self.assertGreaterEqual(event["dur"], 0.0)
+            self.assertGreaterEqual(event["ts"], 0.0)
+        threads = {event["tid"] for event in trace["traceEvents"] if event["ph"] == "M"}
+        self.assertTrue({event["tid"] for event in events} <= threads)
+        self.assertEqual(trace["otherData"]["dropped_events"], 0)
+
+    def test_reset_and_off(self):
+        tosig.stream2sig_ragged(self.data, self.offsets, 2)
+        self.assertTrue(self._events()[0])
+        tosig.reset_trace()
+        self.assertEqual(self._events()[0], [])
+        self.assertTrue(tosig.set_tracing(False))
+        tosig.stream2sig_ragged(self.data, self.offsets, 2)
+        self.assertEqual(self._events()[0], [])
+
+    def test_buffers_of_exited_threads_are_freed_by_reset(self):
+        def record():
+            tosig.stream2sig_ragged(self.data, self.offsets, 2, num_threads=1)
+        before = self._events()[1]["otherData"]["thread_buffers"]
+        for _ in range(20):
+            thread = threading.Thread(target=record)
+            thread.start()
+            thread.join()
+        events, trace = self._events()
+        # the events of the threads are kept after they exit, each under a number of its own
+        calls = [event["tid"] for event in events if event["name"] == "ragged_signatures"]
+        self.assertEqual(len(calls), 20)
+        self.assertEqual(len(set(calls)), 20)
+        self.assertEqual(trace["otherData"]["thread_buffers"], before + 20)
+        tosig.reset_trace()
+        events, trace = self._events()
+        self.assertEqual(events, [])
+        # only those of the threads still running, at most the pool's, are left
+        self.assertLessEqual(trace["otherData"]["thread_buffers"], before + tosig.get_num_threads())
+
+
+if __name__ == "__main__":
+    unittest.main()
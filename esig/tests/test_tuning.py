@@ -0,0 +1,134 @@
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+
+import esig
+from esig import tuning
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+def calibration_with(models):
+    return {"version": tuning.CALIBRATION_VERSION, "features": list(tuning.FEATURES),
+            "models": models}
+
+
+class TestTuning(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        self.saved = tuning.get_calibration()
+        self.directory = tempfile.mkdtemp()
+        self.path = os.path.join(self.directory, "calibration.json")
+        np.random.seed(97531)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(200, 3)), axis=0)
+
+    def tearDown(self):
+        tuning.set_calibration(self.saved)
+        shutil.rmtree(self.directory)
+
+    def test_tune_saves_and_loads_calibration(self):
+        calibration = tuning.tune(self.path, widths=(2, 3), depths=(2, 3), lengths=(10, 100),
+                                  min_time=0.0, min_repeats=1)
+        with open(self.path) as f:
+            self.assertEqual(json.load(f), calibration)
+        self.assertEqual(calibration["features"], list(tuning.FEATURES))
+        for name, coefficients in calibration["models"]["sig"].items():
+            self.assertEqual(len(coefficients), len(tuning.FEATURES))
+            self.assertTrue(all(c >= 0.0 for c in coefficients))
+        tuning.set_calibration(None)
+        self.assertEqual(tuning.load_calibration(self.path), calibration)
+        self.assertIsNone(tuning.load_calibration(os.path.join(self.directory, "missing.json")))
+
+    def test_cheapest_method_is_chosen(self):
+        # chunking costs more per call but less per row and coordinate
+        tuning.set_calibration(calibration_with({
+            "sig": {"serial": [1e-6, 0.0, 0.0, 1e-9], "chunked": [1e-4, 0.0, 0.0, 1e-10]},
+        }))
+        self.assertEqual(tuning.choose("sig", 3, 3, 10), "serial")
+        self.assertEqual(tuning.choose("sig", 3, 3, 100000), "chunked")
+        self.assertEqual(tuning.choose("logsig", 3, 3, 100000), "serial")
+
+    def test_calibration_of_another_thread_count_is_ignored(self):
+        models = {"sig": {"serial": [1e-6, 0.0, 0.0, 1e-9], "chunked": [1e-4, 0.0, 0.0, 1e-10]}}
+        threads = esig.tosig.get_num_threads()
+        tuning.set_calibration(dict(calibration_with(models), threads=threads))
+        self.assertEqual(tuning.choose("sig", 3, 3, 100000), "chunked")
+        tuning.set_calibration(dict(calibration_with(models), threads=threads + 1))
+        with self.assertWarns(RuntimeWarning):
+            self.assertEqual(tuning.choose("sig", 3, 3, 100000), "serial")
+
+    def test_import_loads_but_does_not_use_the_calibration(self):
+        package = os.path.dirname(os.path.dirname(os.path.abspath(esig.__file__)))
+        with open(self.path, "w") as f:
+            json.dump(calibration_with({"sig": {"serial": [1e-6, 0.0, 0.0, 1e-9]}}), f)
+        env = dict(os.environ, ESIG_CALIBRATION=self.path,
+                   PYTHONPATH=os.pathsep.join([package, os.environ.get("PYTHONPATH", "")]))
+        result = subprocess.run(
+            [sys.executable, "-c", "import esig; print(esig.tuning.get_calibration() is not None,"
+                                   " esig.get_backend())"],
+            env=env, cwd=self.directory, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+            universal_newlines=True)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertEqual(result.stdout.split(), ["True", repr(esig.backends.LibalgebraBackend())])
+
+    def test_auto_backend_agrees_with_libalgebra(self):
+        tuning.set_calibration(calibration_with({
+            "sig": {"serial": [1.0, 0.0, 0.0, 0.0], "chunked": [0.0, 0.0, 0.0, 0.0]},
+        }))
+        auto = esig.backends.BACKENDS["auto"]()
+        expected = esig.backends.LibalgebraBackend().compute_signature(self.stream, 3)
+        self.assert_allclose(auto.compute_signature(self.stream, 3), expected)
+
+    def test_other_versions_are_refused(self):
+        with self.assertRaises(ValueError):
+            tuning.set_calibration({"version": 0, "features": list(tuning.FEATURES), "models": {}})
+
+    def test_malformed_calibrations_are_refused(self):
+        good = calibration_with({"sig": {"serial": [1e-6, 0.0, 0.0, 1e-9]}})
+        tuning.set_calibration(good)
+        malformed = [
+            [1, 2], 3, "calibration",
+            dict(good, models=[1, 2]),
+            dict(good, models={"sig": [1e-6, 0.0, 0.0, 1e-9]}),
+            dict(good, models={"sig": {"serial": [1e-6, 0.0, 0.0]}}),
+            dict(good, models={"sig": {"serial": [-1e-6, 0.0, 0.0, 1e-9]}}),
+            dict(good, models={"sig": {"serial": ["1e-6", 0.0, 0.0, 1e-9]}}),
+            dict(good, models={"sig": {"serial": [float("nan"), 0.0, 0.0, 1e-9]}}),
+            dict(good, threads=0),
+            dict(good, threads="4"),
+            dict(good, threads=2.5),
+            dict(good, threads=True),
+        ]
+        for calibration in malformed:
+            with self.assertRaises(ValueError, msg=repr(calibration)):
+                tuning.set_calibration(calibration)
+            # the calibration in use is kept
+            self.assertIs(tuning.get_calibration(), good)
+        tuning.set_calibration(dict(good, threads=4))
+
+    def test_import_ignores_a_malformed_calibration(self):
+        package = os.path.dirname(os.path.dirname(os.path.abspath(esig.__file__)))
+        for text in ("[1, 2]", "3", '{"version": %d, "features": %s, "models": {}, "threads": -1}'
+                     % (tuning.CALIBRATION_VERSION, json.dumps(list(tuning.FEATURES)))):
+            with open(self.path, "w") as f:
+                f.write(text)
+            env = dict(os.environ, ESIG_CALIBRATION=self.path,
+                       PYTHONPATH=os.pathsep.join([package, os.environ.get("PYTHONPATH", "")]))
+            result = subprocess.run(
+                [sys.executable, "-c", "import esig; print(esig.tuning.get_calibration())"],
+                env=env, cwd=self.directory, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                universal_newlines=True)
+            self.assertEqual(result.returncode, 0, result.stderr)
+            self.assertEqual(result.stdout.strip(), "None")
+            self.assertIn("ignoring the calibration", result.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()
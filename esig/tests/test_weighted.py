@@ -0,0 +1,77 @@
+import itertools
+import unittest
+
+import numpy as np
+
+import esig
+from esig.tests.test_package_interface import ArrayTestCase
+
+
+class TestWeightedSignature(ArrayTestCase):
+    RTOL = 1e-9
+    ATOL = 1e-12
+
+    def setUp(self):
+        np.random.seed(1357)
+        self.stream = np.cumsum(np.random.uniform(-0.5, 0.5, size=(200, 3)), axis=0)
+
+    @staticmethod
+    def words(width, depth):
+        # the words of the full signature in the order of stream2sig
+        return [w for k in range(depth + 1) for w in itertools.product(range(width), repeat=k)]
+
+    def test_is_full_signature_without_heavy_words(self):
+        weights, budget = [1, 2, 3], 4
+        kept = [i for i, w in enumerate(self.words(3, 4)) if sum(weights[a] for a in w) <= budget]
+        full = esig.stream2sig(self.stream, 4)
+        ans = esig.stream2sig_weighted(self.stream, weights, budget)
+        self.assertEqual(len(ans), esig.weightedsigdim(weights, budget))
+        self.assertEqual(len(ans), len(kept))
+        self.assert_allclose(ans, full[kept])
+
+    def test_unit_weights_give_full_signature(self):
+        self.assert_allclose(esig.stream2sig_weighted(self.stream, [1, 1, 1], 3),
+                             esig.stream2sig(self.stream, 3))
+
+    def test_agrees_with_the_subset_of_the_same_words(self):
+        # a deep tree, with rows repeated so that some increments are zero
+        stream = np.repeat(self.stream[:60], 2, axis=0)
+        weights, budget = [2, 1, 3], 9
+        kept = [i for i, w in enumerate(self.words(3, 9)) if sum(weights[a] for a in w) <= budget]
+        self.assert_allclose(esig.stream2sig_weighted(stream, weights, budget),
+                             esig.tosig.stream2sig_subset(stream, 9, np.array(kept, dtype=np.intp)))
+        # the second call reuses the tables of the first
+        self.assert_allclose(esig.stream2sig_weighted(stream, weights, budget),
+                             esig.stream2sig_weighted(stream, np.array(weights), budget))
+
+    def test_keys(self):
+        keys = esig.weightedsigkeys([1, 2], 3).split()
+        self.assertEqual(keys, ["()", "(1)", "(2)", "(1,1)", "(1,2)", "(2,1)", "(1,1,1)"])
+        self.assertEqual(len(keys), esig.weightedsigdim([1, 2], 3))
+
+    def test_the_words_kept_are_bounded(self):
+        # weightings of the same words, the heavy letter never fitting, each kept apart
+        weightings = [[1, 1, 100 + k] for k in range(3 * 8)]
+        expected = esig.stream2sig_weighted(self.stream, weightings[0], 3)
+        esig.tosig.reset_memory_stats()
+        for weights in weightings[:8]:
+            esig.weightedsigdim(weights, 3)
+        full = esig.tosig.get_memory_stats()["bytes_in_use"]
+        for weights in weightings[8:]:
+            esig.weightedsigdim(weights, 3)
+        # as many words are dropped as are built
+        self.assertEqual(esig.tosig.get_memory_stats()["bytes_in_use"], full)
+        # and are built again when they are asked for
+        self.assert_allclose(esig.stream2sig_weighted(self.stream, weightings[0], 3), expected)
+
+    def test_bad_arguments_raise(self):
+        with self.assertRaises(ValueError):
+            esig.stream2sig_weighted(self.stream, [1, 0, 1], 3)
+        with self.assertRaises(ValueError):
+            esig.stream2sig_weighted(self.stream, [1, 1], 3)
+        with self.assertRaises(ValueError):
+            esig.weightedsigdim([1, 1], -1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,287 @@
+# Replaying a synthetic feed of ticks through the native API, as an online feature service
+# would, to measure its sustained throughput and tail latency on each number of threads
+#
+#   python -m esig.tick_replay --keys 2000 --ticks 100000 --threads 1,2,4 --output replay.json
+#
+# Each key is a random walk of unit steps, as auxiliaryfunct.random_path makes, with a width
+# and a depth of its own, and a few keys take most of the ticks. Each tick moves the rolling
+# window of its key on by a row and computes the signature, or log signature, of the window,
+# the keys being shared out over the threads as over the shards of a service. Every so many
+# ticks the features of every key are recomputed in a batch by stream2sig_ragged, and
+# checked against the last ones computed tick by tick.
+
+import argparse
+import itertools
+import json
+import platform
+import random
+import sys
+import threading
+import time
+
+import numpy
+
+from esig.backends import tosig
+
+
+DEFAULT_KEYS = 2000
+DEFAULT_TICKS = 100000
+DEFAULT_WIDTHS = (2, 3, 5)
+DEFAULT_DEPTHS = (2, 3, 4)
+DEFAULT_WINDOW = 64
+DEFAULT_THREADS = (1, 2, 4)
+PERCENTILES = (50.0, 90.0, 99.0, 99.9)
+
+
+def _random_path(rng, length, steps, width):
+    # the walk of auxiliaryfunct.random_path, each step one of the points of steps^width,
+    # drawn from rng rather than the random module
+    choices = list(itertools.product(steps, repeat=width))
+    return numpy.cumsum([rng.choice(choices) for _ in range(length)], axis=0)
+
+
+def make_workload(keys=DEFAULT_KEYS, ticks=DEFAULT_TICKS, widths=DEFAULT_WIDTHS,
+                  depths=DEFAULT_DEPTHS, window=DEFAULT_WINDOW, logsig_fraction=0.2,
+                  skew=1.0, seed=0):
+    """
+    The keys of the feed and the order of its ticks
+
+    Args:
+        keys (int): the number of keys
+        ticks (int): the number of ticks replayed
+        widths, depths: each key takes one of each at random
+        window (int): the rows of the rolling window of each key
+        logsig_fraction (float): the share of keys whose feature is a log signature
+        skew (float): the ticks of the key of rank r go as 1 / r^skew, 0 spreading them evenly
+        seed (int): the seed of the paths and of the order of the ticks
+
+    Returns:
+        a dict of the "width", "depth" and "kind" of each key, its "path", the window of
+        history it starts with followed by a row per tick, and "order", the key of each tick
+    """
+    rng = numpy.random.RandomState(seed)
+    steps = random.Random(seed)
+    weights = 1.0 / numpy.arange(1, keys + 1, dtype=numpy.float64) ** skew
+    order = rng.choice(keys, size=ticks, p=weights / weights.sum())
+    key_ticks = numpy.bincount(order, minlength=keys)
+    workload = {"window": window, "order": order, "width": [], "depth": [], "kind": [], "path": []}
+    for key in range(keys):
+        width = int(rng.choice(widths))
+        # unit steps, scaled for the window to stay of order one
+        path = numpy.asarray(_random_path(steps, window + int(key_ticks[key]), (-1, 0, 1), width),
+                             dtype=numpy.float64) / numpy.sqrt(window)
+        workload["width"].append(width)
+        workload["depth"].append(int(rng.choice(depths)))
+        workload["kind"].append("logsig" if rng.uniform() < logsig_fraction else "sig")
+        workload["path"].append(numpy.ascontiguousarray(path))
+    return workload
+
+
+def _feature(kind, stream, depth):
+    if kind == "sig":
+        return tosig.stream2sig(stream, depth)
+    return tosig.stream2logsig(stream, depth)
+
+
+def _replay_shard(workload, ticks, cursors, latest, latencies):
+    # the ticks of the keys of one shard, in order, timing each; stream2sig and stream2logsig
+    # let go of the GIL while they compute, so the shards run at once on as many cores
+    window = workload["window"]
+    for n, key in enumerate(ticks):
+        start = time.perf_counter()
+        cursors[key] += 1
+        stream = workload["path"][key][cursors[key] - window:cursors[key]]
+        latest[key] = _feature(workload["kind"][key], stream, workload["depth"][key])
+        latencies[n] = time.perf_counter() - start
+
+
+def _recompute(workload, cursors, threads):
+    """
+    The features of every key, from its window, a call of the ragged batch functions for
+    each width, depth and kind
+    """
+    window = workload["window"]
+    groups = {}
+    for key in range(len(cursors)):
+        group = (workload["width"][key], workload["depth"][key], workload["kind"][key])
+        groups.setdefault(group, []).append(key)
+    ans = {}
+    for (width, depth, kind), members in groups.items():
+        data = numpy.concatenate([workload["path"][key][cursors[key] - window:cursors[key]]
+                                  for key in members])
+        offsets = numpy.arange(0, window * (len(members) + 1), window, dtype=numpy.int64)
+        ragged = tosig.stream2sig_ragged if kind == "sig" else tosig.stream2logsig_ragged
+        for key, feature in zip(members, ragged(data, offsets, depth, num_threads=threads)):
+            ans[key] = feature
+    return ans
+
+
+def _percentiles(seconds):
+    seconds = numpy.asarray(seconds)
+    if seconds.size == 0:
+        return None
+    ans = {"p%g" % q: float(value) for q, value in zip(PERCENTILES, numpy.percentile(seconds, PERCENTILES))}
+    ans["max"] = float(seconds.max())
+    ans["mean"] = float(seconds.mean())
+    return ans
+
+
+def _native_percentiles():
+    # the tail latency of each entry point seen by tosig itself, without the window
+    if not hasattr(tosig, "get_latency_histograms"):
+        return None
+    from esig import latency
+    return {"%s/%d/%d" % key: dict(zip(("p%g" % q for q in PERCENTILES), map(float, values)))
+            for key, values in latency.percentiles(PERCENTILES).items()}
+
+
+def replay(workload, threads=1, batch_every=20000, rtol=1e-7, atol=1e-9):
+    """
+    Replay the ticks of workload on threads threads, the keys being shared out over
+    them by key modulo threads, with a batch recompute of every key, on as many threads,
+    after each batch_every ticks and at the end
+
+    Returns:
+        a dict, ready for json, of the throughput, the latency of the ticks overall and
+        by kind and depth, that of the batch recomputes, that seen by the native entry
+        points when they keep latency histograms, and whether the batches agreed with
+        the ticks
+    """
+    order = workload["order"]
+    keys = len(workload["path"])
+    cursors = [workload["window"]] * keys
+    latest = [None] * keys
+    latencies = numpy.zeros(len(order))
+    batch_seconds = []
+    agrees = True
+    max_abs_difference = 0.0
+    recording = tosig.set_latency_recording(True) if hasattr(tosig, "set_latency_recording") else None
+    if recording is not None:
+        tosig.reset_latency_histograms()
+
+    online = 0.0
+    began = time.perf_counter()
+    for first in range(0, len(order), max(batch_every, 1)):
+        epoch = numpy.arange(first, min(first + max(batch_every, 1), len(order)))
+        shards = [epoch[order[epoch] % threads == t] for t in range(threads)]
+        shard_latencies = [numpy.zeros(len(shard)) for shard in shards]
+        workers = [threading.Thread(target=_replay_shard,
+                                    args=(workload, order[shard], cursors, latest, shard_latency))
+                   for shard, shard_latency in zip(shards, shard_latencies)]
+        start = time.perf_counter()
+        for worker in workers:
+            worker.start()
+        for worker in workers:
+            worker.join()
+        online += time.perf_counter() - start
+        for shard, shard_latency in zip(shards, shard_latencies):
+            latencies[shard] = shard_latency
+
+        start = time.perf_counter()
+        batch = _recompute(workload, cursors, threads)
+        batch_seconds.append(time.perf_counter() - start)
+        for key, feature in batch.items():
+            if latest[key] is None:
+                continue
+            difference = float(numpy.max(numpy.abs(feature - latest[key])))
+            max_abs_difference = max(max_abs_difference, difference)
+            agrees = agrees and bool(numpy.allclose(feature, latest[key], rtol=rtol, atol=atol))
+    elapsed = time.perf_counter() - began
+
+    tick_kinds = numpy.array(workload["kind"])[order]
+    tick_depths = numpy.array(workload["depth"])[order]
+    by_shape = {"%s/%d" % (kind, depth): _percentiles(latencies[(tick_kinds == kind) & (tick_depths == depth)])
+                for kind, depth in sorted(set(zip(workload["kind"], workload["depth"])))}
+    native = _native_percentiles() if recording is not None else None
+    if recording is not None:
+        tosig.set_latency_recording(recording)
+
+    return {
+        "threads": threads,
+        "ticks": len(order),
+        "batches": len(batch_seconds),
+        "seconds": elapsed,
+        "ticks_per_second": len(order) / elapsed,
+        "online_ticks_per_second": len(order) / online,
+        "tick_seconds": _percentiles(latencies),
+        "tick_seconds_by_kind_and_depth": by_shape,
+        "batch_seconds": _percentiles(batch_seconds),
+        "native_seconds": native,
+        "agrees": agrees,
+        "max_abs_difference": max_abs_difference,
+    }
+
+
+def run(thread_counts=DEFAULT_THREADS, batch_every=20000, log=None, **workload_options):
+    """
+    Make a workload with make_workload(**workload_options) and replay it on each number
+    of threads in thread_counts
+
+    Returns:
+        a dict, ready for json, of the workload, the environment and a run per number of
+        threads, as returned by replay
+    """
+    workload = make_workload(**workload_options)
+    runs = []
+    for threads in thread_counts:
+        result = replay(workload, threads, batch_every)
+        runs.append(result)
+        if log is not None:
+            log.write("tick_replay: %2d threads: %10.1f ticks/s, p99 %.3f ms, batch p50 %.3f ms%s\n" % (
+                threads, result["ticks_per_second"], 1e3 * result["tick_seconds"]["p99"],
+                1e3 * result["batch_seconds"]["p50"], "" if result["agrees"] else "  DISAGREES"))
+    return {
+        "keys": len(workload["path"]),
+        "ticks": len(workload["order"]),
+        "window": workload["window"],
+        "batch_every": batch_every,
+        "workload": dict(workload_options),
+        "python": platform.python_version(),
+        "numpy": numpy.__version__,
+        "machine": platform.machine(),
+        "system": platform.system(),
+        "kernels": tosig.get_kernels(),
+        "runs": runs,
+    }
+
+
+def _int_list(text):
+    return tuple(int(item) for item in text.split(",") if item)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        prog="python -m esig.tick_replay",
+        description="Replay a synthetic feed of ticks through tosig on each number of threads")
+    parser.add_argument("--keys", type=int, default=DEFAULT_KEYS)
+    parser.add_argument("--ticks", type=int, default=DEFAULT_TICKS)
+    parser.add_argument("--widths", type=_int_list, default=DEFAULT_WIDTHS)
+    parser.add_argument("--depths", type=_int_list, default=DEFAULT_DEPTHS)
+    parser.add_argument("--window", type=int, default=DEFAULT_WINDOW,
+                        help="the rows of the rolling window of each key")
+    parser.add_argument("--logsig-fraction", type=float, default=0.2,
+                        help="the share of keys whose feature is a log signature")
+    parser.add_argument("--skew", type=float, default=1.0,
+                        help="the ticks of the key of rank r go as 1 / r^skew")
+    parser.add_argument("--batch-every", type=int, default=20000,
+                        help="the ticks between batch recomputes of every key")
+    parser.add_argument("--threads", type=_int_list, default=DEFAULT_THREADS)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--output", default=None,
+                        help="write the JSON results to this file rather than stdout")
+    args = parser.parse_args(argv)
+
+    results = run(args.threads, args.batch_every, log=sys.stderr, keys=args.keys, ticks=args.ticks,
+                  widths=args.widths, depths=args.depths, window=args.window,
+                  logsig_fraction=args.logsig_fraction, skew=args.skew, seed=args.seed)
+    if args.output is None:
+        json.dump(results, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+    else:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    return 0 if all(result["agrees"] for result in results["runs"]) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
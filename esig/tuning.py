@@ -0,0 +1,345 @@
+# Choosing how to compute each signature from a cost model calibrated on this host
+#
+#   import esig
+#   esig.tune()                  # once: time the methods and save the calibration
+#   esig.set_backend("auto")     # in this process or any later one, which loads it
+
+import json
+import math
+import numbers
+import os
+import platform
+import time
+import warnings
+
+import numpy
+
+from esig import backends
+from esig.backends import LibalgebraBackend, tosig, iisignature
+
+
+CALIBRATION_VERSION = 1
+
+# the terms of the cost model: a fixed cost, one per coordinate of the
+# signature, one per row of the stream and one per row and coordinate
+FEATURES = ("call", "size", "rows", "rows_size")
+
+DEFAULT_WIDTHS = (2, 3, 5, 8)
+DEFAULT_DEPTHS = (2, 3, 4, 5)
+DEFAULT_LENGTHS = (10, 100, 1000, 10000)
+# the grid leaves out shapes with more cells than this, rows times signature size
+DEFAULT_MAX_CELLS = 1 << 24
+
+
+def default_calibration_path():
+    """
+    Where tune() saves the calibration and where esig looks for it on import:
+    the environment variable ESIG_CALIBRATION if it is set, and otherwise
+    ~/.esig/calibration.json
+    """
+    path = os.environ.get("ESIG_CALIBRATION")
+    if path:
+        return path
+    return os.path.join(os.path.expanduser("~"), ".esig", "calibration.json")
+
+
+def _sig_size(width, depth):
+    return sum(width ** k for k in range(depth + 1))
+
+
+def _features(width, depth, rows):
+    size = _sig_size(width, depth)
+    return (1.0, float(size), float(rows), float(rows) * size)
+
+
+def _chunked_log_signature(stream, depth):
+    sig = tosig.stream2sig(stream, depth, num_threads=0)
+    return tosig.sig2logsig(sig, stream.shape[1], depth)
+
+
+def _methods():
+    """
+    The ways of computing each kind of answer, by kind and name; all of them
+    give the same coordinates in the same order, so any may stand in for another
+    """
+    methods = {
+        "sig": {
+            "serial": lambda stream, depth: tosig.stream2sig(stream, depth),
+            "chunked": lambda stream, depth: tosig.stream2sig(stream, depth, num_threads=0),
+        },
+        "logsig": {
+            "serial": lambda stream, depth: tosig.stream2logsig(stream, depth),
+            "chunked": _chunked_log_signature,
+        },
+    }
+    if iisignature is not None:
+        # iisignature's log signatures use another basis, so only its signatures are candidates
+        methods["sig"]["iisignature"] = lambda stream, depth: numpy.concatenate(
+            [[1.0], iisignature.sig(stream, depth)], axis=0)
+    return methods
+
+
+METHODS = _methods()
+
+
+def _fit(features, times):
+    """
+    The least squares coefficients of the cost model, none of them negative:
+    a term whose coefficient comes out negative is dropped and the rest refitted
+    """
+    rows = numpy.asarray(features, dtype=numpy.float64)
+    times = numpy.asarray(times, dtype=numpy.float64)
+    # relative errors matter, so each sample is scaled by its time
+    scale = 1.0 / numpy.maximum(times, 1e-9)
+    active = list(range(rows.shape[1]))
+    while active:
+        coefficients = numpy.linalg.lstsq(rows[:, active] * scale[:, None], times * scale,
+                                          rcond=None)[0]
+        if numpy.all(coefficients >= 0.0):
+            ans = [0.0] * rows.shape[1]
+            for term, coefficient in zip(active, coefficients):
+                ans[term] = float(coefficient)
+            return ans
+        del active[int(numpy.argmin(coefficients))]
+    return [0.0] * rows.shape[1]
+
+
+def _time_call(fn, stream, depth, min_time, min_repeats):
+    fn(stream, depth)
+    times = []
+    while len(times) < min_repeats or sum(times) < min_time:
+        start = time.perf_counter()
+        fn(stream, depth)
+        times.append(time.perf_counter() - start)
+    return min(times)
+
+
+def tune(path=None, widths=DEFAULT_WIDTHS, depths=DEFAULT_DEPTHS, lengths=DEFAULT_LENGTHS,
+         max_cells=DEFAULT_MAX_CELLS, min_time=0.02, min_repeats=3, seed=0, log=None):
+    """
+    Time every method of computing signatures and log signatures on random
+    walks over a grid of shapes, fit the cost model of each method and save
+    the calibration, which the "auto" backend then uses to pick the cheapest
+    method for each call. Processes started later load the calibration on
+    import, but use it only once they call set_backend("auto").
+
+    Args:
+        path: where to save the calibration, by default default_calibration_path()
+        widths, depths, lengths: the grid of the micro-benchmarks
+        max_cells (int): shapes with more rows times signature coordinates are skipped
+        min_time (float): the least time in seconds spent timing each method on each shape
+        min_repeats (int): the fewest timed calls of each method on each shape
+        seed (int): the seed of the random walks
+        log: a file receiving a line per shape as it is timed, or None
+
+    Returns:
+        the calibration, as saved
+    """
+    # imported here as esig.bench imports esig.backends, as this module does
+    from esig.bench import make_streams
+
+    methods = METHODS
+    samples = {kind: {name: ([], []) for name in methods[kind]} for kind in methods}
+    for width in widths:
+        for depth in depths:
+            for length in lengths:
+                if length * _sig_size(width, depth) > max_cells:
+                    continue
+                stream = make_streams(width, length, 1, seed)[0]
+                features = _features(width, depth, length)
+                for kind in methods:
+                    for name, fn in methods[kind].items():
+                        try:
+                            seconds = _time_call(fn, stream, depth, min_time, min_repeats)
+                        except Exception:
+                            continue
+                        samples[kind][name][0].append(features)
+                        samples[kind][name][1].append(seconds)
+                if log is not None:
+                    log.write("esig.tune: width %d depth %d length %d\n" % (width, depth, length))
+
+    calibration = {
+        "version": CALIBRATION_VERSION,
+        "esig": _esig_version(),
+        "machine": platform.machine(),
+        "system": platform.system(),
+        "threads": tosig.get_num_threads(),
+        "kernels": tosig.get_kernels(),
+        "features": list(FEATURES),
+        "models": {
+            kind: {name: _fit(features, times) for name, (features, times) in samples[kind].items()
+                   if features}
+            for kind in samples
+        },
+    }
+
+    if path is None:
+        path = default_calibration_path()
+    directory = os.path.dirname(path)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    with open(path, "w") as f:
+        json.dump(calibration, f, indent=2)
+    set_calibration(calibration)
+    return calibration
+
+
+def _esig_version():
+    from esig import get_version
+    return get_version()
+
+
+_CALIBRATION = None
+
+
+def get_calibration():
+    """
+    The calibration the "auto" backend uses, or None before one is loaded
+    """
+    return _CALIBRATION
+
+
+def _is_count(value):
+    return isinstance(value, numbers.Integral) and not isinstance(value, bool) and value > 0
+
+
+def _is_coefficient(value):
+    return (isinstance(value, numbers.Real) and not isinstance(value, bool)
+            and math.isfinite(value) and value >= 0.0)
+
+
+def _validate(calibration):
+    """
+    Raise ValueError unless calibration is a dict of the version and cost
+    model of this esig, whose models map each kind to a dict of methods, each
+    a list of one non-negative number per term of the model, and whose
+    threads, if given, is a positive integer
+    """
+    if not isinstance(calibration, dict):
+        raise ValueError("a calibration is a dict, not %s" % type(calibration).__name__)
+    if calibration.get("version") != CALIBRATION_VERSION:
+        raise ValueError("unsupported calibration version %r" % calibration.get("version"))
+    features = calibration.get("features", ())
+    if not isinstance(features, (list, tuple)) or list(features) != list(FEATURES):
+        raise ValueError("the calibration does not use the cost model of this version of esig")
+    if "threads" in calibration and not _is_count(calibration["threads"]):
+        raise ValueError("the threads of a calibration must be a positive integer, not %r"
+                         % (calibration["threads"],))
+    models = calibration.get("models")
+    if not isinstance(models, dict):
+        raise ValueError("the models of a calibration must be a dict")
+    for kind, methods in models.items():
+        if not isinstance(methods, dict):
+            raise ValueError("the models of %r must be a dict of methods" % (kind,))
+        for name, coefficients in methods.items():
+            if (not isinstance(coefficients, (list, tuple)) or len(coefficients) != len(FEATURES)
+                    or not all(_is_coefficient(c) for c in coefficients)):
+                raise ValueError("the model of %r for %r must be %d non-negative numbers"
+                                 % (name, kind, len(FEATURES)))
+
+
+def set_calibration(calibration):
+    """
+    Make the "auto" backend use calibration, a dict as returned by tune();
+    None makes it compute every answer as the libalgebra backend does.
+    Raises ValueError, leaving the calibration in use as it was, if
+    calibration is not of that form
+    """
+    global _CALIBRATION
+    if calibration is not None:
+        _validate(calibration)
+    _CALIBRATION = calibration
+    AutoBackend._choices.clear()
+
+
+def load_calibration(path=None):
+    """
+    Load the calibration saved by tune() from path, by default
+    default_calibration_path()
+
+    Returns:
+        the calibration, or None if there is no file at path
+
+    Raises:
+        OSError if the file cannot be read, ValueError if it does not hold a
+        calibration
+    """
+    if path is None:
+        path = default_calibration_path()
+    if not os.path.exists(path):
+        return None
+    with open(path) as f:
+        calibration = json.load(f)
+    set_calibration(calibration)
+    return calibration
+
+
+def _threads_differ():
+    """
+    Whether the thread pool has another number of threads than when the
+    calibration was timed; the chunked methods share out their rows among the
+    threads, so their timings say nothing of another pool size
+    """
+    threads = _CALIBRATION.get("threads")
+    return threads is not None and threads != tosig.get_num_threads()
+
+
+def choose(kind, width, depth, rows):
+    """
+    The name of the method the calibration predicts is fastest for a stream
+    of rows rows and width columns to depth, "serial" without a calibration
+    or if it was timed with another number of threads than the pool has now
+    """
+    if _CALIBRATION is None:
+        return "serial"
+    if _threads_differ():
+        warnings.warn("esig: ignoring the calibration, timed on %d threads, as the pool has %d;"
+                      " run esig.tune() again" % (_CALIBRATION["threads"], tosig.get_num_threads()),
+                      RuntimeWarning)
+        return "serial"
+    models = _CALIBRATION["models"].get(kind, {})
+    available = METHODS[kind]
+    features = _features(width, depth, rows)
+    best, best_cost = "serial", None
+    for name, coefficients in models.items():
+        if name not in available:
+            continue
+        cost = sum(c * x for c, x in zip(coefficients, features))
+        if best_cost is None or cost < best_cost:
+            best, best_cost = name, cost
+    return best
+
+
+class AutoBackend(LibalgebraBackend):
+    """
+    Computes each signature and log signature by the method the calibration
+    of tune() predicts is fastest for its shape; the keys, and so the log
+    signatures, are those of the libalgebra backend
+    """
+
+    # the method chosen for each kind, width, depth, power of two of rows and
+    # number of threads of the pool
+    _choices = {}
+
+    def __repr__(self):
+        return "AutoBackend"
+
+    def _method(self, kind, stream, depth):
+        rows, width = stream.shape
+        bucket = (kind, width, depth, rows.bit_length(), tosig.get_num_threads())
+        name = self._choices.get(bucket)
+        if name is None:
+            name = self._choices[bucket] = choose(kind, width, depth, rows)
+        return METHODS[kind][name]
+
+    def compute_signature(self, stream, depth, num_threads=1, min_chunk_rows=None):
+        if num_threads != 1 or min_chunk_rows is not None:
+            # the caller asked for a way of computing it
+            return super().compute_signature(stream, depth, num_threads, min_chunk_rows)
+        return self._method("sig", stream, depth)(stream, depth)
+
+    def compute_log_signature(self, stream, depth):
+        return self._method("logsig", stream, depth)(stream, depth)
+
+
+backends.BACKENDS["auto"] = AutoBackend
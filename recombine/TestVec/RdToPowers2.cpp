@@ -9,7 +9,9 @@
 #include <algorithm>
 #include <functional>
 #include <valarray>
-//#include <omp.h>
+#include "Memory.h"               // sigcore::counted_allocate
+#include "ThreadPool.h"           // sigcore::parallel_for
+#include "Trace.h"                // sigcore::scoped_trace_event
 
 
 typedef double SCA;
@@ -27,6 +29,25 @@ prodsswitch prodmethod = prodsswitch::Prods_cheb;
 
 namespace 
 {
+	// a work buffer of n SCAs from the allocator hooks of sigcore, which count it
+	class counted_buffer
+	{
+		sigcore::allocator_hooks hooks;
+		size_t bytes;
+		SCA* data;
+
+		counted_buffer(const counted_buffer&);
+		counted_buffer& operator=(const counted_buffer&);
+	public:
+		explicit counted_buffer(size_t n)
+			: hooks(sigcore::get_allocator_hooks()), bytes(n * sizeof(SCA))
+			, data(static_cast<SCA*>(sigcore::counted_allocate(bytes, hooks)))
+		{
+		}
+		~counted_buffer() { sigcore::counted_deallocate(data, bytes, hooks); }
+		SCA& operator[](size_t i) { return data[i]; }
+	};
+
 	// the number of commutative monomials of degree D in L letters //Product[(j + D)/j, {j, 1, L - 1}]
 	size_t f(const size_t L, const size_t D)
 	{
@@ -395,7 +416,7 @@ void RdToPowers(void* pIn, SCA* pOut, void* vpCBufferHelper)
 	//void** pVoidIn = (void**)pIn; // a pointer to the first element of an array of null pointers
 
 	std::vector<SCA> MAX(L, 0.), MIN(L, 0.), rescaled(L, 0.);
-	std::valarray<SCA> buffer(0., L * no_of_locations);
+	counted_buffer buffer(L * no_of_locations);
 	size_t j(0);
 
 	for ( void** pVoidIn = (void**)pIn; pVoidIn < (void**)pIn + no_of_locations; ++pVoidIn)
@@ -410,22 +431,28 @@ void RdToPowers(void* pIn, SCA* pOut, void* vpCBufferHelper)
 	}	
 	SCA* pOutBegin(pOut);		
 
-#pragma omp parallel for
-	for (ptrdiff_t j = 0; j < ptrdiff_t(no_of_locations); ++j)
+	// the locations are independent, so they are shared out over esig's thread pool, in
+	// a few contiguous blocks per thread, each a task of the trace
+	const size_t blocks = std::min(no_of_locations, 4 * sigcore::get_num_threads());
+	sigcore::parallel_for(blocks, [&](size_t block)
 	{
-		SCA* now = pOutBegin + j * depth_of_vector;
-		if(D==1)
-		{
-			now[0] = 1.;
-			for (size_t i = 0; i < L; ++i)
-				now[1 + i] = ((MAX[i] - MIN[i]) == 0.) ? 0. : (2 * buffer[i + L * j] - (MIN[i] + MAX[i])) / (MAX[i] - MIN[i]);
-		}
-		else
+		sigcore::scoped_trace_event trace("RdToPowers", (long long) block);
+		for (size_t j = no_of_locations * block / blocks; j < no_of_locations * (block + 1) / blocks; ++j)
 		{
-			for (size_t i = 0; i < L; ++i)
-				buffer[i + L * j] = ((MAX[i] - MIN[i]) == 0.) ? 0. : (2 * buffer[i + L * j] - (MIN[i] + MAX[i])) / (MAX[i] - MIN[i]);
-			prods(now, SCA(1), 0, D, &buffer[L * j], &buffer[L * j] + L);
+			SCA* now = pOutBegin + j * depth_of_vector;
+			if(D==1)
+			{
+				now[0] = 1.;
+				for (size_t i = 0; i < L; ++i)
+					now[1 + i] = ((MAX[i] - MIN[i]) == 0.) ? 0. : (2 * buffer[i + L * j] - (MIN[i] + MAX[i])) / (MAX[i] - MIN[i]);
+			}
+			else
+			{
+				for (size_t i = 0; i < L; ++i)
+					buffer[i + L * j] = ((MAX[i] - MIN[i]) == 0.) ? 0. : (2 * buffer[i + L * j] - (MIN[i] + MAX[i])) / (MAX[i] - MIN[i]);
+				prods(now, SCA(1), 0, D, &buffer[L * j], &buffer[L * j] + L);
+			}
 		}
-	}
+	});
 	pOutBegin += no_of_locations * depth_of_vector;
 }
@@ -3,6 +3,7 @@
 #include "TestVec/RdToPowers.h" // CMultiDimensionalBufferHelper
 #include "TestVec/EvaluateAllMonomials.h" //EvaluateAllMonomials::F
 #include "_recombine.h"
+#include "Memory.h" // sigcore::external_bytes
 #include <vector>
 
 void _recombineC(size_t stCubatureDegree, ptrdiff_t dimension, ptrdiff_t no_locations, ptrdiff_t* pno_kept_locations, const void** ppLocationBuffer, double* pdWeightBuffer, size_t* KeptLocations, double* NewWeights)
@@ -64,6 +65,9 @@ void _recombineC(size_t stCubatureDegree, ptrdiff_t dimension, ptrdiff_t no_loca
 	data.fn = &RdToPowers;
 
 	{
+		// the library expands the points into a matrix of a vector of monomials per point,
+		// which the memory accounting of sigcore counts by its size while the library runs
+		sigcore::external_bytes expansion(size_t(no_locations) * iNoDimensionsToCubature * sizeof(double));
 		// CALL THE LIBRARY THAT DOES THE HEAVYLIFTING
 		Recombine(&data);
 	}
@@ -0,0 +1,364 @@
+// recombine_bench.cpp : command line benchmark of the stages of recombine, as driven by
+// _recombineC: the expansion of points into the vectors of their monomials by RdToPowers,
+// the prods kernel behind it in each of its prodsswitch variants, and the Recombine solve
+//
+// usage: recombine_bench [-l dimensions] [-g degrees] [-n points] [-s seconds] [-m monomials] [-o output.json]
+//
+// The points are drawn uniformly from [-1, 1]^dimension with equal weights. Each stage is
+// timed until it has run for the given number of seconds and at least min_repeats times;
+// the Recombine stage also reports how much of its time went on calls of RdToPowers, the
+// rest being the solve, whose cost grows as D^degree * N + D^(degree*3) * log(N/D^degree).
+// The results are written as JSON to output.json, or to stdout; progress goes to stderr.
+//
+#include "recombine/recombine.h"
+#include "TestVec/RdToPowers.h"          // CMultiDimensionalBufferHelper
+#include "TestVec/RdToPowers2.h"         // prods prodsswitch prodmethod
+#include "TestVec/recombine_helper_fn.h" // CBufferHelper
+#include "TestVec/EvaluateAllMonomials.h" // EvaluateAllMonomials::F
+#include "ThreadPool.h"                  // sigcore::get_num_threads
+#include "BenchSupport.h"                // bench::parse_sizes bench::write_output
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+	const char usage[] =
+		"usage: recombine_bench [-l dimensions] [-g degrees] [-n points] [-s seconds] [-m monomials] [-o output.json]\n"
+		"  -l dimensions  comma separated dimensions of the points (default 1,2,4,8)\n"
+		"  -g degrees     comma separated cubature degrees (default 1,2,3,4)\n"
+		"  -n points      comma separated numbers of points (default 1000,10000,100000)\n"
+		"  -s seconds     the least time spent on each stage of a case (default 0.2)\n"
+		"  -m monomials   skip cases with more monomials than this (default 500)\n"
+		"  -o file        write the JSON results to file rather than stdout\n";
+
+	// the fewest calls timed in a stage
+	const size_t min_repeats = 3;
+
+	typedef std::chrono::steady_clock clock;
+
+  /**
+   * prods_variant - a value of prodsswitch with its name in the output
+   */
+	struct prods_variant
+	{
+		prodsswitch method;
+		const char* name;
+	};
+
+	const prods_variant prods_variants[] = {
+		{ Prods2, "Prods2" },
+		{ Prods_test, "Prods_test" },
+		{ Prods_nonrecursive3, "Prods_nonrecursive3" },
+		{ Prods_nonrecursive2, "Prods_nonrecursive2" },
+		{ Prods_nonrecursive, "Prods_nonrecursive" },
+		{ Prods_wei1, "Prods_wei1" },
+		{ Prods_cheb, "Prods_cheb" },
+		{ Prods, "Prods" }
+	};
+
+  /**
+   * stage_timing - the calls of one stage of a case and the time they took
+   */
+	struct stage_timing
+	{
+		std::string stage;
+		std::string variant;
+		size_t repeats;
+		double total_seconds;
+		double p50, min, max;
+		// Recombine only: the time spent in RdToPowers and the points kept by the last call
+		double expander_seconds;
+		size_t kept_points;
+		// prods only: whether the variant wrote one value for each monomial
+		bool complete;
+		std::string skipped;
+
+		stage_timing() : repeats(0), total_seconds(0.), p50(0.), min(0.), max(0.),
+			expander_seconds(0.), kept_points(0), complete(true)
+		{
+		}
+	};
+
+  /**
+   * bench_case - one point of the grid and its stages
+   */
+	struct bench_case
+	{
+		size_t dimension;
+		size_t degree;
+		size_t points;
+		size_t monomials;
+		std::vector<stage_timing> stages;
+	};
+
+  /**
+   * time_stage - calls fn until it has run for seconds and min_repeats times, after one
+   * untimed call, and fills in the timings of ans
+   */
+	template <class FN>
+	void time_stage(stage_timing& ans, double seconds, FN fn)
+	{
+		fn();
+		std::vector<double> latencies;
+		double total = 0.;
+		while (latencies.size() < min_repeats || total < seconds) {
+			const clock::time_point start = clock::now();
+			fn();
+			const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			latencies.push_back(elapsed);
+			total += elapsed;
+		}
+		std::sort(latencies.begin(), latencies.end());
+		ans.repeats = latencies.size();
+		ans.total_seconds = total;
+		ans.p50 = bench::percentile(latencies, 0.5);
+		ans.min = latencies.front();
+		ans.max = latencies.back();
+	}
+
+	// the time spent in RdToPowers by the Recombine call under way
+	double expander_seconds = 0.;
+
+	// RdToPowers, timed, as the expander of the Recombine stage
+	void timed_rd_to_powers(void* pIn, double* pOut, void* vpCBufferHelper)
+	{
+		const clock::time_point start = clock::now();
+		RdToPowers(pIn, pOut, vpCBufferHelper);
+		expander_seconds += std::chrono::duration<double>(clock::now() - start).count();
+	}
+
+  /**
+   * recombine_points - what _recombineC does with its buffers, with the expander timed
+   * @return the number of points kept
+   */
+	size_t recombine_points(size_t degree, size_t dimension, size_t monomials, std::vector<const void*>& locations,
+		std::vector<double>& weights, std::vector<size_t>& kept, std::vector<double>& new_weights)
+	{
+		CMultiDimensionalBufferHelper conditioning;
+		conditioning.D = degree;
+		conditioning.L = dimension;
+
+		sCloud in;
+		in.end = &conditioning;
+		in.NoActiveWeightsLocations = locations.size();
+		in.LocationBuf = &locations[0];
+		in.WeightBuf = &weights[0];
+
+		sRCloudInfo out;
+		out.end = 0;
+		out.KeptLocations = &kept[0];
+		out.NewWeightBuf = &new_weights[0];
+		out.No_KeptLocations = monomials;
+
+		sRecombineInterface data;
+		data.end = 0;
+		data.pInCloud = &in;
+		data.pOutCloudInfo = &out;
+		data.degree = monomials;
+		data.fn = &timed_rd_to_powers;
+
+		Recombine(&data);
+		return data.pOutCloudInfo->No_KeptLocations;
+	}
+
+	bench_case run_case(size_t dimension, size_t degree, size_t points, double seconds)
+	{
+		bench_case ans;
+		ans.dimension = dimension;
+		ans.degree = degree;
+		ans.points = points;
+		ans.monomials = EvaluateAllMonomials::F(dimension, degree);
+
+		std::vector<double> coordinates(points * dimension);
+		std::mt19937 engine(unsigned(dimension * 1000003 + degree * 1009 + points));
+		std::uniform_real_distribution<double> uniform(-1., 1.);
+		for (size_t i = 0; i < coordinates.size(); ++i)
+			coordinates[i] = uniform(engine);
+		std::vector<const void*> locations(points);
+		for (size_t j = 0; j < points; ++j)
+			locations[j] = &coordinates[j * dimension];
+		std::vector<double> weights(points, 1. / double(points));
+		std::vector<double> expansion(points * ans.monomials);
+
+		const prodsswitch default_method = prodmethod;
+
+		// the whole expansion, as recombine asks for it, with the prods of the build
+		{
+			CMultiDimensionalBufferHelper conditioning;
+			conditioning.D = degree;
+			conditioning.L = dimension;
+			CBufferHelper helper;
+			helper.SmallestReducibleSetSize = ans.monomials + 1;
+			helper.NoPointsToBeprocessed = points;
+			helper.pvCConditioning = &conditioning;
+			stage_timing stage;
+			stage.stage = "RdToPowers";
+			for (size_t v = 0; v < sizeof(prods_variants) / sizeof(prods_variants[0]); ++v)
+				if (prods_variants[v].method == default_method)
+					stage.variant = prods_variants[v].name;
+			time_stage(stage, seconds, [&]() {
+				RdToPowers(&locations[0], &expansion[0], &helper);
+			});
+			ans.stages.push_back(stage);
+		}
+
+		// each variant of prods on its own, point by point on one thread; the points are
+		// already in [-1, 1], as RdToPowers rescales them
+		for (size_t v = 0; v < sizeof(prods_variants) / sizeof(prods_variants[0]); ++v) {
+			stage_timing stage;
+			stage.stage = "prods";
+			stage.variant = prods_variants[v].name;
+			if (prods_variants[v].method == Prods2 && dimension != 4) {
+				stage.skipped = "Prods2 is compiled for dimension 4 only";
+			} else if ((prods_variants[v].method == Prods_nonrecursive3
+				|| prods_variants[v].method == Prods_nonrecursive2) && dimension >= 20) {
+				stage.skipped = "dimension 20 or more overflows its state";
+			} else {
+				prodmethod = prods_variants[v].method;
+				double* first_end = NULL;
+				time_stage(stage, seconds, [&]() {
+					for (size_t j = 0; j < points; ++j) {
+						double* now = &expansion[j * ans.monomials];
+						prods(now, 1., 0, degree, &coordinates[j * dimension], &coordinates[j * dimension] + dimension);
+						if (j == 0)
+							first_end = now;
+					}
+				});
+				stage.complete = first_end == &expansion[0] + ans.monomials;
+				prodmethod = default_method;
+			}
+			ans.stages.push_back(stage);
+		}
+
+		// the solve, with the time spent in the expander it calls separated out
+		{
+			std::vector<size_t> kept(ans.monomials);
+			std::vector<double> new_weights(ans.monomials);
+			stage_timing stage;
+			stage.stage = "Recombine";
+			stage.variant = ans.stages.front().variant;
+			size_t calls = 0;
+			time_stage(stage, seconds, [&]() {
+				stage.kept_points = recombine_points(degree, dimension, ans.monomials, locations, weights, kept, new_weights);
+				// the expander time of the untimed first call is not counted
+				if (calls++ == 0)
+					expander_seconds = 0.;
+			});
+			stage.expander_seconds = expander_seconds;
+			ans.stages.push_back(stage);
+		}
+		return ans;
+	}
+
+	void write_json(std::ostream& out, const std::vector<bench_case>& cases, double seconds)
+	{
+		out.precision(9);
+		out << "{\n  \"tool\": \"recombine_bench\",\n  \"threads\": " << sigcore::get_num_threads()
+			<< ",\n  \"min_seconds\": " << seconds << ",\n  \"cases\": [";
+		for (size_t i = 0; i < cases.size(); ++i) {
+			const bench_case& c = cases[i];
+			out << (i > 0 ? "," : "") << "\n    {\"dimension\": " << c.dimension << ", \"degree\": " << c.degree
+				<< ", \"points\": " << c.points << ", \"monomials\": " << c.monomials << ", \"stages\": [";
+			for (size_t s = 0; s < c.stages.size(); ++s) {
+				const stage_timing& t = c.stages[s];
+				out << (s > 0 ? "," : "") << "\n      {\"stage\": \"" << t.stage << "\", \"variant\": \"" << t.variant << "\"";
+				if (!t.skipped.empty()) {
+					out << ", \"skipped\": \"" << t.skipped << "\"}";
+					continue;
+				}
+				const double mean = t.total_seconds / double(t.repeats);
+				out << ", \"repeats\": " << t.repeats
+					<< ", \"points_per_second\": " << double(c.points) / mean
+					<< ", \"latency_seconds\": {\"mean\": " << mean << ", \"min\": " << t.min
+					<< ", \"p50\": " << t.p50 << ", \"max\": " << t.max << "}";
+				if (t.stage == "prods")
+					out << ", \"complete\": " << (t.complete ? "true" : "false");
+				if (t.stage == "Recombine")
+					out << ", \"expander_seconds\": " << t.expander_seconds / double(t.repeats)
+						<< ", \"solve_seconds\": " << (t.total_seconds - t.expander_seconds) / double(t.repeats)
+						<< ", \"kept_points\": " << t.kept_points;
+				out << "}";
+			}
+			out << "\n    ]}";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	int run(int argc, char** argv)
+	{
+		std::vector<size_t> dimensions, degrees, counts;
+		double seconds = 0.2;
+		size_t max_monomials = 500;
+		std::string output;
+		for (int arg = 1; arg < argc; ++arg) {
+			const std::string option(argv[arg]);
+			if (arg + 1 >= argc)
+				throw std::invalid_argument("unknown option " + option);
+			const std::string value(argv[++arg]);
+			if (option == "-l") {
+				dimensions = bench::parse_sizes(value, "dimension");
+			} else if (option == "-g") {
+				degrees = bench::parse_sizes(value, "degree");
+			} else if (option == "-n") {
+				counts = bench::parse_sizes(value, "number of points");
+			} else if (option == "-s") {
+				seconds = atof(value.c_str());
+			} else if (option == "-m") {
+				max_monomials = bench::parse_size(value, "number of monomials");
+			} else if (option == "-o") {
+				output = value;
+			} else {
+				throw std::invalid_argument("unknown option " + option);
+			}
+		}
+		if (dimensions.empty()) {
+			const size_t defaults[] = { 1, 2, 4, 8 };
+			dimensions.assign(defaults, defaults + 4);
+		}
+		if (degrees.empty()) {
+			const size_t defaults[] = { 1, 2, 3, 4 };
+			degrees.assign(defaults, defaults + 4);
+		}
+		if (counts.empty()) {
+			const size_t defaults[] = { 1000, 10000, 100000 };
+			counts.assign(defaults, defaults + 3);
+		}
+
+		std::vector<bench_case> cases;
+		for (size_t l = 0; l < dimensions.size(); ++l)
+			for (size_t g = 0; g < degrees.size(); ++g) {
+				const size_t dimension = dimensions[l], degree = degrees[g];
+				const size_t monomials = EvaluateAllMonomials::F(dimension, degree);
+				if (monomials > max_monomials) {
+					std::cerr << "recombine_bench: skipping dimension " << dimension << " degree " << degree
+						<< ", its " << monomials << " monomials exceed -m\n";
+					continue;
+				}
+				for (size_t n = 0; n < counts.size(); ++n) {
+					cases.push_back(run_case(dimension, degree, counts[n], seconds));
+					const stage_timing& solve = cases.back().stages.back();
+					std::cerr << "recombine_bench: dimension " << dimension << " degree " << degree
+						<< " points " << counts[n] << ": Recombine p50 " << solve.p50 * 1e3 << " ms, "
+						<< solve.kept_points << " points kept\n";
+				}
+			}
+
+		bench::write_output(output, [&](std::ostream& out) { write_json(out, cases, seconds); });
+		return 0;
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	return bench::run_tool("recombine_bench", usage, run, argc, argv);
+}
@@ -35,7 +35,7 @@ class BuildExtensionCommand(build_ext):
             None
         """
         print("Running extra esig pre-build commands...")
-        print("Building switch.h")
+        print("Building switch.h, shape_switch.h and shape_ranges.h")
         SWITCH_GEN.write_file()
         print("Done")
 
@@ -56,12 +56,33 @@ if not configuration.no_recombine and configuration.platform == helpers.PLATFORM
 esig_sources = [
     'src/tosig_module.cpp',
     'src/Cpp_ToSig.cpp',
+    'src/DenseKernels.cpp',
+    'src/Latency.cpp',
+    'src/Memory.cpp',
+    'src/Profile.cpp',
+    'src/SigWords.cpp',
+    'src/ThreadPool.cpp',
     'src/ToSig.cpp',
+    'src/ToSigCore.cpp',
+    'src/Trace.cpp',
 ]
 
 esig_depends = [
+    'src/Arena.h',
+    'src/DenseKernels.h',
+    'src/DenseTensor.h',
+    'src/Latency.h',
+    'src/Memory.h',
+    'src/Profile.h',
+    'src/ShapeKernels.h',
+    'src/shape_ranges.h',
+    'src/SigWords.h',
+    'src/ThreadPool.h',
     'src/ToSig.h',
     'src/ToSig.cpp',
+    'src/ToSigCore.h',
+    'src/Trace.h',
+    'src/ToSigCore.cpp',
     'src/switch.h',
 ]
 
@@ -75,20 +96,42 @@ if not configuration.no_recombine:
         'recombine/_recombine.h'
     ])
 
-esig_extension = Extension(
-    'esig.tosig',
-    sources=esig_sources,
+# the options of every extension, which all compile libalgebra code
+extension_options = dict(
     language="c++",
-    # relationship between depends and include_dirs is unclear
-    depends=esig_depends,
     include_dirs=configuration.include_dirs,
     library_dirs=configuration.library_dirs,
-    define_macros=configuration.define_macros,
     libraries=configuration.used_libraries,
     extra_compile_args=configuration.extra_compile_args,
     extra_link_args=configuration.linker_args,
 )
 
+esig_extension = Extension(
+    'esig.tosig',
+    sources=esig_sources,
+    # relationship between depends and include_dirs is unclear
+    depends=esig_depends,
+    define_macros=configuration.define_macros,
+    **extension_options
+)
+
+# the libalgebra code for each range of widths, a shared object of its own that esig.tosig loads
+# the first time one of its widths is used; only built as an extension so setuptools compiles it
+shape_extensions = [
+    Extension(
+        'esig.tosig_shapes_{}_{}'.format(mina, maxa),
+        sources=['src/ShapeKernels.cpp'],
+        depends=['src/shape_ranges.h', 'src/ShapeKernels.h', 'src/shape_switch.h', 'src/ToSigCore.h'],
+        define_macros=configuration.define_macros + [
+            ('ESIG_MIN_WIDTH', str(mina)),
+            ('ESIG_MAX_WIDTH', str(maxa)),
+            ('ESIG_SHAPES_PYINIT', 'PyInit_tosig_shapes_{}_{}'.format(mina, maxa)),
+        ],
+        **extension_options
+    )
+    for (mina, maxa) in SWITCH_GEN.width_ranges
+]
+
 package_data = {
 	"esig": ["VERSION", "ERROR_MESSAGE"]
 }
@@ -131,7 +174,7 @@ setup(
     package_data=package_data,
     eager_resources=eager_resources,
     distclass=helpers.BinaryDistribution,
-    ext_modules=[esig_extension],
+    ext_modules=[esig_extension] + shape_extensions,
 
     install_requires=['numpy>=1.7'],
     setup_requires=[
@@ -0,0 +1,197 @@
+#ifndef Arena_h__
+#define Arena_h__
+// Arena.h : a bump allocator per thread for the temporaries of a call, so that
+// once a thread has seen its largest call it does no more heap allocation
+//
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "Memory.h"
+
+namespace sigcore {
+
+  /**
+   * scratch_arena - memory handed out by bumping a position through a list of blocks,
+   * given back all at once by returning to an earlier position; the blocks are kept, and
+   * when the arena is empty again several of them are merged into one big enough for all
+   */
+	class scratch_arena
+	{
+	public:
+		struct position
+		{
+			size_t block;
+			size_t used;
+		};
+
+		scratch_arena() : _block(0), _used(0)
+		{
+		}
+
+		~scratch_arena()
+		{
+			for (size_t b = 0; b < _blocks.size(); ++b)
+				counted_deallocate(_blocks[b].data, _blocks[b].size, _blocks[b].hooks);
+		}
+
+		position mark() const
+		{
+			position ans = { _block, _used };
+			return ans;
+		}
+
+		void release(const position& p)
+		{
+			_block = p.block;
+			_used = p.used;
+			if (_block == 0 && _used == 0 && _blocks.size() > 1) {
+				size_t total = 0;
+				for (size_t b = 0; b < _blocks.size(); ++b) {
+					total += _blocks[b].size;
+					counted_deallocate(_blocks[b].data, _blocks[b].size, _blocks[b].hooks);
+				}
+				_blocks.clear();
+				add_block(total);
+			}
+		}
+
+		// bytes of memory aligned to align, a power of two no bigger than 64
+		void* allocate(size_t bytes, size_t align)
+		{
+			for (;;) {
+				if (_block < _blocks.size()) {
+					const uintptr_t base = reinterpret_cast<uintptr_t>(_blocks[_block].data);
+					const size_t start = ((base + _used + align - 1) & ~(align - 1)) - base;
+					if (start + bytes <= _blocks[_block].size) {
+						_used = start + bytes;
+						return _blocks[_block].data + start;
+					}
+					if (_block + 1 < _blocks.size()) {
+						++_block;
+						_used = 0;
+						continue;
+					}
+				}
+				const size_t last = _blocks.empty() ? 0 : _blocks.back().size;
+				add_block(std::max(std::max(2 * last, bytes + align), size_t(1) << 16));
+				_block = _blocks.size() - 1;
+				_used = 0;
+			}
+		}
+
+	private:
+		struct block
+		{
+			char* data;
+			size_t size;
+			allocator_hooks hooks;
+		};
+
+		// the blocks come from the allocator hooks of Memory.h, which also count them
+		void add_block(size_t size)
+		{
+			_blocks.reserve(_blocks.size() + 1);
+			const allocator_hooks hooks = get_allocator_hooks();
+			block b = { static_cast<char*>(counted_allocate(size, hooks)), size, hooks };
+			_blocks.push_back(b);
+		}
+
+		std::vector<block> _blocks;
+		size_t _block;
+		size_t _used;
+
+		scratch_arena(const scratch_arena&);
+		scratch_arena& operator=(const scratch_arena&);
+	};
+
+	// the arena of the calling thread
+	inline scratch_arena& thread_arena()
+	{
+		static thread_local scratch_arena arena;
+		return arena;
+	}
+
+  /**
+   * arena_scope - hands out memory from the arena of the calling thread and gives back,
+   * when it goes out of scope, everything taken since it was made
+   */
+	class arena_scope
+	{
+	public:
+		arena_scope() : _arena(thread_arena()), _mark(_arena.mark())
+		{
+		}
+
+		~arena_scope()
+		{
+			_arena.release(_mark);
+		}
+
+		// room for n objects of type T, which are not constructed
+		template <class T>
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(_arena.allocate(n * sizeof(T), alignof(T) < 64 ? 64 : alignof(T)));
+		}
+
+	private:
+		scratch_arena& _arena;
+		scratch_arena::position _mark;
+
+		arena_scope(const arena_scope&);
+		arena_scope& operator=(const arena_scope&);
+	};
+
+  /**
+   * arena_allocator - an allocator for standard containers taking memory from the arena of
+   * the calling thread, for use inside an arena_scope; deallocate does nothing, the memory
+   * coming back with the scope, so a container should reserve what it needs up front
+   */
+	template <class T>
+	struct arena_allocator
+	{
+		typedef T value_type;
+
+		arena_allocator()
+		{
+		}
+
+		template <class U>
+		arena_allocator(const arena_allocator<U>&)
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			return static_cast<T*>(thread_arena().allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t)
+		{
+		}
+
+		template <class U>
+		struct rebind
+		{
+			typedef arena_allocator<U> other;
+		};
+	};
+
+	template <class T, class U>
+	bool operator==(const arena_allocator<T>&, const arena_allocator<U>&)
+	{
+		return true;
+	}
+
+	template <class T, class U>
+	bool operator!=(const arena_allocator<T>&, const arena_allocator<U>&)
+	{
+		return false;
+	}
+
+} // namespace sigcore
+
+#endif // Arena_h__
@@ -0,0 +1,86 @@
+#ifndef BenchSupport_h__
+#define BenchSupport_h__
+// BenchSupport.h : what the command line benchmarks tosig_bench and recombine_bench share:
+// the parsing of their numeric options, the percentiles of their latencies, the writing
+// of their JSON results and their main
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+namespace bench {
+
+	// a positive integer, or std::invalid_argument naming what it is
+	inline size_t parse_size(const std::string& text, const char* what)
+	{
+		char* end = NULL;
+		const long long value = strtoll(text.c_str(), &end, 10);
+		if (end == text.c_str() || *end != '\0' || value <= 0)
+			throw std::invalid_argument(std::string("invalid ") + what + ": " + text);
+		return (size_t) value;
+	}
+
+	// a comma separated list of positive integers
+	inline std::vector<size_t> parse_sizes(const std::string& text, const char* what)
+	{
+		std::vector<size_t> ans;
+		std::istringstream in(text);
+		std::string item;
+		while (std::getline(in, item, ','))
+			ans.push_back(parse_size(item, what));
+		if (ans.empty())
+			throw std::invalid_argument(std::string("invalid ") + what + ": " + text);
+		return ans;
+	}
+
+	// the value at fraction q of the sorted latencies, by nearest rank
+	inline double percentile(const std::vector<double>& sorted, double q)
+	{
+		const size_t rank = (size_t) (q * double(sorted.size()) + 0.999999);
+		return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+	}
+
+	// writes the JSON of write_json(std::ostream&) to stdout if output is empty, and
+	// otherwise to the file output
+	template <class WRITE_JSON>
+	void write_output(const std::string& output, WRITE_JSON write_json)
+	{
+		if (output.empty()) {
+			write_json(std::cout);
+			return;
+		}
+		std::ostringstream json;
+		write_json(json);
+		FILE* out = fopen(output.c_str(), "wb");
+		if (out == NULL)
+			throw std::runtime_error(output + ": cannot open for writing");
+		const std::string text = json.str();
+		const bool written = fwrite(text.data(), 1, text.size(), out) == text.size();
+		if (fclose(out) != 0 || !written)
+			throw std::runtime_error(output + ": write failed");
+	}
+
+	// the main of a benchmark: run(argc, argv), reporting its errors on stderr after the
+	// name of the tool, with usage for a bad option; returns 2 for those, 1 for the others
+	inline int run_tool(const char* tool, const char* usage, int (*run)(int, char**), int argc, char** argv)
+	{
+		try {
+			return run(argc, argv);
+		} catch (std::invalid_argument& exc) {
+			std::cerr << tool << ": " << exc.what() << "\n" << usage;
+			return 2;
+		} catch (std::exception& exc) {
+			std::cerr << tool << ": " << exc.what() << "\n";
+			return 1;
+		}
+	}
+
+} // namespace bench
+
+#endif // BenchSupport_h__
@@ -26,9 +26,14 @@ extern "C" {
 		SIGTYPE sigtype(width,depth); 
 
 		DICT::const_iterator it = theLieBasesStrngs.find(sigtype);
-		if (it == theLieBasesStrngs.end()) 
-			return Py_BuildValue("s",(theLieBasesStrngs[sigtype] = ShowLogSigLabels(width, depth)).c_str());
-		else
+		if (it == theLieBasesStrngs.end()) {
+			// the keys are not cached when they could not be computed, e.g. the shared
+			// object of the width is missing
+			const std::string keys = ShowLogSigLabels(width, depth);
+			if (PyErr_Occurred())
+				return NULL;
+			return Py_BuildValue("s",(theLieBasesStrngs[sigtype] = keys).c_str());
+		} else
 			return Py_BuildValue("s", (it->second).c_str());
 	}
 
@@ -47,9 +52,14 @@ extern "C" {
 		SIGTYPE sigtype(width,depth); 
 
 		DICT::const_iterator it = theTensorBasesStrngs.find(sigtype);
-		if (it == theTensorBasesStrngs.end()) 
-			return Py_BuildValue("s",(theTensorBasesStrngs[sigtype] = ShowSigLabels(width, depth)).c_str());
-		else
+		if (it == theTensorBasesStrngs.end()) {
+			// the keys are not cached when they could not be computed, e.g. the shared
+			// object of the width is missing
+			const std::string keys = ShowSigLabels(width, depth);
+			if (PyErr_Occurred())
+				return NULL;
+			return Py_BuildValue("s",(theTensorBasesStrngs[sigtype] = keys).c_str());
+		} else
 			return Py_BuildValue("s", (it->second).c_str());
 	}
 
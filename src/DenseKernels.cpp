@@ -0,0 +1,360 @@
+// DenseKernels.cpp : hand vectorised inner loops of the level-wise tensor products
+//
+// Each instruction set gets its own copy of the loops, compiled through target
+// attributes rather than compiler flags so that a wheel built for the baseline
+// architecture still carries (and at import time picks) the AVX2 and AVX-512
+// versions on machines that support them.
+//
+#include "DenseKernels.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ESIG_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ESIG_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ESIG_TARGET(isa)
+#endif
+
+namespace {
+
+	typedef dense::S S;
+
+	// portable loops, the compiler vectorises them as far as the baseline allows
+
+	void outer_add_generic(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		for (size_t i = 0; i < na; ++i, out += nb) {
+			const S ai = a[i];
+			for (size_t j = 0; j < nb; ++j)
+				out[j] += ai * b[j];
+		}
+	}
+
+	void outer_set_generic(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		for (size_t i = 0; i < na; ++i, out += nb) {
+			const S ai = a[i];
+			for (size_t j = 0; j < nb; ++j)
+				out[j] = ai * b[j];
+		}
+	}
+
+	void add_scale_generic(S* v, const S* a, size_t n, S r)
+	{
+		for (size_t i = 0; i < n; ++i)
+			v[i] = (v[i] + a[i]) * r;
+	}
+
+	const dense::kernel_table generic_kernels = {
+		"generic", &outer_add_generic, &outer_set_generic, &add_scale_generic
+	};
+
+#ifdef ESIG_X86_KERNELS
+
+	// SSE2, two doubles per register; a row of width 2 is a single register
+
+	ESIG_TARGET("sse2")
+	void outer_add_sse2(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		for (size_t i = 0; i < na; ++i, out += nb) {
+			const __m128d ai = _mm_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 2 <= nb; j += 2)
+				_mm_storeu_pd(out + j, _mm_add_pd(_mm_loadu_pd(out + j), _mm_mul_pd(ai, _mm_loadu_pd(b + j))));
+			if (j < nb)
+				out[j] += a[i] * b[j];
+		}
+	}
+
+	ESIG_TARGET("sse2")
+	void outer_set_sse2(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		for (size_t i = 0; i < na; ++i, out += nb) {
+			const __m128d ai = _mm_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 2 <= nb; j += 2)
+				_mm_storeu_pd(out + j, _mm_mul_pd(ai, _mm_loadu_pd(b + j)));
+			if (j < nb)
+				out[j] = a[i] * b[j];
+		}
+	}
+
+	ESIG_TARGET("sse2")
+	void add_scale_sse2(S* v, const S* a, size_t n, S r)
+	{
+		const __m128d rr = _mm_set1_pd(r);
+		size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+			_mm_storeu_pd(v + i, _mm_mul_pd(_mm_add_pd(_mm_loadu_pd(v + i), _mm_loadu_pd(a + i)), rr));
+		if (i < n)
+			v[i] = (v[i] + a[i]) * r;
+	}
+
+	const dense::kernel_table sse2_kernels = {
+		"sse2", &outer_add_sse2, &outer_set_sse2, &add_scale_sse2
+	};
+
+	// AVX2 with FMA, four doubles per register; the ragged end of a row is
+	// handled with a masked load and store, and rows of width 2 are paired
+
+	const long long avx2_masks[4][4] = {
+		{ 0, 0, 0, 0 }, { -1, 0, 0, 0 }, { -1, -1, 0, 0 }, { -1, -1, -1, 0 }
+	};
+
+	ESIG_TARGET("avx2,fma")
+	void outer_add_avx2(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		size_t i = 0;
+		if (nb == 2) {
+			const __m256d bb = _mm256_set_pd(b[1], b[0], b[1], b[0]);
+			for (; i + 2 <= na; i += 2, out += 4) {
+				const __m256d aa = _mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a + i)), 0x50);
+				_mm256_storeu_pd(out, _mm256_fmadd_pd(aa, bb, _mm256_loadu_pd(out)));
+			}
+		}
+		const __m256i mask = _mm256_loadu_si256((const __m256i*) avx2_masks[nb % 4]);
+		for (; i < na; ++i, out += nb) {
+			const __m256d ai = _mm256_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 4 <= nb; j += 4)
+				_mm256_storeu_pd(out + j, _mm256_fmadd_pd(ai, _mm256_loadu_pd(b + j), _mm256_loadu_pd(out + j)));
+			if (j < nb)
+				_mm256_maskstore_pd(out + j, mask, _mm256_fmadd_pd(ai, _mm256_maskload_pd(b + j, mask),
+					_mm256_maskload_pd(out + j, mask)));
+		}
+	}
+
+	ESIG_TARGET("avx2,fma")
+	void outer_set_avx2(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		size_t i = 0;
+		if (nb == 2) {
+			const __m256d bb = _mm256_set_pd(b[1], b[0], b[1], b[0]);
+			for (; i + 2 <= na; i += 2, out += 4) {
+				const __m256d aa = _mm256_permute4x64_pd(_mm256_castpd128_pd256(_mm_loadu_pd(a + i)), 0x50);
+				_mm256_storeu_pd(out, _mm256_mul_pd(aa, bb));
+			}
+		}
+		const __m256i mask = _mm256_loadu_si256((const __m256i*) avx2_masks[nb % 4]);
+		for (; i < na; ++i, out += nb) {
+			const __m256d ai = _mm256_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 4 <= nb; j += 4)
+				_mm256_storeu_pd(out + j, _mm256_mul_pd(ai, _mm256_loadu_pd(b + j)));
+			if (j < nb)
+				_mm256_maskstore_pd(out + j, mask, _mm256_mul_pd(ai, _mm256_maskload_pd(b + j, mask)));
+		}
+	}
+
+	ESIG_TARGET("avx2,fma")
+	void add_scale_avx2(S* v, const S* a, size_t n, S r)
+	{
+		const __m256d rr = _mm256_set1_pd(r);
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm256_storeu_pd(v + i, _mm256_mul_pd(_mm256_add_pd(_mm256_loadu_pd(v + i), _mm256_loadu_pd(a + i)), rr));
+		for (; i < n; ++i)
+			v[i] = (v[i] + a[i]) * r;
+	}
+
+	const dense::kernel_table avx2_kernels = {
+		"avx2", &outer_add_avx2, &outer_set_avx2, &add_scale_avx2
+	};
+
+	// AVX-512F, eight doubles per register; ragged ends use mask registers and
+	// rows of width 2 or 4 are packed four or two to a register
+
+	ESIG_TARGET("avx512f")
+	__m512d spread_avx512(const S* a, size_t nb)
+	{
+		// (a0, a0, a1, a1, ...) from four rows for nb == 2 and (a0, a0, a0, a0, a1, ...) from two for nb == 4
+		const __m512d zero = _mm512_setzero_pd();
+		if (nb == 2)
+			return _mm512_mask_permutexvar_pd(zero, (__mmask8) 0xff, _mm512_set_epi64(3, 3, 2, 2, 1, 1, 0, 0),
+				_mm512_maskz_loadu_pd((__mmask8) 0x0f, a));
+		return _mm512_mask_permutexvar_pd(zero, (__mmask8) 0xff, _mm512_set_epi64(1, 1, 1, 1, 0, 0, 0, 0),
+			_mm512_maskz_loadu_pd((__mmask8) 0x03, a));
+	}
+
+	ESIG_TARGET("avx512f")
+	__m512d repeat_avx512(const S* b, size_t nb)
+	{
+		return (nb == 2) ? _mm512_set_pd(b[1], b[0], b[1], b[0], b[1], b[0], b[1], b[0])
+			: _mm512_set_pd(b[3], b[2], b[1], b[0], b[3], b[2], b[1], b[0]);
+	}
+
+	ESIG_TARGET("avx512f")
+	void outer_add_avx512(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		size_t i = 0;
+		if (nb == 2 || nb == 4) {
+			const size_t step = 8 / nb;
+			const __m512d bb = repeat_avx512(b, nb);
+			for (; i + step <= na; i += step, out += 8)
+				_mm512_storeu_pd(out, _mm512_fmadd_pd(spread_avx512(a + i, nb), bb, _mm512_loadu_pd(out)));
+		}
+		const __mmask8 mask = (__mmask8) ((1u << (nb % 8)) - 1u);
+		for (; i < na; ++i, out += nb) {
+			const __m512d ai = _mm512_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 8 <= nb; j += 8)
+				_mm512_storeu_pd(out + j, _mm512_fmadd_pd(ai, _mm512_loadu_pd(b + j), _mm512_loadu_pd(out + j)));
+			if (j < nb)
+				_mm512_mask_storeu_pd(out + j, mask, _mm512_fmadd_pd(ai, _mm512_maskz_loadu_pd(mask, b + j),
+					_mm512_maskz_loadu_pd(mask, out + j)));
+		}
+	}
+
+	ESIG_TARGET("avx512f")
+	void outer_set_avx512(S* out, const S* a, size_t na, const S* b, size_t nb)
+	{
+		size_t i = 0;
+		if (nb == 2 || nb == 4) {
+			const size_t step = 8 / nb;
+			const __m512d bb = repeat_avx512(b, nb);
+			for (; i + step <= na; i += step, out += 8)
+				_mm512_storeu_pd(out, _mm512_mul_pd(spread_avx512(a + i, nb), bb));
+		}
+		const __mmask8 mask = (__mmask8) ((1u << (nb % 8)) - 1u);
+		for (; i < na; ++i, out += nb) {
+			const __m512d ai = _mm512_set1_pd(a[i]);
+			size_t j = 0;
+			for (; j + 8 <= nb; j += 8)
+				_mm512_storeu_pd(out + j, _mm512_mul_pd(ai, _mm512_loadu_pd(b + j)));
+			if (j < nb)
+				_mm512_mask_storeu_pd(out + j, mask, _mm512_mul_pd(ai, _mm512_maskz_loadu_pd(mask, b + j)));
+		}
+	}
+
+	ESIG_TARGET("avx512f")
+	void add_scale_avx512(S* v, const S* a, size_t n, S r)
+	{
+		const __m512d rr = _mm512_set1_pd(r);
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			_mm512_storeu_pd(v + i, _mm512_mul_pd(_mm512_add_pd(_mm512_loadu_pd(v + i), _mm512_loadu_pd(a + i)), rr));
+		if (i < n) {
+			const __mmask8 mask = (__mmask8) ((1u << (n - i)) - 1u);
+			_mm512_mask_storeu_pd(v + i, mask, _mm512_mul_pd(_mm512_add_pd(_mm512_maskz_loadu_pd(mask, v + i),
+				_mm512_maskz_loadu_pd(mask, a + i)), rr));
+		}
+	}
+
+	const dense::kernel_table avx512_kernels = {
+		"avx512", &outer_add_avx512, &outer_set_avx512, &add_scale_avx512
+	};
+
+	struct cpu_features
+	{
+		bool sse2, avx2, avx512;
+
+		cpu_features() : sse2(false), avx2(false), avx512(false)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			// these also check that the operating system saves the wider registers
+			__builtin_cpu_init();
+			sse2 = __builtin_cpu_supports("sse2") != 0;
+			avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			avx512 = __builtin_cpu_supports("avx512f") != 0;
+#elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			const int no_ids = info[0];
+			__cpuid(info, 1);
+			sse2 = (info[3] & (1 << 26)) != 0;
+			const bool fma = (info[2] & (1 << 12)) != 0;
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+			if (no_ids >= 7) {
+				__cpuidex(info, 7, 0);
+				avx2 = fma && (info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+				avx512 = (info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6;
+			}
+#endif
+		}
+	};
+
+#endif // ESIG_X86_KERNELS
+
+	// every kernel table the cpu can run, slowest first
+	struct kernel_registry
+	{
+		const dense::kernel_table* tables[5];
+		const char* names[5];
+		size_t count;
+
+		kernel_registry() : count(0)
+		{
+			add(&generic_kernels);
+#ifdef ESIG_X86_KERNELS
+			cpu_features cpu;
+			if (cpu.sse2)
+				add(&sse2_kernels);
+			if (cpu.avx2)
+				add(&avx2_kernels);
+			if (cpu.avx512)
+				add(&avx512_kernels);
+#endif
+			tables[count] = NULL;
+			names[count] = NULL;
+		}
+
+		void add(const dense::kernel_table* table)
+		{
+			tables[count] = table;
+			names[count++] = table->name;
+		}
+	};
+
+	const kernel_registry& registry()
+	{
+		static const kernel_registry ans;
+		return ans;
+	}
+
+	std::atomic<const dense::kernel_table*> active_kernels(NULL);
+
+} // namespace
+
+namespace dense {
+
+	const kernel_table& kernels()
+	{
+		const kernel_table* ans = active_kernels.load(std::memory_order_acquire);
+		if (ans == NULL) {
+			select_kernels(NULL);
+			ans = active_kernels.load(std::memory_order_acquire);
+		}
+		return *ans;
+	}
+
+	bool select_kernels(const char* name)
+	{
+		const kernel_registry& reg = registry();
+		if (name == NULL || *name == '\0') {
+			active_kernels.store(reg.tables[reg.count - 1], std::memory_order_release);
+			return true;
+		}
+		for (size_t i = 0; i < reg.count; ++i)
+			if (strcmp(reg.names[i], name) == 0) {
+				active_kernels.store(reg.tables[i], std::memory_order_release);
+				return true;
+			}
+		return false;
+	}
+
+	const char* const* available_kernels()
+	{
+		return registry().names;
+	}
+
+} // namespace dense
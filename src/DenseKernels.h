@@ -0,0 +1,39 @@
+#ifndef DenseKernels_h__
+#define DenseKernels_h__
+// DenseKernels.h : the inner loops of the level-wise tensor products, compiled
+// once per instruction set and chosen at import time from the features of the cpu
+//
+#include <stddef.h>
+
+namespace dense {
+
+	typedef double S;
+
+  /**
+   * kernel_table - one implementation of each inner loop
+   */
+	struct kernel_table
+	{
+		// the name reported by tosig.get_kernels(), e.g. "avx2"
+		const char* name;
+		// out[i * nb + j] += a[i] * b[j]
+		void (*outer_add)(S* out, const S* a, size_t na, const S* b, size_t nb);
+		// out[i * nb + j] = a[i] * b[j]
+		void (*outer_set)(S* out, const S* a, size_t na, const S* b, size_t nb);
+		// v[i] = (v[i] + a[i]) * r
+		void (*add_scale)(S* v, const S* a, size_t n, S r);
+	};
+
+	// the kernels in use, the fastest the cpu supports unless select_kernels says otherwise
+	const kernel_table& kernels();
+
+	// use the kernels of the given name, or the fastest supported if name is NULL or empty;
+	// returns false and leaves the choice unchanged if the cpu does not support them
+	bool select_kernels(const char* name);
+
+	// the names of the kernels the cpu supports, slowest first, terminated by NULL
+	const char* const* available_kernels();
+
+} // namespace dense
+
+#endif // DenseKernels_h__
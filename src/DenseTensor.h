@@ -0,0 +1,301 @@
+#ifndef DenseTensor_h__
+#define DenseTensor_h__
+// DenseTensor.h : level-wise kernels for truncated tensors held as flat arrays
+// of doubles in the order used by unpack_tensor_to_SNK, that is degree by degree
+// with the words of each degree in lexicographic order.
+//
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "DenseKernels.h"
+#include "Arena.h"
+
+namespace dense {
+
+	typedef double S;
+
+  /**
+   * tensor_layout - the offsets of the levels of a flattened truncated tensor
+   * offset[k] is the position of the first word of degree k and offset[depth + 1] is the size
+   */
+	struct tensor_layout
+	{
+		size_t width;
+		size_t depth;
+		std::vector<size_t> offset;
+
+		tensor_layout(size_t w, size_t d) : width(w), depth(d), offset(d + 2, 0)
+		{
+			size_t level_size = 1;
+			for (size_t k = 0; k <= depth; ++k, level_size *= width)
+				offset[k + 1] = offset[k] + level_size;
+		}
+
+		size_t size() const { return offset[depth + 1]; }
+		size_t level_size(size_t k) const { return offset[k + 1] - offset[k]; }
+	};
+
+  /**
+   * mul_inplace - replaces a by the truncated product a * b
+   * @param max_level only the levels 0...max_level of a are updated, the others are left as they are
+   */
+	inline void mul_inplace(const tensor_layout& layout, S* a, const S* b, size_t max_level)
+	{
+		// work down the levels so the lower levels of a are still those of the left operand;
+		// the product of words u and v of degrees i and j sits at index(u) * width^j + index(v)
+		const kernel_table& kernel = kernels();
+		for (size_t k = max_level + 1; k-- > 0;) {
+			S* ak = a + layout.offset[k];
+			const S b0 = b[0];
+			for (size_t i = 0, n = layout.level_size(k); i < n; ++i)
+				ak[i] *= b0;
+			for (size_t i = 0; i < k; ++i)
+				kernel.outer_add(ak, a + layout.offset[i], layout.level_size(i),
+					b + layout.offset[k - i], layout.level_size(k - i));
+		}
+	}
+
+  /**
+   * mul - out = a * b truncated to the depth of the layout, out must not alias a or b
+   */
+	inline void mul(const tensor_layout& layout, S* out, const S* a, const S* b)
+	{
+		std::copy(a, a + layout.size(), out);
+		mul_inplace(layout, out, b, layout.depth);
+	}
+
+  /**
+   * mul_exp_inplace - the Chen update a <- a * exp(x) for a vector x of length width
+   * each level is updated by Horner's rule
+   * a_m += (((a_0 x/m + a_1) x/(m-1) + a_2) x/(m-2) + ... + a_(m-1)) x
+   * working down the levels so the lower levels of a are still the old ones
+   * @param scratch buffer of at least 2 width^(depth-1) doubles
+   */
+	inline void mul_exp_inplace(const tensor_layout& layout, S* a, const S* x, S* scratch)
+	{
+		const kernel_table& kernel = kernels();
+		const size_t width = layout.width;
+		S* tmp = scratch;
+		S* next = scratch + layout.level_size(layout.depth - 1);
+		for (size_t m = layout.depth; m >= 2; --m) {
+			const S c = a[0] / S(m);
+			kernel.outer_set(tmp, &c, 1, x, width);
+			for (size_t i = 1; i + 1 < m; ++i) {
+				kernel.add_scale(tmp, a + layout.offset[i], layout.level_size(i), S(1) / S(m - i));
+				kernel.outer_set(next, tmp, layout.level_size(i), x, width);
+				std::swap(tmp, next);
+			}
+			kernel.add_scale(tmp, a + layout.offset[m - 1], layout.level_size(m - 1), S(1));
+			kernel.outer_add(a + layout.offset[m], tmp, layout.level_size(m - 1), x, width);
+		}
+		kernel.outer_add(a + 1, a, 1, x, width);
+	}
+
+  /**
+   * mul_sparse_exp_inplace - the Chen update a <- a * exp(x) for an increment x that is zero
+   * but at the letters letters[0] < ... < letters[nnz - 1]; a word u l of degree m gains
+   * nothing unless l is one of them, and then x_l times
+   * a_(m-1)(u) + sum over j >= 2 of a_(m-j)(v) x_(u_1) ... x_(u_(j-1)) / j!
+   * where u = v u_1 ... u_(j-1) ends in j - 1 of the letters; the first term is added for
+   * every u in one pass over the level and the others only for the u ending in a letter,
+   * about width^(m-1) nnz operations against width^m
+   */
+	inline void mul_sparse_exp_inplace(const tensor_layout& layout, S* a, const S* x,
+		const size_t* letters, size_t nnz)
+	{
+		const size_t width = layout.width;
+		// working down the levels so the lower levels of a are still the old ones
+		for (size_t m = layout.depth; m >= 1; --m) {
+			S* am = a + layout.offset[m];
+			const S* lower = a + layout.offset[m - 1];
+			const size_t n = layout.level_size(m - 1);
+			for (size_t u = 0; u < n; ++u) {
+				const S c = lower[u];
+				S* block = am + u * width;
+				for (size_t e = 0; e < nnz; ++e)
+					block[letters[e]] += c * x[letters[e]];
+			}
+			if (m < 2)
+				continue;
+			for (size_t v = 0; v < n; v += width)
+				for (size_t f = 0; f < nnz; ++f) {
+					// u = v + letters[f] ends in at least one of the letters
+					S g = S(0), c = S(1);
+					size_t prefix = v + letters[f];
+					for (size_t j = 2; j <= m; ++j) {
+						const size_t l = prefix % width;
+						if (x[l] == S(0))
+							break;
+						c *= x[l] / S(j);
+						prefix /= width;
+						g += a[layout.offset[m - j] + prefix] * c;
+					}
+					S* block = am + (v + letters[f]) * width;
+					for (size_t e = 0; e < nnz; ++e)
+						block[letters[e]] += g * x[letters[e]];
+				}
+		}
+	}
+
+  /**
+   * mul_increment_inplace - the Chen update a <- a * exp(x), nothing for a zero increment and
+   * mul_sparse_exp_inplace for one with at most an eighth of its entries nonzero, as rows of
+   * one-hot or rarely changing channels have; below that the vectorised kernels of
+   * mul_exp_inplace, which touch the same cache lines, are as fast
+   * @param letters room for width indices
+   * @param scratch buffer of at least 2 width^(depth-1) doubles
+   */
+	inline void mul_increment_inplace(const tensor_layout& layout, S* a, const S* x,
+		size_t* letters, S* scratch)
+	{
+		size_t nnz = 0;
+		for (size_t q = 0; q < layout.width; ++q)
+			if (x[q] != S(0))
+				letters[nnz++] = q;
+		if (nnz == 0)
+			return;
+		if (8 * nnz <= layout.width)
+			mul_sparse_exp_inplace(layout, a, x, letters, nnz);
+		else
+			mul_exp_inplace(layout, a, x, scratch);
+	}
+
+  /**
+   * scratch_size - the number of doubles of scratch needed by signature
+   */
+	inline size_t scratch_size(const tensor_layout& layout)
+	{
+		return 2 * layout.level_size(layout.depth - 1) + layout.width;
+	}
+
+  /**
+   * extend_signature - multiplies the signature in out by that of the rows of a stream
+   * so a long stream can be fed in pieces; zero and sparse increments take the short cuts
+   * of mul_increment_inplace
+   * @param previous the row before stream, whose increment to stream[0] is included, or NULL
+   * @param scratch buffer of at least scratch_size(layout) doubles
+   */
+	inline void extend_signature(const tensor_layout& layout, S* out, const S* previous,
+		const S* stream, size_t rows, S* scratch)
+	{
+		const size_t width = layout.width;
+		S* increment = scratch + 2 * layout.level_size(layout.depth - 1);
+		sigcore::arena_scope scope;
+		size_t* letters = scope.allocate<size_t>(width);
+		if (previous != NULL && rows > 0) {
+			for (size_t q = 0; q < width; ++q)
+				increment[q] = stream[q] - previous[q];
+			mul_increment_inplace(layout, out, increment, letters, scratch);
+		}
+		for (size_t r = 1; r < rows; ++r, stream += width) {
+			for (size_t q = 0; q < width; ++q)
+				increment[q] = stream[width + q] - stream[q];
+			mul_increment_inplace(layout, out, increment, letters, scratch);
+		}
+	}
+
+  /**
+   * signature - the signature of a stream of rows of length width, stored one after another
+   * computed by folding the Chen update over the increments between consecutive rows
+   * @param scratch buffer of at least scratch_size(layout) doubles
+   */
+	inline void signature(const tensor_layout& layout, S* out, const S* stream, size_t rows, S* scratch)
+	{
+		std::fill(out, out + layout.size(), S(0));
+		out[0] = S(1);
+		extend_signature(layout, out, NULL, stream, rows, scratch);
+	}
+
+  /**
+   * nilpotent_part - n = arg / arg[0] with the scalar term removed
+   */
+	inline void nilpotent_part(const tensor_layout& layout, S* n, const S* arg)
+	{
+		const S a0 = arg[0];
+		n[0] = S(0);
+		for (size_t i = 1; i < layout.size(); ++i)
+			n[i] = arg[i] / a0;
+	}
+
+  /**
+   * exp - the truncated exponential of arg
+   * exp(a0 + n) = e^a0 (1 + n(1 + n/2(1 + n/3(...)))), evaluated by Horner's rule; at the
+   * step dividing by k only the levels up to depth - k + 1 can reach the final answer
+   */
+	inline void exp(const tensor_layout& layout, S* out, const S* arg)
+	{
+		sigcore::arena_scope scope;
+		S* n = scope.allocate<S>(layout.size());
+		std::copy(arg, arg + layout.size(), n);
+		n[0] = S(0);
+		std::fill(out, out + layout.size(), S(0));
+		out[0] = S(1);
+		for (size_t k = layout.depth; k >= 1; --k) {
+			const size_t max_level = layout.depth - k + 1;
+			mul_inplace(layout, out, n, max_level);
+			for (size_t i = layout.offset[1]; i < layout.offset[max_level + 1]; ++i)
+				out[i] /= S(k);
+			out[0] = S(1);
+		}
+		const S scale = std::exp(arg[0]);
+		if (scale != S(1))
+			for (size_t i = 0; i < layout.size(); ++i)
+				out[i] *= scale;
+	}
+
+  /**
+   * log - the truncated logarithm of arg, which must have a positive scalar term
+   * log(a0 (1 + n)) = log(a0) + n(1 - n(1/2 - n(1/3 - ...))), evaluated by Horner's rule
+   */
+	inline void log(const tensor_layout& layout, S* out, const S* arg)
+	{
+		const S a0 = arg[0];
+		if (!(a0 > S(0)))
+			throw std::runtime_error("The logarithm requires a tensor with a positive scalar term");
+		sigcore::arena_scope scope;
+		S* n = scope.allocate<S>(layout.size());
+		nilpotent_part(layout, n, arg);
+		const size_t depth = layout.depth;
+		std::fill(out, out + layout.size(), S(0));
+		// the coefficient of n^j in log(1 + n) is (-1)^(j+1)/j
+		out[0] = ((depth % 2) ? S(1) : S(-1)) / S(depth);
+		for (size_t j = depth - 1; j >= 1; --j) {
+			mul_inplace(layout, out, n, depth - j);
+			out[0] = ((j % 2) ? S(1) : S(-1)) / S(j);
+		}
+		mul_inplace(layout, out, n, depth);
+		out[0] = std::log(a0);
+	}
+
+  /**
+   * inverse - the truncated multiplicative inverse of arg, which must have a non-zero scalar term
+   * for a signature this is the signature of the reversed path
+   * (a0 (1 + n))^-1 = (1 - n(1 - n(1 - ...))) / a0, evaluated by Horner's rule
+   */
+	inline void inverse(const tensor_layout& layout, S* out, const S* arg)
+	{
+		const S a0 = arg[0];
+		if (a0 == S(0))
+			throw std::runtime_error("The inverse requires a tensor with a non-zero scalar term");
+		sigcore::arena_scope scope;
+		S* n = scope.allocate<S>(layout.size());
+		nilpotent_part(layout, n, arg);
+		std::fill(out, out + layout.size(), S(0));
+		out[0] = S(1);
+		for (size_t k = layout.depth; k >= 1; --k) {
+			const size_t max_level = layout.depth - k + 1;
+			mul_inplace(layout, out, n, max_level);
+			for (size_t i = layout.offset[1]; i < layout.offset[max_level + 1]; ++i)
+				out[i] = -out[i];
+			out[0] = S(1);
+		}
+		if (a0 != S(1))
+			for (size_t i = 0; i < layout.size(); ++i)
+				out[i] /= a0;
+	}
+
+} // namespace dense
+
+#endif // DenseTensor_h__
@@ -0,0 +1,179 @@
+// Latency.cpp : the histograms behind Latency.h
+//
+// The histograms live in a fixed table of slots found by hashing the entry point, width
+// and depth. A thread claims an empty slot for a new shape by a compare and swap of its
+// key, and publishes the histogram of the slot the same way, the loser of a race freeing
+// its own; so no call waits for another. Histograms are never freed, which is what lets
+// get_latency_histograms read them while calls go on
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "Latency.h"
+
+namespace {
+
+	using sigcore::latency_buckets;
+
+	// the shapes beyond this many are not counted
+	const size_t latency_slots = 1024;
+
+	struct histogram_counts
+	{
+		std::atomic<uint64_t> calls;
+		std::atomic<uint64_t> total_nanoseconds;
+		std::atomic<uint64_t> max_nanoseconds;
+		std::atomic<uint64_t> counts[latency_buckets];
+
+		histogram_counts() : calls(0), total_nanoseconds(0), max_nanoseconds(0)
+		{
+			for (size_t b = 0; b < latency_buckets; ++b)
+				counts[b].store(0, std::memory_order_relaxed);
+		}
+	};
+
+	struct latency_slot
+	{
+		// 0 while empty, and otherwise the key of the shape plus one
+		std::atomic<uint64_t> key;
+		std::atomic<histogram_counts*> histogram;
+	};
+
+	// zero initialised, as a static, and never destroyed, as pool threads may still record
+	// while the process exits
+	latency_slot slots[latency_slots];
+
+	// the entry point, width and depth in one word, or 0 if they do not fit in one
+	uint64_t slot_key(sigcore::latency_entry entry, size_t width, size_t depth)
+	{
+		if (width >= (size_t(1) << 28) || depth >= (size_t(1) << 28))
+			return 0;
+		return (((uint64_t) entry << 56) | ((uint64_t) width << 28) | (uint64_t) depth) + 1;
+	}
+
+	histogram_counts* find_histogram(uint64_t key)
+	{
+		size_t s = (size_t) ((key * 0x9E3779B97F4A7C15ull) >> 54) % latency_slots;
+		for (size_t probe = 0; probe < latency_slots; ++probe, s = (s + 1) % latency_slots) {
+			latency_slot& slot = slots[s];
+			uint64_t found = slot.key.load(std::memory_order_acquire);
+			if (found == 0 && slot.key.compare_exchange_strong(found, key, std::memory_order_acq_rel))
+				found = key;
+			if (found != key)
+				continue;
+			histogram_counts* ans = slot.histogram.load(std::memory_order_acquire);
+			if (ans == NULL) {
+				histogram_counts* made = new histogram_counts;
+				if (slot.histogram.compare_exchange_strong(ans, made, std::memory_order_acq_rel))
+					ans = made;
+				else
+					delete made;
+			}
+			return ans;
+		}
+		return NULL;
+	}
+
+	bool latency_from_environment()
+	{
+		const char* value = getenv("ESIG_LATENCY");
+		return value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+	}
+
+	size_t highest_bit(uint64_t value)
+	{
+		size_t ans = 0;
+		for (size_t step = 32; step > 0; step /= 2)
+			if (value >> (ans + step))
+				ans += step;
+		return ans;
+	}
+
+} // namespace
+
+namespace sigcore {
+
+	const char* const latency_entry_names[no_latency_entries] = { "signature", "log_signature", "recombine" };
+
+	std::atomic<bool> latency_enabled(latency_from_environment());
+
+	bool set_latency_recording(bool on)
+	{
+		return latency_enabled.exchange(on);
+	}
+
+	size_t latency_bucket(uint64_t nanoseconds)
+	{
+		const uint64_t largest = (uint64_t(1) << latency_max_bits) - 1;
+		if (nanoseconds > largest)
+			nanoseconds = largest;
+		const size_t top = highest_bit(nanoseconds);
+		const size_t shift = (nanoseconds != 0 && top > latency_sub_bucket_bits) ? top - latency_sub_bucket_bits : 0;
+		return shift * latency_sub_buckets + (size_t) (nanoseconds >> shift);
+	}
+
+	uint64_t latency_bucket_lower(size_t bucket)
+	{
+		if (bucket < 2 * latency_sub_buckets)
+			return bucket;
+		const size_t shift = bucket / latency_sub_buckets - 1;
+		return (uint64_t) (bucket - shift * latency_sub_buckets) << shift;
+	}
+
+	void record_latency(latency_entry entry, size_t width, size_t depth, uint64_t nanoseconds)
+	{
+		const uint64_t key = slot_key(entry, width, depth);
+		histogram_counts* histogram = (key != 0) ? find_histogram(key) : NULL;
+		if (histogram == NULL)
+			return;
+		histogram->counts[latency_bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		histogram->total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+		uint64_t most = histogram->max_nanoseconds.load(std::memory_order_relaxed);
+		while (nanoseconds > most
+			&& !histogram->max_nanoseconds.compare_exchange_weak(most, nanoseconds, std::memory_order_relaxed))
+			;
+		histogram->calls.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::vector<latency_histogram> get_latency_histograms()
+	{
+		std::vector<latency_histogram> ans;
+		for (size_t s = 0; s < latency_slots; ++s) {
+			const uint64_t key = slots[s].key.load(std::memory_order_acquire);
+			const histogram_counts* histogram = slots[s].histogram.load(std::memory_order_acquire);
+			if (key == 0 || histogram == NULL || histogram->calls.load(std::memory_order_relaxed) == 0)
+				continue;
+			latency_histogram copy;
+			copy.entry = (latency_entry) ((key - 1) >> 56);
+			copy.width = (size_t) (((key - 1) >> 28) & ((uint64_t(1) << 28) - 1));
+			copy.depth = (size_t) ((key - 1) & ((uint64_t(1) << 28) - 1));
+			copy.calls = 0;
+			copy.total_nanoseconds = histogram->total_nanoseconds.load(std::memory_order_relaxed);
+			copy.max_nanoseconds = histogram->max_nanoseconds.load(std::memory_order_relaxed);
+			copy.counts.resize(latency_buckets);
+			// the calls are the sum of the counts, so that the two agree
+			for (size_t b = 0; b < latency_buckets; ++b) {
+				copy.counts[b] = histogram->counts[b].load(std::memory_order_relaxed);
+				copy.calls += copy.counts[b];
+			}
+			ans.push_back(copy);
+		}
+		return ans;
+	}
+
+	void reset_latency_histograms()
+	{
+		for (size_t s = 0; s < latency_slots; ++s) {
+			histogram_counts* histogram = slots[s].histogram.load(std::memory_order_acquire);
+			if (histogram == NULL)
+				continue;
+			histogram->calls.store(0, std::memory_order_relaxed);
+			histogram->total_nanoseconds.store(0, std::memory_order_relaxed);
+			histogram->max_nanoseconds.store(0, std::memory_order_relaxed);
+			for (size_t b = 0; b < latency_buckets; ++b)
+				histogram->counts[b].store(0, std::memory_order_relaxed);
+		}
+	}
+
+} // namespace sigcore
@@ -0,0 +1,111 @@
+#ifndef Latency_h__
+#define Latency_h__
+// Latency.h : optional histograms of the time each call of the signature, log signature
+// and recombine entry points takes, by width and depth; off unless
+// set_latency_recording(true) is called or ESIG_LATENCY is set in the environment, in
+// which case a call is counted with atomic increments and no lock
+//
+// The buckets are those of an HDR histogram: each power of two of nanoseconds is split
+// into latency_sub_buckets equal buckets, so a bucket is within 1/64 of its values
+//
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+namespace sigcore {
+
+	enum latency_entry
+	{
+		latency_signature,
+		latency_log_signature,
+		latency_recombine,
+		no_latency_entries
+	};
+
+	// the names of the entry points, as reported by tosig.get_latency_histograms()
+	extern const char* const latency_entry_names[no_latency_entries];
+
+	const size_t latency_sub_bucket_bits = 6;
+	const size_t latency_sub_buckets = size_t(1) << latency_sub_bucket_bits;
+	// calls of 2^latency_max_bits nanoseconds, about 18 minutes, or more share the last bucket
+	const size_t latency_max_bits = 40;
+	const size_t latency_buckets = (latency_max_bits - latency_sub_bucket_bits + 1) * latency_sub_buckets;
+
+	// the least nanoseconds counted in bucket, and for latency_buckets the bound of the last
+	uint64_t latency_bucket_lower(size_t bucket);
+
+	// the bucket counting a call of nanoseconds
+	size_t latency_bucket(uint64_t nanoseconds);
+
+	// whether calls are being counted
+	extern std::atomic<bool> latency_enabled;
+
+	// starts or stops counting calls, returning whether it was on
+	bool set_latency_recording(bool on);
+
+	// counts a call of entry with width and depth, for recombine the dimension of the points
+	// and the degree, that took nanoseconds; thread safe and lock free
+	void record_latency(latency_entry entry, size_t width, size_t depth, uint64_t nanoseconds);
+
+  /**
+   * latency_histogram - a copy of the counts of one entry point, width and depth
+   */
+	struct latency_histogram
+	{
+		latency_entry entry;
+		size_t width;
+		size_t depth;
+		uint64_t calls;
+		uint64_t total_nanoseconds;
+		uint64_t max_nanoseconds;
+		std::vector<uint64_t> counts;	// latency_buckets of them
+	};
+
+	// the histograms with calls since the last reset_latency_histograms, by entry point, width
+	// and depth; calls counted while it runs may be in some of the counts and not others
+	std::vector<latency_histogram> get_latency_histograms();
+
+	// zeroes the counts, keeping the histograms of the shapes seen
+	void reset_latency_histograms();
+
+  /**
+   * scoped_latency_timer - counts the time from its construction to its destruction as a
+   * call of an entry point, once the shape of the call is given to it
+   */
+	class scoped_latency_timer
+	{
+		std::chrono::steady_clock::time_point start;
+		latency_entry entry;
+		size_t width;
+		size_t depth;
+		bool on;
+		bool shaped;
+	public:
+		explicit scoped_latency_timer(latency_entry entry_)
+			: entry(entry_), width(0), depth(0), on(latency_enabled.load(std::memory_order_relaxed)), shaped(false)
+		{
+			if (on)
+				start = std::chrono::steady_clock::now();
+		}
+
+		// the call is counted as one of width and depth; a call failing before is not counted
+		void shape(size_t width_, size_t depth_)
+		{
+			width = width_;
+			depth = depth_;
+			shaped = true;
+		}
+
+		~scoped_latency_timer()
+		{
+			if (on && shaped)
+				record_latency(entry, width, depth, (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - start).count());
+		}
+	};
+
+} // namespace sigcore
+
+#endif // Latency_h__
@@ -0,0 +1,339 @@
+// Memory.cpp : the allocator hooks and the counters behind Memory.h
+//
+// Every allocation is added to the totals and to the counters of the call the allocating
+// thread counts for, with those of the calls it is nested in, and every deallocation taken
+// from them, by relaxed atomic operations.
+//
+// Built with ESIG_COUNT_HEAP, it also replaces operator new and delete with ones that count
+// every block they hand out, taking the memory from malloc whatever the hooks and finding
+// the size of a block to give back from malloc itself. In tosig_batch and tosig_bench that
+// is every allocation of the process; in the module it is every one bound to its symbols,
+// which may include the C++ runtime's own. Each then costs a malloc_usable_size and a few
+// atomic operations, so it is a build for measuring, off by default
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include "Memory.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#ifdef ESIG_COUNT_HEAP
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#endif
+#endif
+
+namespace {
+
+	void* malloc_hook(size_t bytes, void*)
+	{
+		return malloc(bytes);
+	}
+
+	void free_hook(void* p, size_t, void*)
+	{
+		free(p);
+	}
+
+	const sigcore::allocator_hooks default_hooks = { &malloc_hook, &free_hook, NULL };
+
+	std::mutex& memory_lock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	sigcore::allocator_hooks& current_hooks()
+	{
+		static sigcore::allocator_hooks hooks = default_hooks;
+		return hooks;
+	}
+
+	// the totals; signed, as memory may be given back that was allocated before the
+	// counters were, as by operator new in the C++ runtime with ESIG_COUNT_HEAP
+	std::atomic<size_t> allocations(0);
+	std::atomic<size_t> bytes_allocated(0);
+	std::atomic<long long> bytes_in_use(0);
+	std::atomic<long long> peak_bytes_in_use(0);
+
+	sigcore::memory_counters entry_counters[sigcore::no_memory_entries];
+
+	// the call the thread counts for
+	thread_local sigcore::memory_call* current_call = NULL;
+
+	void raise_to(std::atomic<long long>& peak, long long value)
+	{
+		long long seen = peak.load(std::memory_order_relaxed);
+		while (seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+			;
+	}
+
+	size_t not_below_zero(long long value)
+	{
+		return (value > 0) ? (size_t) value : 0;
+	}
+
+	void count(long long bytes)
+	{
+		if (bytes > 0) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			bytes_allocated.fetch_add((size_t) bytes, std::memory_order_relaxed);
+		}
+		raise_to(peak_bytes_in_use, bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+		for (sigcore::memory_call* call = current_call; call != NULL; call = call->outer) {
+			if (bytes > 0) {
+				call->allocations.fetch_add(1, std::memory_order_relaxed);
+				call->bytes_allocated.fetch_add((size_t) bytes, std::memory_order_relaxed);
+			}
+			raise_to(call->peak_bytes_in_use, call->bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+		}
+	}
+
+#ifdef ESIG_COUNT_HEAP
+	// the bytes of a block from malloc, as many as were asked for or more
+	size_t block_size(void* p)
+	{
+#if defined(_WIN32)
+		return _msize(p);
+#elif defined(__APPLE__)
+		return malloc_size(p);
+#else
+		return malloc_usable_size(p);
+#endif
+	}
+
+	void* counted_new(size_t bytes, bool nothrow)
+	{
+		if (bytes == 0)
+			bytes = 1;
+		for (;;) {
+			void* ans = malloc(bytes);
+			if (ans != NULL) {
+				count((long long) block_size(ans));
+				return ans;
+			}
+			std::new_handler handler = std::get_new_handler();
+			if (handler == NULL) {
+				if (nothrow)
+					return NULL;
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+
+	void counted_delete(void* p)
+	{
+		if (p == NULL)
+			return;
+		count(-(long long) block_size(p));
+		free(p);
+	}
+#endif // ESIG_COUNT_HEAP
+
+} // namespace
+
+#ifdef ESIG_COUNT_HEAP
+
+void* operator new(size_t bytes)
+{
+	return counted_new(bytes, false);
+}
+
+void* operator new[](size_t bytes)
+{
+	return counted_new(bytes, false);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+	try {
+		return counted_new(bytes, true);
+	} catch (...) {
+		return NULL;
+	}
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+	try {
+		return counted_new(bytes, true);
+	} catch (...) {
+		return NULL;
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	counted_delete(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	counted_delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	counted_delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	counted_delete(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, size_t) noexcept
+{
+	counted_delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	counted_delete(p);
+}
+#endif
+
+#endif // ESIG_COUNT_HEAP
+
+namespace sigcore {
+
+	const char* const memory_entry_names[no_memory_entries] = { "signature", "log_signature", "recombine" };
+
+	allocator_hooks get_allocator_hooks()
+	{
+		std::lock_guard<std::mutex> guard(memory_lock());
+		return current_hooks();
+	}
+
+	void set_allocator_hooks(const allocator_hooks* hooks)
+	{
+		std::lock_guard<std::mutex> guard(memory_lock());
+		current_hooks() = (hooks != NULL) ? *hooks : default_hooks;
+	}
+
+	void* counted_allocate(size_t bytes, const allocator_hooks& hooks)
+	{
+		void* ans = hooks.allocate(bytes, hooks.context);
+		if (ans == NULL)
+			throw std::bad_alloc();
+		count((long long) bytes);
+		return ans;
+	}
+
+	void counted_deallocate(void* p, size_t bytes, const allocator_hooks& hooks)
+	{
+		if (p == NULL)
+			return;
+		hooks.deallocate(p, bytes, hooks.context);
+		count(-(long long) bytes);
+	}
+
+	void count_allocation(size_t bytes)
+	{
+		count((long long) bytes);
+	}
+
+	void count_deallocation(size_t bytes)
+	{
+		count(-(long long) bytes);
+	}
+
+	memory_stats get_memory_stats()
+	{
+		memory_stats ans;
+		ans.allocations = allocations.load();
+		ans.bytes_allocated = bytes_allocated.load();
+		ans.bytes_in_use = not_below_zero(bytes_in_use.load());
+		ans.peak_bytes_in_use = not_below_zero(peak_bytes_in_use.load());
+		std::lock_guard<std::mutex> guard(memory_lock());
+		for (size_t e = 0; e < no_memory_entries; ++e)
+			ans.entries[e] = entry_counters[e];
+		return ans;
+	}
+
+	void reset_memory_stats()
+	{
+		std::lock_guard<std::mutex> guard(memory_lock());
+		allocations.store(0);
+		bytes_allocated.store(0);
+		peak_bytes_in_use.store(bytes_in_use.load());
+		for (size_t e = 0; e < no_memory_entries; ++e)
+			entry_counters[e] = memory_counters();
+	}
+
+	size_t peak_rss_bytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#ifdef __APPLE__
+		return (size_t) usage.ru_maxrss;
+#else
+		return (size_t) usage.ru_maxrss * 1024;
+#endif
+#endif
+	}
+
+	memory_call* current_memory_call()
+	{
+		return current_call;
+	}
+
+	adopted_memory_call::adopted_memory_call(memory_call* call) : _previous(current_call)
+	{
+		current_call = call;
+	}
+
+	adopted_memory_call::~adopted_memory_call()
+	{
+		current_call = _previous;
+	}
+
+	memory_call_scope::memory_call_scope(memory_entry entry) : _entry(entry), _previous(current_call)
+	{
+		_call.outer = _previous;
+		current_call = &_call;
+	}
+
+	memory_call_scope::~memory_call_scope()
+	{
+		current_call = _previous;
+		const size_t peak = peak_bytes_in_use();
+		std::lock_guard<std::mutex> guard(memory_lock());
+		memory_counters& counters = entry_counters[_entry];
+		++counters.calls;
+		counters.allocations += _call.allocations.load();
+		counters.bytes_allocated += _call.bytes_allocated.load();
+		counters.last_peak_bytes_in_use = peak;
+		if (peak > counters.peak_bytes_in_use)
+			counters.peak_bytes_in_use = peak;
+	}
+
+	size_t memory_call_scope::peak_bytes_in_use() const
+	{
+		return not_below_zero(_call.peak_bytes_in_use.load());
+	}
+
+} // namespace sigcore
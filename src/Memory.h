@@ -0,0 +1,230 @@
+#ifndef Memory_h__
+#define Memory_h__
+// Memory.h : the allocator behind the arenas and the other buffers of tosig, which can be
+// replaced by a pair of hooks, and the accounting of the heap memory tosig takes, in total
+// and for each call of the signature, log signature and recombine entry points
+//
+// What is counted is what goes through the hooks, the arenas and the buffers of recombine,
+// and by their size the blocks held by code that cannot be routed through them, such as
+// the numpy arrays of the results, the expansion matrix of the recombine library and the
+// tables and containers tosig keeps on the heap, each counted with an external_bytes.
+// libalgebra's own tables are not counted unless tosig is built with ESIG_COUNT_HEAP,
+// which makes Memory.cpp replace operator new with a counting one
+//
+#include <stddef.h>
+#include <atomic>
+
+namespace sigcore {
+
+  /**
+   * allocator_hooks - a replacement for malloc and free; deallocate is given the size
+   * asked of allocate, and allocate returns NULL when out of memory
+   */
+	struct allocator_hooks
+	{
+		void* (*allocate)(size_t bytes, void* context);
+		void (*deallocate)(void* p, size_t bytes, void* context);
+		void* context;
+	};
+
+	// the hooks in use, malloc and free unless set_allocator_hooks says otherwise
+	allocator_hooks get_allocator_hooks();
+
+	// replaces the hooks, NULL restoring malloc and free; memory is given back through
+	// the hooks that allocated it, so the old ones must stay usable until it is
+	void set_allocator_hooks(const allocator_hooks* hooks);
+
+	// bytes from hooks, counted; throws std::bad_alloc if they return NULL
+	void* counted_allocate(size_t bytes, const allocator_hooks& hooks);
+
+	// gives back memory from counted_allocate through the hooks that allocated it
+	void counted_deallocate(void* p, size_t bytes, const allocator_hooks& hooks);
+
+	// counts bytes allocated, or freed, elsewhere, as counted_allocate and
+	// counted_deallocate would
+	void count_allocation(size_t bytes);
+	void count_deallocation(size_t bytes);
+
+#ifdef ESIG_COUNT_HEAP
+	const bool operator_new_counted = true;
+#else
+	// whether operator new is replaced by a counting one, see Memory.cpp
+	const bool operator_new_counted = false;
+#endif
+
+	enum memory_source
+	{
+		// memory of its own, such as a numpy array
+		external_memory,
+		// memory from operator new, already counted if operator_new_counted
+		heap_memory
+	};
+
+	// counts bytes from operator new that are kept beyond the call allocating them, such as
+	// a table built on first use, until count_heap_deallocation; nothing if operator new is
+	// counted already
+	inline void count_heap_allocation(size_t bytes)
+	{
+		if (!operator_new_counted)
+			count_allocation(bytes);
+	}
+
+	inline void count_heap_deallocation(size_t bytes)
+	{
+		if (!operator_new_counted)
+			count_deallocation(bytes);
+	}
+
+  /**
+   * external_bytes - counts as allocated, from its construction or add to its destruction,
+   * memory the hooks did not give, such as an output array or the vectors of a computation
+   */
+	class external_bytes
+	{
+	public:
+		explicit external_bytes(size_t bytes = 0, memory_source source = external_memory)
+			: _bytes(0), _counted(source == external_memory || !operator_new_counted)
+		{
+			add(bytes);
+		}
+
+		~external_bytes()
+		{
+			if (_bytes > 0)
+				count_deallocation(_bytes);
+		}
+
+		void add(size_t bytes)
+		{
+			if (!_counted)
+				return;
+			if (bytes > 0)
+				count_allocation(bytes);
+			_bytes += bytes;
+		}
+
+	private:
+		size_t _bytes;
+		bool _counted;
+
+		external_bytes(const external_bytes&);
+		external_bytes& operator=(const external_bytes&);
+	};
+
+	enum memory_entry
+	{
+		memory_signature,
+		memory_log_signature,
+		memory_recombine,
+		no_memory_entries
+	};
+
+	// the names of the entry points, as reported by tosig.get_memory_stats()
+	extern const char* const memory_entry_names[no_memory_entries];
+
+  /**
+   * memory_counters - what the calls of an entry point allocated, on their own threads and
+   * on the threads of the pool working for them; calls running at once on other threads
+   * count nothing of each other's
+   */
+	struct memory_counters
+	{
+		size_t calls;
+		size_t allocations;
+		size_t bytes_allocated;
+		// the most bytes a call held at once, beyond what was in use when it began, over
+		// all calls and in the last one
+		size_t peak_bytes_in_use;
+		size_t last_peak_bytes_in_use;
+
+		memory_counters()
+			: calls(0), allocations(0), bytes_allocated(0), peak_bytes_in_use(0), last_peak_bytes_in_use(0)
+		{
+		}
+	};
+
+  /**
+   * memory_stats - what was counted since reset_memory_stats, with the counters of each
+   * entry point
+   */
+	struct memory_stats
+	{
+		size_t allocations;
+		size_t bytes_allocated;
+		size_t bytes_in_use;
+		size_t peak_bytes_in_use;
+		memory_counters entries[no_memory_entries];
+	};
+
+	memory_stats get_memory_stats();
+
+	// zeroes the counters, the peak starting again from the bytes in use
+	void reset_memory_stats();
+
+	// the peak resident memory of the process over its lifetime, 0 if it cannot be found;
+	// not a figure of any one call
+	size_t peak_rss_bytes();
+
+  /**
+   * memory_call - the counters of one call, which the threads counting for it add to
+   */
+	struct memory_call
+	{
+		std::atomic<size_t> allocations;
+		std::atomic<size_t> bytes_allocated;
+		// signed, as a call may free what was allocated before it began
+		std::atomic<long long> bytes_in_use;
+		std::atomic<long long> peak_bytes_in_use;
+		// the call whose scope this one is nested in, which counts the same
+		memory_call* outer;
+
+		memory_call() : allocations(0), bytes_allocated(0), bytes_in_use(0), peak_bytes_in_use(0), outer(NULL)
+		{
+		}
+	};
+
+	// the call the calling thread counts for, NULL if none
+	memory_call* current_memory_call();
+
+  /**
+   * adopted_memory_call - makes the calling thread count for call while it lives, as a
+   * thread of the pool does for the call whose tasks it runs
+   */
+	class adopted_memory_call
+	{
+	public:
+		explicit adopted_memory_call(memory_call* call);
+		~adopted_memory_call();
+
+	private:
+		memory_call* _previous;
+
+		adopted_memory_call(const adopted_memory_call&);
+		adopted_memory_call& operator=(const adopted_memory_call&);
+	};
+
+  /**
+   * memory_call_scope - counts what the calling thread, and the pool threads working for
+   * it, allocate while it lives as one call of an entry point
+   */
+	class memory_call_scope
+	{
+	public:
+		explicit memory_call_scope(memory_entry entry);
+		~memory_call_scope();
+
+		// the most bytes held at once since the scope began
+		size_t peak_bytes_in_use() const;
+
+	private:
+		memory_entry _entry;
+		memory_call _call;
+		memory_call* _previous;
+
+		memory_call_scope(const memory_call_scope&);
+		memory_call_scope& operator=(const memory_call_scope&);
+	};
+
+} // namespace sigcore
+
+#endif // Memory_h__
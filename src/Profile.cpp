@@ -0,0 +1,63 @@
+// Profile.cpp : the counters behind Profile.h
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include "Profile.h"
+
+namespace {
+
+	std::mutex& profile_lock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	sigcore::profile& counters()
+	{
+		static sigcore::profile ans;
+		return ans;
+	}
+
+	bool profile_from_environment()
+	{
+		const char* value = getenv("ESIG_PROFILE");
+		return value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+	}
+
+} // namespace
+
+namespace sigcore {
+
+	const char* const profile_phase_names[no_profile_phases] = { "convert", "signature", "log", "project" };
+
+	std::atomic<bool> profiling_enabled(profile_from_environment());
+
+	bool set_profiling(bool on)
+	{
+		return profiling_enabled.exchange(on);
+	}
+
+	void add_to_profile(size_t width, size_t depth, profile_phase phase, double seconds)
+	{
+		std::lock_guard<std::mutex> guard(profile_lock());
+		profile_counters& entry = counters()[std::make_pair(width, depth)];
+		++entry.calls[phase];
+		entry.seconds[phase] += seconds;
+	}
+
+	profile get_profile()
+	{
+		std::lock_guard<std::mutex> guard(profile_lock());
+		return counters();
+	}
+
+	void reset_profile()
+	{
+		std::lock_guard<std::mutex> guard(profile_lock());
+		counters().clear();
+	}
+
+} // namespace sigcore
@@ -0,0 +1,89 @@
+#ifndef Profile_h__
+#define Profile_h__
+// Profile.h : optional timings of the phases of the signature computations, accumulated
+// by width and depth; off unless set_profiling(true) is called or ESIG_PROFILE is set in
+// the environment, in which case a phase timer costs one relaxed atomic load
+//
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <utility>
+
+namespace sigcore {
+
+	enum profile_phase
+	{
+		phase_convert,		// making the input a contiguous array of doubles
+		phase_signature,	// folding the increments into the signature
+		phase_log,			// the logarithm of the signature
+		phase_project,		// projecting the logarithm onto the Hall basis
+		no_profile_phases
+	};
+
+	// the names of the phases, as reported by tosig.get_profile()
+	extern const char* const profile_phase_names[no_profile_phases];
+
+  /**
+   * profile_counters - the number of times each phase ran and the seconds it took
+   */
+	struct profile_counters
+	{
+		size_t calls[no_profile_phases];
+		double seconds[no_profile_phases];
+
+		profile_counters()
+		{
+			std::fill(calls, calls + no_profile_phases, size_t(0));
+			std::fill(seconds, seconds + no_profile_phases, 0.);
+		}
+	};
+
+	typedef std::map<std::pair<size_t, size_t>, profile_counters> profile;
+
+	// whether the phase timers are running
+	extern std::atomic<bool> profiling_enabled;
+
+	// starts or stops the phase timers, returning whether they were running
+	bool set_profiling(bool on);
+
+	// adds a run of phase lasting seconds to the counters of width and depth; thread safe
+	void add_to_profile(size_t width, size_t depth, profile_phase phase, double seconds);
+
+	// a copy of the counters accumulated since the last reset_profile, by (width, depth)
+	profile get_profile();
+
+	void reset_profile();
+
+  /**
+   * scoped_phase_timer - adds the time from its construction to its destruction to a
+   * phase of the profile, as CScopedWindowsPerformanceTimer does to a double
+   */
+	class scoped_phase_timer
+	{
+		std::chrono::time_point<std::chrono::steady_clock> start;
+		size_t width;
+		size_t depth;
+		profile_phase phase;
+		bool on;
+	public:
+		scoped_phase_timer(size_t width_, size_t depth_, profile_phase phase_)
+			: width(width_), depth(depth_), phase(phase_),
+			on(profiling_enabled.load(std::memory_order_relaxed))
+		{
+			if (on)
+				start = std::chrono::steady_clock::now();
+		}
+
+		~scoped_phase_timer()
+		{
+			if (on)
+				add_to_profile(width, depth, phase,
+					std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	};
+
+} // namespace sigcore
+
+#endif // Profile_h__
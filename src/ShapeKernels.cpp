@@ -0,0 +1,146 @@
+// ShapeKernels.cpp : the libalgebra code for the widths ESIG_MIN_WIDTH to ESIG_MAX_WIDTH,
+// built once per range of tools/switch_generator.py into tosig_shapes_<min>_<max>
+//
+#include "stdafx.h"
+
+#include "libalgebra/libalgebra.h"
+#include <utility>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include "libalgebra/lie_basis.h"
+#include "ShapeKernels.h"
+
+#if !defined(ESIG_MIN_WIDTH) || !defined(ESIG_MAX_WIDTH)
+#error ESIG_MIN_WIDTH and ESIG_MAX_WIDTH must name a range of widths of switch_generator.py
+#endif
+
+namespace {
+
+	typedef double S;
+	typedef double Q;
+	using sigcore::log_projection;
+
+	struct fn0003 {
+		log_projection& _ans;
+		fn0003(log_projection& ans):_ans(ans)
+		{
+		}
+
+#ifndef LIBALGEBRA_VECTORS_H
+		template <class T>
+        void operator()(T& element)
+        {
+            _ans.row.push_back(element.first - 1);
+            _ans.value.push_back(element.second);
+        }
+#else
+        template <class T>
+        void operator()(T& element)
+        {
+            _ans.row.push_back(element.key() - 1);
+            _ans.value.push_back(element.value());
+        }
+#endif
+	};
+
+  /**
+   * LogProjectionT - tabulates t2l on each word of the tensor basis
+   * @param ans receives the map
+   */
+	template <size_t WIDTH, size_t DEPTH>
+	void LogProjectionT(log_projection& ans)
+	{
+		typedef alg::free_tensor<S, Q, WIDTH, DEPTH> TENSOR;
+		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
+		typedef alg::maps<S, Q, WIDTH, DEPTH> MAPS;
+		LIE::basis.growup(DEPTH);
+		ans.size = LIE::basis.size();
+		ans.start.assign(1, 0);
+		MAPS maps;
+		for (typename TENSOR::BASIS::KEY k = TENSOR::basis.begin();
+			k < TENSOR::basis.end(); k = TENSOR::basis.nextkey(k)) {
+			if (k.size() > 0) {
+				LIE image = maps.t2l(TENSOR(k, S(1)));
+				fn0003 ff(ans);
+				std::for_each(image.begin(), image.end(), ff);
+			}
+			ans.start.push_back(ans.row.size());
+		}
+	}
+
+  /**
+   * LogSigSizeT - computes size of the vectorised log-signature
+   * @return size of the vectorised log-signature
+   */
+	template <size_t WIDTH, size_t DEPTH>
+	size_t LogSigSizeT()
+	{
+		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
+		LIE::basis.growup(DEPTH);
+		return LIE::basis.size();
+	}
+
+	template <size_t WIDTH, size_t DEPTH>
+	std::string liebasis2stringT()
+	{
+		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
+
+		LIE::basis.growup(DEPTH);
+
+		std::string ans;
+		for (typename LIE::BASIS::KEY k = LIE::basis.begin(); k != LIE::basis.end();
+			k = LIE::basis.nextkey(k))
+			ans += std::string(" ") + LIE::basis.key2string(k);
+		return ans;
+	}
+
+	template <size_t WIDTH, size_t DEPTH>
+	std::string tensorbasis2stringT()
+	{
+		typedef alg::free_tensor<S, Q, WIDTH, DEPTH> TENSOR;
+
+		std::string ans;
+		for (typename TENSOR::BASIS::KEY k = TENSOR::basis.begin();
+			k < TENSOR::basis.end(); k = TENSOR::basis.nextkey(k))
+			ans += std::string(" (") + TENSOR::basis.key2string(k) +
+				std::string(")");
+		return ans;
+	}
+
+  /**
+   * ShapeKernelsT - the table of the functions above for one width and depth
+   */
+	template <size_t WIDTH, size_t DEPTH>
+	const sigcore::shape_kernels* ShapeKernelsT()
+	{
+		static const sigcore::shape_kernels ans = {
+			WIDTH,
+			DEPTH,
+			&LogSigSizeT<WIDTH, DEPTH>,
+			&tensorbasis2stringT<WIDTH, DEPTH>,
+			&liebasis2stringT<WIDTH, DEPTH>,
+			&LogProjectionT<WIDTH, DEPTH>
+		};
+		return &ans;
+	}
+
+} // namespace
+
+extern "C" ESIG_SHAPES_EXPORT const sigcore::shape_kernels* esig_shape_kernels(size_t width, size_t depth)
+{
+#define TemplatedFn(depth,width) ShapeKernelsT<depth,width>()
+#include "shape_switch.h"
+#undef TemplatedFn
+	// only get here if the template arguments are out of range
+	return NULL;
+}
+
+#if defined(_WIN32) && defined(ESIG_SHAPES_PYINIT)
+// setuptools links every extension as a Python module exporting PyInit_<name>; the
+// shared object is never imported, so this is never called
+extern "C" __declspec(dllexport) void* ESIG_SHAPES_PYINIT()
+{
+	return NULL;
+}
+#endif
@@ -0,0 +1,77 @@
+#ifndef ShapeKernels_h__
+#define ShapeKernels_h__
+// ShapeKernels.h : the parts of tosig that need libalgebra instantiated for each width
+// and depth of switch.h; every range of widths of tools/switch_generator.py is compiled
+// from ShapeKernels.cpp into a shared object of its own, tosig_shapes_<min>_<max>, which
+// is loaded the first time one of its widths is used, so a process pays only for the
+// shapes it uses
+//
+#include <stddef.h>
+#include <string>
+#include "ToSigCore.h"
+
+#if defined(_WIN32)
+#define ESIG_SHAPES_EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define ESIG_SHAPES_EXPORT __attribute__ ((__visibility__("default")))
+#else
+#define ESIG_SHAPES_EXPORT
+#endif
+
+namespace sigcore {
+
+  /**
+   * shape_range - a range of widths of tools/switch_generator.py compiled into a shared
+   * object of its own, with the greatest depth of its widths
+   */
+	struct shape_range
+	{
+		size_t min_width;
+		size_t max_width;
+		size_t max_depth;
+	};
+
+	const shape_range shape_ranges[] = {
+#include "shape_ranges.h"
+	};
+
+	const size_t no_shape_ranges = sizeof(shape_ranges) / sizeof(shape_ranges[0]);
+
+	// the range holding width, or NULL
+	inline const shape_range* find_shape_range(size_t width)
+	{
+		for (size_t r = 0; r < no_shape_ranges; ++r)
+			if (shape_ranges[r].min_width <= width && width <= shape_ranges[r].max_width)
+				return &shape_ranges[r];
+		return NULL;
+	}
+
+  /**
+   * shape_kernels - the libalgebra code for one width and depth
+   */
+	struct shape_kernels
+	{
+		size_t width;
+		size_t depth;
+		// the size of the log signature
+		size_t (*log_sig_size)();
+		// the keys of the signature and of the log signature, as returned by sigkeys and logsigkeys
+		std::string (*sig_keys)();
+		std::string (*log_sig_keys)();
+		// tabulates the map from signatures to log signatures into ans
+		void (*log_projection)(sigcore::log_projection& ans);
+	};
+
+	// the kernels for width and depth, loading the shared object of the range of width
+	// on first use; throws std::runtime_error if width or depth is out of range or the
+	// shared object cannot be loaded; safe to call from several threads
+	const shape_kernels& get_shape_kernels(size_t width, size_t depth);
+
+} // namespace sigcore
+
+// the function every shared object exports under the name ESIG_SHAPE_KERNELS_ENTRY:
+// the kernels for a width in its range and a depth, throwing as switch.h does otherwise
+typedef const sigcore::shape_kernels* (*shape_kernels_entry)(size_t width, size_t depth);
+#define ESIG_SHAPE_KERNELS_ENTRY "esig_shape_kernels"
+
+#endif // ShapeKernels_h__
@@ -0,0 +1,289 @@
+// SigWords.cpp : the signature at a chosen set of words
+//
+#include "stdafx.h"
+
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include "Arena.h"
+#include "Memory.h"
+#include "SigWords.h"
+
+namespace sigcore {
+
+	word_tree::word_tree(size_t width)
+		: _width(width), _depth(0), _parent(1, 0), _letter(1, 0), _length(1, 0)
+	{
+	}
+
+	size_t word_tree::extend(size_t node, size_t letter)
+	{
+		if (letter >= _width)
+			throw std::out_of_range("letter out of range for the width of the words");
+		std::map<std::pair<size_t, size_t>, size_t>::iterator it
+			= _children.find(std::make_pair(node, letter));
+		if (it != _children.end())
+			return it->second;
+		const size_t added = _parent.size();
+		_children[std::make_pair(node, letter)] = added;
+		_parent.push_back(node);
+		_letter.push_back(letter);
+		_length.push_back(_length[node] + 1);
+		_depth = std::max(_depth, _length[node] + 1);
+		return added;
+	}
+
+	size_t word_tree::insert(const size_t* word, size_t length)
+	{
+		size_t node = 0;
+		for (size_t i = 0; i < length; ++i)
+			node = extend(node, word[i]);
+		return node;
+	}
+
+	size_t word_tree::heap_bytes() const
+	{
+		// a node of a std::map holds its value beside a colour and three pointers
+		const size_t map_node = sizeof(std::map<std::pair<size_t, size_t>, size_t>::value_type) + 4 * sizeof(void*);
+		return (_parent.capacity() + _letter.capacity() + _length.capacity()) * sizeof(size_t)
+			+ _children.size() * map_node;
+	}
+
+	size_t weighted_words::heap_bytes() const
+	{
+		size_t ans = tree.heap_bytes()
+			+ (level_begin.capacity() + first_child.capacity() + fits.capacity()) * sizeof(size_t)
+			+ fitting_letters.capacity() * sizeof(std::vector<size_t>);
+		for (size_t m = 0; m < fitting_letters.size(); ++m)
+			ans += fitting_letters[m].capacity() * sizeof(size_t);
+		return ans;
+	}
+
+	std::vector<size_t> index_to_word(size_t index, size_t width, size_t depth)
+	{
+		// level k holds width^k coordinates starting at start
+		size_t start = 0, count = 1;
+		for (size_t k = 0; k <= depth; ++k) {
+			if (index - start < count) {
+				std::vector<size_t> word(k);
+				size_t position = index - start;
+				for (size_t i = k; i-- > 0; position /= width)
+					word[i] = position % width;
+				return word;
+			}
+			start += count;
+			count *= width;
+		}
+		throw std::out_of_range("signature coordinate index out of range");
+	}
+
+	word_tree weighted_word_tree(const size_t* weights, size_t width, size_t budget)
+	{
+		for (size_t a = 0; a < width; ++a)
+			if (weights[a] == 0)
+				throw std::invalid_argument("letter weights must be positive");
+
+		// the words of each length are grown from those one shorter, which are in lexicographic
+		// order, by each letter that keeps them within budget
+		word_tree tree(width);
+		std::vector<size_t> used(1, 0);
+		for (size_t begin = 0, end = 1; begin < end; begin = end, end = tree.size())
+			for (size_t node = begin; node < end; ++node)
+				for (size_t a = 0; a < width; ++a)
+					if (used[node] + weights[a] <= budget) {
+						tree.extend(node, a);
+						used.push_back(used[node] + weights[a]);
+					}
+		return tree;
+	}
+
+	std::shared_ptr<const weighted_words> get_weighted_words(const size_t* weights, size_t width, size_t budget)
+	{
+		typedef std::pair<std::vector<size_t>, size_t> key;
+		// the words and when they were last asked for
+		typedef std::pair<std::shared_ptr<const weighted_words>, size_t> entry;
+		static std::mutex lock;
+		static std::map<key, entry> cache;
+		static size_t uses = 0;
+		const key k(std::vector<size_t>(weights, weights + width), budget);
+		std::lock_guard<std::mutex> guard(lock);
+		std::map<key, entry>::iterator it = cache.find(k);
+		if (it != cache.end()) {
+			it->second.second = ++uses;
+			return it->second.first;
+		}
+
+		std::shared_ptr<weighted_words> made(new weighted_words(width));
+		weighted_words& ans = *made;
+		ans.tree = weighted_word_tree(weights, width, budget);
+		const word_tree& tree = ans.tree;
+		const size_t nodes = tree.size();
+
+		// the letters by weight, so that those fitting in what is left are a prefix
+		std::vector<size_t> by_weight(width);
+		for (size_t a = 0; a < width; ++a)
+			by_weight[a] = a;
+		std::stable_sort(by_weight.begin(), by_weight.end(),
+			[weights](size_t a, size_t b) { return weights[a] < weights[b]; });
+		ans.fitting_letters.resize(width + 1);
+		for (size_t m = 0; m <= width; ++m) {
+			ans.fitting_letters[m].assign(by_weight.begin(), by_weight.begin() + m);
+			std::sort(ans.fitting_letters[m].begin(), ans.fitting_letters[m].end());
+		}
+
+		std::vector<size_t> used(nodes, 0);
+		ans.level_begin.assign(tree.depth() + 2, nodes);
+		ans.first_child.assign(nodes, nodes);
+		ans.fits.resize(nodes);
+		for (size_t n = nodes; n-- > 0;)
+			ans.level_begin[tree.length(n)] = n;
+		for (size_t n = 1; n < nodes; ++n) {
+			used[n] = used[tree.parent(n)] + weights[tree.letter(n)];
+			if (ans.first_child[tree.parent(n)] == nodes)
+				ans.first_child[tree.parent(n)] = n;
+		}
+		for (size_t n = 0; n < nodes; ++n) {
+			size_t m = 0;
+			while (m < width && used[n] + weights[by_weight[m]] <= budget)
+				++m;
+			ans.fits[n] = m;
+		}
+
+		if (cache.size() == max_cached_weighted_words) {
+			std::map<key, entry>::iterator oldest = cache.begin();
+			for (it = cache.begin(); it != cache.end(); ++it)
+				if (it->second.second < oldest->second.second)
+					oldest = it;
+			count_heap_deallocation(oldest->second.first->heap_bytes());
+			cache.erase(oldest);
+		}
+		cache.insert(std::make_pair(k, entry(made, ++uses)));
+		count_heap_allocation(made->heap_bytes());
+		return made;
+	}
+
+	std::string word_key(const word_tree& tree, size_t node)
+	{
+		std::vector<size_t> letters;
+		for (; node != 0; node = tree.parent(node))
+			letters.push_back(tree.letter(node) + 1);
+		std::ostringstream ans;
+		ans << '(';
+		for (size_t i = letters.size(); i-- > 0;)
+			ans << letters[i] << (i > 0 ? "," : "");
+		ans << ')';
+		return ans.str();
+	}
+
+	void tree_signature(const word_tree& tree, const double* stream, size_t rows, double* values)
+	{
+		const size_t width = tree.width(), nodes = tree.size(), depth = tree.depth();
+		arena_scope scope;
+		double* increment = scope.allocate<double>(width);
+		double* inverse_factorial = scope.allocate<double>(depth + 1);
+		size_t* order = scope.allocate<size_t>(nodes);
+
+		inverse_factorial[0] = 1.;
+		for (size_t k = 1; k <= depth; ++k)
+			inverse_factorial[k] = inverse_factorial[k - 1] / double(k);
+
+		// the non-empty words longest first, so that when a word is updated its
+		// prefixes still hold their values from before the increment
+		size_t* first = scope.allocate<size_t>(depth + 2);
+		std::fill(first, first + depth + 2, size_t(0));
+		for (size_t n = 1; n < nodes; ++n)
+			++first[depth - tree.length(n) + 1];
+		for (size_t k = 1; k <= depth + 1; ++k)
+			first[k] += first[k - 1];
+		for (size_t n = 1; n < nodes; ++n)
+			order[first[depth - tree.length(n)]++] = n;
+
+		values[0] = 1.;
+		std::fill(values + 1, values + nodes, 0.);
+		for (size_t r = 1; r < rows; ++r) {
+			const double* previous = stream + (r - 1) * width;
+			const double* next = previous + width;
+			bool moved = false;
+			for (size_t i = 0; i < width; ++i)
+				moved |= (increment[i] = next[i] - previous[i]) != 0.;
+			if (!moved)
+				continue;
+
+			// Chen: S'(w) = sum over the splits w = uv of S(u) times the coordinate of exp(x)
+			// at v, which is the product of the increments along v divided by |v|!
+			for (size_t o = 0; o + 1 < nodes; ++o) {
+				const size_t n = order[o];
+				double product = 1., sum = 0.;
+				size_t node = n;
+				for (size_t k = 1; node != 0; ++k) {
+					product *= increment[tree.letter(node)];
+					if (product == 0.)
+						break; // so are the terms of the shorter prefixes
+					node = tree.parent(node);
+					sum += values[node] * product * inverse_factorial[k];
+				}
+				values[n] += sum;
+			}
+		}
+	}
+
+	void weighted_signature(const weighted_words& words, const double* stream, size_t rows, double* values)
+	{
+		const word_tree& tree = words.tree;
+		const size_t width = tree.width(), nodes = tree.size(), depth = tree.depth();
+		arena_scope scope;
+		double* increment = scope.allocate<double>(width);
+		// the increments of fitting_letters[m], at fitting[m (m - 1) / 2]
+		double* fitting = scope.allocate<double>(width * (width + 1) / 2 + 1);
+		size_t widest = 1;
+		for (size_t k = 1; k <= depth; ++k)
+			widest = std::max(widest, words.level_begin[k + 1] - words.level_begin[k]);
+		double* from = scope.allocate<double>(widest);
+		double* to = scope.allocate<double>(widest);
+
+		values[0] = 1.;
+		std::fill(values + 1, values + nodes, 0.);
+		for (size_t r = 1; r < rows; ++r) {
+			const double* previous = stream + (r - 1) * width;
+			const double* next = previous + width;
+			bool moved = false;
+			for (size_t i = 0; i < width; ++i)
+				moved |= (increment[i] = next[i] - previous[i]) != 0.;
+			if (!moved)
+				continue;
+			for (size_t m = 1; m <= width; ++m)
+				for (size_t c = 0; c < m; ++c)
+					fitting[m * (m - 1) / 2 + c] = increment[words.fitting_letters[m][c]];
+
+			// level k is updated from the old values of the shorter levels, so the longest
+			// words go first; the bracket of Horner's rule at level i, less S_i, is in from,
+			// and times x / (k - i) it goes to the children of each word, in to
+			for (size_t k = depth; k > 0; --k) {
+				for (size_t i = 0; i < k; ++i) {
+					const double scale = 1. / double(k - i);
+					const size_t begin = words.level_begin[i], end = words.level_begin[i + 1];
+					const size_t child_begin = end;
+					for (size_t u = begin; u < end; ++u) {
+						const size_t m = words.fits[u];
+						if (m == 0)
+							continue;
+						const double v = (values[u] + (i > 0 ? from[u - begin] : 0.)) * scale;
+						const double* x = fitting + m * (m - 1) / 2;
+						if (i + 1 == k) {
+							double* out = values + words.first_child[u];
+							for (size_t c = 0; c < m; ++c)
+								out[c] += v * x[c];
+						} else {
+							double* out = to + (words.first_child[u] - child_begin);
+							for (size_t c = 0; c < m; ++c)
+								out[c] = v * x[c];
+						}
+					}
+					std::swap(from, to);
+				}
+			}
+		}
+	}
+
+} // namespace sigcore
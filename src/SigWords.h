@@ -0,0 +1,140 @@
+#ifndef SigWords_h__
+#define SigWords_h__
+// SigWords.h : the coordinates of a signature at a chosen set of words, computed
+// without the rest of the tensor; does not need Python
+//
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace sigcore {
+
+  /**
+   * word_tree - a set of words in the letters 0 .. width - 1 closed under taking prefixes;
+   * node 0 is the empty word and node i > 0 is the word of node parent(i) followed by letter(i)
+   */
+	class word_tree
+	{
+	public:
+		explicit word_tree(size_t width);
+
+		size_t width() const
+		{
+			return _width;
+		}
+
+		// the number of nodes, the empty word included
+		size_t size() const
+		{
+			return _parent.size();
+		}
+
+		// the length of the longest word
+		size_t depth() const
+		{
+			return _depth;
+		}
+
+		size_t parent(size_t node) const
+		{
+			return _parent[node];
+		}
+
+		size_t letter(size_t node) const
+		{
+			return _letter[node];
+		}
+
+		size_t length(size_t node) const
+		{
+			return _length[node];
+		}
+
+		// the node of the word of node followed by letter, added if it is not in the tree
+		// yet; throws std::out_of_range if letter is not below width
+		size_t extend(size_t node, size_t letter);
+
+		// the node of the word of length letters at word, added along with its prefixes
+		// if it is not in the tree yet
+		size_t insert(const size_t* word, size_t length);
+
+		// about the bytes the tree holds on the heap, for the memory counters
+		size_t heap_bytes() const;
+
+	private:
+		size_t _width;
+		size_t _depth;
+		std::vector<size_t> _parent;
+		std::vector<size_t> _letter;
+		std::vector<size_t> _length;
+		std::map<std::pair<size_t, size_t>, size_t> _children;
+	};
+
+	// the word of the coordinate index of a signature of the given width laid out as by
+	// GetSig: level by level, the letters of a word being the digits, most significant
+	// first, of its position in its level written in base width; throws std::out_of_range
+	// if index is past the end of the signature truncated at depth
+	std::vector<size_t> index_to_word(size_t index, size_t width, size_t depth);
+
+	// the words in the letters 0 .. width - 1 whose weighted length, the sum of weights[a]
+	// over their letters a, is at most budget; the nodes are numbered by length and then
+	// lexicographically, the order of the coordinates of the full signature, so the values
+	// of tree_signature are those coordinates with the words over budget left out; throws
+	// std::invalid_argument if a weight is 0
+	word_tree weighted_word_tree(const size_t* weights, size_t width, size_t budget);
+
+  /**
+   * weighted_words - the tree of weighted_word_tree laid out for weighted_signature: its
+   * levels, each the words of one length, and the children of each word, which are
+   * contiguous in the next level and add the letters that fit in what is left of the
+   * budget; those are the lightest fits[node] letters, the same for every word with as
+   * much left, listed in fitting_letters[fits[node]]
+   */
+	struct weighted_words
+	{
+		word_tree tree;
+		// the nodes of length k are [level_begin[k], level_begin[k + 1])
+		std::vector<size_t> level_begin;
+		std::vector<size_t> first_child;
+		std::vector<size_t> fits;
+		std::vector<std::vector<size_t> > fitting_letters;
+
+		explicit weighted_words(size_t width) : tree(width)
+		{
+		}
+
+		// about the bytes held on the heap, for the memory counters
+		size_t heap_bytes() const;
+	};
+
+	// the most weighted_words get_weighted_words keeps, the least recently used being
+	// dropped to make room for another
+	const size_t max_cached_weighted_words = 8;
+
+	// the weighted_words of weights and budget, built on first use and kept while it is
+	// among the max_cached_weighted_words last used; the caller's pointer keeps it alive
+	// after that; throws std::invalid_argument if a weight is 0
+	std::shared_ptr<const weighted_words> get_weighted_words(const size_t* weights, size_t width, size_t budget);
+
+	// the key of node in the notation of sigkeys, such as "(1,2)", the letters counted from 1
+	std::string word_key(const word_tree& tree, size_t node);
+
+	// the coordinates of the signature of the rows rows of tree.width() doubles at stream
+	// at every node of tree, placed in values[node]; each increment updates each word by
+	// Chen's identity from the old values of its prefixes, so the cost is rows times the
+	// total length of the words in the tree, however few of them there are
+	void tree_signature(const word_tree& tree, const double* stream, size_t rows, double* values);
+
+	// the coordinates of the signature of the rows rows of words.tree.width() doubles at
+	// stream at every node of words.tree, placed in values[node]; each increment x is
+	// multiplied in level by level, longest words first, by Horner's rule, level k of S
+	// exp(x) being S_k + (S_{k-1} + (... + S_0 x / k ...) x / 2) x, so the cost is rows
+	// times a few multiplications per word, as for the dense signature
+	void weighted_signature(const weighted_words& words, const double* stream, size_t rows, double* values);
+
+} // namespace sigcore
+
+#endif // SigWords_h__
@@ -0,0 +1,392 @@
+// ThreadPool.cpp : the worker threads shared by the parallel kernels
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include "Memory.h"
+#include "ThreadPool.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+  /**
+   * job - the tasks of one parallel_for, claimed one index at a time
+   * helpers and active are guarded by the lock of the pool the job was posted to; memory is
+   * the call the thread posting the job counts its memory for, which its helpers count for too
+   */
+	struct job
+	{
+		const std::function<void(size_t)>* task;
+		size_t n;
+		std::atomic<size_t> next;
+		size_t helpers;
+		size_t active;
+		std::mutex error_lock;
+		std::exception_ptr error;
+		sigcore::memory_call* memory;
+
+		job(const std::function<void(size_t)>* t, size_t count, size_t h)
+			: task(t), n(count), next(0), helpers(h), active(0), memory(sigcore::current_memory_call())
+		{
+		}
+
+		// runs tasks until none are left; after an exception the remaining ones are skipped
+		void run()
+		{
+			for (size_t i = next++; i < n; i = next++) {
+				try {
+					(*task)(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> guard(error_lock);
+					if (!error)
+						error = std::current_exception();
+					next = n;
+				}
+			}
+		}
+	};
+
+  /**
+   * pool_state - the queue of jobs and the workers serving it; every worker holds a reference
+   * so a pool that has been replaced lives until its last worker has left
+   */
+	struct pool_state
+	{
+		std::mutex lock;
+		std::condition_variable wake;
+		std::condition_variable idle;
+		std::deque<job*> jobs;
+		size_t workers;
+		bool stopping;
+
+		explicit pool_state(size_t w) : workers(w), stopping(false)
+		{
+		}
+	};
+
+	void worker_loop(std::shared_ptr<pool_state> state)
+	{
+		std::unique_lock<std::mutex> guard(state->lock);
+		for (;;) {
+			while (!state->stopping && state->jobs.empty())
+				state->wake.wait(guard);
+			if (state->stopping)
+				return;
+			job* j = state->jobs.front();
+			if (--j->helpers == 0)
+				state->jobs.pop_front();
+			++j->active;
+			guard.unlock();
+			{
+				sigcore::adopted_memory_call counting(j->memory);
+				j->run();
+			}
+			guard.lock();
+			if (--j->active == 0)
+				state->idle.notify_all();
+		}
+	}
+
+	// the pool in use and the thread count asked for, guarded by registry_lock; current is
+	// a pointer so that a child process can abandon the parent's pool without touching it
+	std::mutex registry_lock;
+	std::shared_ptr<pool_state>* current = NULL;
+	size_t requested = 0;
+	size_t detected = 0;
+
+#ifndef _WIN32
+	// a forked child has none of the parent's workers: hold the registry across the fork
+	// so it is consistent, then let the child start a fresh pool on its first parallel_for
+	void before_fork()
+	{
+		registry_lock.lock();
+	}
+
+	void after_fork_in_parent()
+	{
+		registry_lock.unlock();
+	}
+
+	void after_fork_in_child()
+	{
+		current = NULL;
+		registry_lock.unlock();
+	}
+#endif
+
+	void retire(std::shared_ptr<pool_state>* pool)
+	{
+		if (pool != NULL) {
+			{
+				std::lock_guard<std::mutex> guard((*pool)->lock);
+				(*pool)->stopping = true;
+			}
+			(*pool)->wake.notify_all();
+			delete pool;
+		}
+	}
+
+  /**
+   * get_pool - the pool, started or resized to size - 1 workers under the registry lock
+   */
+	std::shared_ptr<pool_state> get_pool(size_t size)
+	{
+		const size_t workers = size - 1;
+		if (current != NULL && (*current)->workers == workers)
+			return *current;
+#ifndef _WIN32
+		static bool registered = false;
+		if (!registered) {
+			pthread_atfork(before_fork, after_fork_in_parent, after_fork_in_child);
+			registered = true;
+		}
+#endif
+		retire(current);
+		current = new std::shared_ptr<pool_state>(new pool_state(workers));
+		for (size_t t = 0; t < workers; ++t)
+			std::thread(worker_loop, *current).detach();
+		return *current;
+	}
+
+  /**
+   * read_number - the first number in a file, if it opens and starts with one
+   */
+	bool read_number(const std::string& path, long long& value)
+	{
+		std::ifstream in(path.c_str());
+		return static_cast<bool>(in >> value);
+	}
+
+  /**
+   * cgroup_cpu_limit - the cpu quota of the cgroup of this process rounded up to whole cores,
+   * or 0 if there is none; cgroup v2 keeps "quota period" in cpu.max, v1 two separate files
+   */
+	size_t cgroup_cpu_limit()
+	{
+		long long quota = 0, period = 0;
+		std::vector<std::string> v2;
+		std::ifstream self("/proc/self/cgroup");
+		std::string line;
+		while (std::getline(self, line))
+			if (line.compare(0, 3, "0::") == 0 && line.size() > 4)
+				v2.push_back("/sys/fs/cgroup" + line.substr(3) + "/cpu.max");
+		v2.push_back("/sys/fs/cgroup/cpu.max");
+		for (size_t i = 0; i < v2.size(); ++i) {
+			std::ifstream in(v2[i].c_str());
+			std::string max;
+			if (in >> max) {
+				if (max != "max" && (in >> period))
+					quota = atoll(max.c_str());
+				break;
+			}
+		}
+		if (quota <= 0) {
+			const char* v1[] = { "/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct" };
+			for (size_t i = 0; i < 2 && quota <= 0; ++i)
+				if (!read_number(std::string(v1[i]) + "/cpu.cfs_quota_us", quota)
+					|| !read_number(std::string(v1[i]) + "/cpu.cfs_period_us", period))
+					quota = 0;
+		}
+		if (quota <= 0 || period <= 0)
+			return 0;
+		return std::max<size_t>(size_t((quota + period - 1) / period), 1);
+	}
+
+  /**
+   * run_queue - the tasks [begin, end) still to be done by one worker of parallel_for_stealing;
+   * the owner takes them from the front and thieves from the back
+   */
+	struct run_queue
+	{
+		std::mutex lock;
+		size_t begin;
+		size_t end;
+
+		run_queue() : begin(0), end(0)
+		{
+		}
+	};
+
+  /**
+   * steal - moves the back half by weight of the heaviest queue other than own into own
+   * @return false if every queue is empty
+   */
+	bool steal(std::vector<run_queue>& queues, size_t own, const size_t* cumulative)
+	{
+		for (;;) {
+			size_t victim = queues.size(), heaviest = 0;
+			for (size_t q = 0; q < queues.size(); ++q) {
+				if (q == own)
+					continue;
+				std::lock_guard<std::mutex> guard(queues[q].lock);
+				if (queues[q].begin < queues[q].end
+					&& cumulative[queues[q].end] - cumulative[queues[q].begin] >= heaviest) {
+					heaviest = cumulative[queues[q].end] - cumulative[queues[q].begin];
+					victim = q;
+				}
+			}
+			if (victim == queues.size())
+				return false;
+			size_t begin, end;
+			{
+				std::lock_guard<std::mutex> guard(queues[victim].lock);
+				begin = queues[victim].begin;
+				end = queues[victim].end;
+				if (begin >= end)
+					continue; // emptied meanwhile, look again
+				// the thief takes the back half by weight, or the last task if there is only one
+				const size_t half = (cumulative[begin] + cumulative[end]) / 2;
+				size_t middle = begin;
+				if (end - begin > 1)
+					middle = std::min<size_t>(std::lower_bound(cumulative + begin + 1, cumulative + end, half)
+						- cumulative, end - 1);
+				queues[victim].end = middle;
+				begin = middle;
+			}
+			std::lock_guard<std::mutex> guard(queues[own].lock);
+			queues[own].begin = begin;
+			queues[own].end = end;
+			return true;
+		}
+	}
+
+} // namespace
+
+namespace sigcore {
+
+	size_t default_num_threads()
+	{
+		const char* env = getenv("ESIG_NUM_THREADS");
+		if (env != NULL && atoi(env) > 0)
+			return size_t(atoi(env));
+		size_t n = std::max(std::thread::hardware_concurrency(), 1u);
+#ifdef __linux__
+		cpu_set_t set;
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+			n = std::max(CPU_COUNT(&set), 1);
+		const size_t limit = cgroup_cpu_limit();
+		if (limit > 0)
+			n = std::min(n, limit);
+#endif
+		return n;
+	}
+
+	size_t get_num_threads()
+	{
+		std::lock_guard<std::mutex> guard(registry_lock);
+		if (requested > 0)
+			return requested;
+		if (detected == 0)
+			detected = default_num_threads();
+		return detected;
+	}
+
+	void set_num_threads(size_t n)
+	{
+		std::lock_guard<std::mutex> guard(registry_lock);
+		requested = n;
+	}
+
+	void parallel_for(size_t n, const std::function<void(size_t)>& task, size_t threads)
+	{
+		const size_t size = get_num_threads();
+		if (threads == 0 || threads > size)
+			threads = size;
+		threads = std::min(threads, n);
+		if (threads <= 1) {
+			for (size_t i = 0; i < n; ++i)
+				task(i);
+			return;
+		}
+
+		std::shared_ptr<pool_state> pool;
+		{
+			std::lock_guard<std::mutex> guard(registry_lock);
+			pool = get_pool(size);
+		}
+		job work(&task, n, threads - 1);
+		{
+			std::lock_guard<std::mutex> guard(pool->lock);
+			pool->jobs.push_back(&work);
+		}
+		if (threads == 2)
+			pool->wake.notify_one();
+		else
+			pool->wake.notify_all();
+		work.run();
+
+		// take the job off the queue if no worker got to it, then wait for those that did
+		{
+			std::unique_lock<std::mutex> guard(pool->lock);
+			std::deque<job*>::iterator it = std::find(pool->jobs.begin(), pool->jobs.end(), &work);
+			if (it != pool->jobs.end())
+				pool->jobs.erase(it);
+			while (work.active > 0)
+				pool->idle.wait(guard);
+		}
+		if (work.error)
+			std::rethrow_exception(work.error);
+	}
+
+	size_t stealing_workers(size_t n, size_t threads)
+	{
+		if (threads == 0)
+			threads = get_num_threads();
+		return std::max<size_t>(std::min(threads, n), 1);
+	}
+
+	void parallel_for_stealing(size_t n, const size_t* cumulative,
+		const std::function<void(size_t, size_t)>& task, size_t threads)
+	{
+		const size_t workers = stealing_workers(n, threads);
+		if (workers == 1) {
+			for (size_t i = 0; i < n; ++i)
+				task(i, 0);
+			return;
+		}
+
+		// worker w starts with the tasks beginning in the w-th share of the total weight
+		std::vector<run_queue> queues(workers);
+		const size_t total = cumulative[n] - cumulative[0];
+		for (size_t w = 0; w < workers; ++w) {
+			queues[w].begin = std::lower_bound(cumulative, cumulative + n,
+				cumulative[0] + total * w / workers) - cumulative;
+			if (w > 0)
+				queues[w - 1].end = queues[w].begin;
+		}
+		queues[workers - 1].end = n;
+
+		parallel_for(workers, [&](size_t w) {
+			for (;;) {
+				size_t i = n;
+				{
+					std::lock_guard<std::mutex> guard(queues[w].lock);
+					if (queues[w].begin < queues[w].end)
+						i = queues[w].begin++;
+				}
+				if (i < n)
+					task(i, w);
+				else if (!steal(queues, w, cumulative))
+					return;
+			}
+		}, workers);
+	}
+
+} // namespace sigcore
@@ -0,0 +1,45 @@
+#ifndef ThreadPool_h__
+#define ThreadPool_h__
+// ThreadPool.h : the one pool of worker threads shared by every parallel kernel
+// in esig, created on first use and recreated after a fork; does not need Python
+//
+#include <stddef.h>
+#include <functional>
+
+namespace sigcore {
+
+	// the number of threads a parallel_for asked for 0 threads uses, set_num_threads
+	// if it has been called and default_num_threads otherwise
+	size_t get_num_threads();
+
+	// use n threads from now on, 0 restores default_num_threads; the pool is
+	// resized on the next parallel_for
+	void set_num_threads(size_t n);
+
+	// the cores this process may use: the cpu affinity mask, capped by the cgroup
+	// cpu quota when there is one, or ESIG_NUM_THREADS if that is set
+	size_t default_num_threads();
+
+	// runs task(i) for each i in [0, n) on at most threads threads of the pool
+	// (0 uses get_num_threads()), the calling thread taking its share, and returns
+	// when all are done; the first exception thrown by a task is rethrown here.
+	// parallel_for may be called from inside a task, which then waits on no thread
+	// but the ones already working for it
+	void parallel_for(size_t n, const std::function<void(size_t)>& task, size_t threads = 0);
+
+	// runs task(i, worker) for each i in [0, n) like parallel_for, for tasks of uneven
+	// cost: task i weighs cumulative[i + 1] - cumulative[i], the indices are dealt out
+	// in contiguous runs of about equal weight, one per worker, and a worker that
+	// finishes its run steals the back half of the heaviest run left; worker is below
+	// stealing_workers(n, threads) and no two tasks of the same worker run at once,
+	// so it can index per-worker scratch space
+	void parallel_for_stealing(size_t n, const size_t* cumulative,
+		const std::function<void(size_t, size_t)>& task, size_t threads = 0);
+
+	// the number of workers parallel_for_stealing uses for n tasks on threads threads
+	// (0 uses get_num_threads())
+	size_t stealing_workers(size_t n, size_t threads);
+
+} // namespace sigcore
+
+#endif // ThreadPool_h__
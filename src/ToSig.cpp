@@ -3,36 +3,60 @@
 #include "ToSig.h" //Python.h must come first
 #include "stdafx.h"
 
-#include "libalgebra/libalgebra.h"
 #include <utility>
 #include <iostream>
 #include "libalgebra/constpower.h"
 #include <vector>
 #include <algorithm>
 #include <string>
-#include "libalgebra/lie_basis.h"
+#include <exception>
+#include <stdexcept>
+#include "Arena.h"
+#include "DenseTensor.h"
+#include "Memory.h"
+#include "Profile.h"
+#include "ShapeKernels.h"
+#include "SigWords.h"
+#include "ToSigCore.h"
+#include "ThreadPool.h"
 
 //#include <lie_basis.h>
 namespace {
 
 	typedef double S;
 	typedef double Q;
-        
+
   /**
-   * row_to_lie - replaces vector_to_lie
-   * @param stream pointer to stream as PyArrayObject, assumed to have two dimensions, the row is assumed to be of length WIDTH
-   * @param rowId index of row to be converted to LIE
-   * @return row as LIE (the entries in the row are coefficients of the letters) 
+   * released_gil - lets other Python threads run while it lives, as Py_BEGIN_ALLOW_THREADS
+   * does, taking the GIL back however its scope is left; nothing in its scope may touch a
+   * Python object other than through the fields of the arrays it was given
    */
-	template <class LIE, size_t WIDTH>
-	LIE row_to_lie(PyArrayObject *stream, npy_intp rowId)
+	class released_gil
 	{
-		LIE ans;
-		for (alg::LET i = 1; i <= WIDTH; ++i)
-		  ans += LIE(i, *((S*) PyArray_GETPTR2(stream,rowId,(npy_intp) i-1)) );
+		PyThreadState* state;
+
+		released_gil(const released_gil&);
+		released_gil& operator=(const released_gil&);
+	public:
+		released_gil() : state(PyEval_SaveThread())
+		{
+		}
+
+		~released_gil()
+		{
+			PyEval_RestoreThread(state);
+		}
+	};
+
+	// the bytes of the data of an array, from its fields, as the numpy API is not imported here
+	size_t array_bytes(PyArrayObject* array)
+	{
+		size_t ans = (size_t) PyArray_ITEMSIZE(array);
+		for (int d = 0; d < PyArray_NDIM(array); ++d)
+			ans *= (size_t) PyArray_DIM(array, d);
 		return ans;
 	}
-  
+        
  /*
 	template <class LIE, class STATE, size_t WIDTH>
 	LIE vector_to_lie(const STATE& arg)
@@ -45,36 +69,48 @@ namespace {
   */
 
   /**
-   * GetLogSignature
+   * GetLogSignature - the log-signature of a stream folded row by row into a running state
+   * each increment is multiplied into the signature, held as a dense tensor, as soon as its row is
+   * read, and the logarithm of the result is projected onto the Hall basis at the end, which is
+   * what cbh.full does with the increments; memory does not depend on the length of the stream
    * @param stream pointer to stream as PyArrayObject, assumed to have two dimensions, the row is assumed to be of length WIDTH
-   * @return the log signature of the stream as LIE
+   * @param out receives the log signature, GetLogSigT<WIDTH, DEPTH>() doubles
    */
-	template <class LIE, class CBH, size_t WIDTH>
-	LIE GetLogSignature(PyArrayObject *stream)
+	template <size_t WIDTH, size_t DEPTH>
+	void GetLogSignature(PyArrayObject *stream, S* out)
 	{
-	  npy_intp numRows = PyArray_DIM(stream, 0);
-		std::vector<LIE> increments;
-		if (numRows > 0) {
-		  npy_intp rowId = 0;
-		  LIE previous = row_to_lie<LIE, WIDTH>(stream,rowId++);
-
-		  for (; rowId < numRows; ++rowId) {
-			  LIE next(row_to_lie<LIE, WIDTH>(stream,rowId));
-			  increments.push_back(next - previous);
-			  previous = next;
-		  }
+		const dense::tensor_layout layout(WIDTH, DEPTH);
+		// tabulated, on first use, under the interpreter lock, as the labels and sizes
+		// that touch the same libalgebra bases are
+		const sigcore::log_projection& projection = sigcore::get_log_projection(WIDTH, DEPTH);
+		sigcore::arena_scope scope;
+		S* sig = scope.allocate<S>(layout.size());
+		S* scratch = scope.allocate<S>(dense::scratch_size(layout));
+		S* previous = scope.allocate<S>(WIDTH);
+		S* next = scope.allocate<S>(WIDTH);
+		std::fill(sig, sig + layout.size(), S(0));
+		sig[0] = S(1);
+		{
+			// the rows are read through the fields of the array, so other threads may run meanwhile
+			released_gil unlocked;
+			// the rows are read as they are folded in, so reading them is part of this phase
+			sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_signature);
+			const npy_intp numRows = PyArray_DIM(stream, 0);
+			for (npy_intp rowId = 0; rowId < numRows; ++rowId) {
+				for (npy_intp i = 0; i < (npy_intp) WIDTH; ++i)
+					next[i] = *((S*) PyArray_GETPTR2(stream, rowId, i));
+				if (rowId > 0)
+					dense::extend_signature(layout, sig, previous, next, 1, scratch);
+				std::swap(previous, next);
+			}
 		}
-#ifndef LIBALGEBRA_VECTORS_H
-		std::vector<LIE*> pincrements;
-#else
-		std::vector<const LIE*> pincrements;
-#endif
-		pincrements.reserve(increments.size());
-		for (typename std::vector<LIE>::iterator it = increments.begin();
-			it != increments.end(); ++it)
-		  pincrements.push_back(&(*it));
-		CBH cbh;
-		return (pincrements.size() != 0) ? cbh.full(pincrements) : LIE();
+		S* logsig = scope.allocate<S>(layout.size());
+		{
+			sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_log);
+			dense::log(layout, logsig, sig);
+		}
+		sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_project);
+		projection.apply(logsig, out);
 	}
   /*
 	template <class LIE, class STATE, class CBH, size_t WIDTH>
@@ -101,164 +137,77 @@ namespace {
   */
 
   /**
-   * KeyToIndexRec - recursive helper function used in KeyToIndex
-   */
-	template <class TENSOR, size_t WIDTH>
-	inline std::pair<size_t, typename TENSOR::BASIS::KEY> KeyToIndexRec(size_t i,typename TENSOR::BASIS::KEY k){	
-		return k.size() ? KeyToIndexRec<TENSOR,WIDTH>(i*WIDTH+k.FirstLetter(),k.rparent()) : std::make_pair(i,k) ;
-	}
-
-  /**
-   * KeyToIndex - computes the position of a key in the vectorised tensor
-   * @param k tensor key
-   * @return position as index
+   * chunked_signature - the signature of a stream split into chunks of at least min_chunk_rows
+   * increments whose signatures are computed on the thread pool and then multiplied together
+   * in a tree; the Chen product is associative so the answer is that of the serial fold
+   * consecutive chunks share their boundary row so that no increment is lost
+   * @param threads the maximum number of chunks, 0 uses get_num_threads()
+   * @return false if the stream is too short to be split, in which case out is untouched
    */
-	template <class TENSOR, size_t WIDTH>
-	inline size_t KeyToIndex(typename TENSOR::BASIS::KEY k)
-	{		
-		return KeyToIndexRec<TENSOR,WIDTH>(0,k).first;
-		//return (k.size()) ? k.FirstLetter() + WIDTH * KeyToIndex<TENSOR, WIDTH>(k.rparent()) : 0; // incorrect version, commented out
-	}
-  /*
-	template <class TENSOR, size_t WIDTH>
-	inline size_t KeyToIndex(typename TENSOR::BASIS::KEY k)
-	{
-		return (k.size()) ? k.FirstLetter() + WIDTH * KeyToIndex<TENSOR,
-			WIDTH>(k.rparent()) : 0;
-	}
-  */
-
-	template <class VECTOR, class TENSOR, size_t WIDTH>
-	struct fn0001 {
-		VECTOR& _ans;
-		fn0001(VECTOR& ans):_ans(ans)
-		{
-		}
-#ifndef LIBALGEBRA_VECTORS_H
-		template <class T>
-        void operator()(T& element)
-        {
-            _ans[KeyToIndex<TENSOR, WIDTH>(element.first)] = element.second;
-        }
-#else
-        template <typename T>
-        void operator()(T& element)
-        {
-		    _ans[KeyToIndex<TENSOR, WIDTH>(element.key())] = element.value();
-        }
-#endif
-
-	};
-
-	//[&ans] (const decltype(*(arg.begin()))& element){
-	//	ans[KeyToIndex<TENSOR, WIDTH>(element.first)] = element.second;
-	//}
-
-
-	template <class S, class TENSOR, size_t WIDTH, size_t DEPTH>
-	void unpack_tensor_to_SNK(const TENSOR& arg, PyArrayObject *snk)
+	bool chunked_signature(const dense::tensor_layout& layout, S* out, const S* stream, size_t rows,
+		size_t threads, size_t min_chunk_rows)
 	{
-		const size_t unpacked_tensor_dimension = (WIDTH > 1)
-			? ((size_t(alg::ConstPower < WIDTH, DEPTH + 1 > ::ans) - 1) / (WIDTH -
-			1))
-			: WIDTH * DEPTH + 1 ;
-
-		std::vector<S> ans(unpacked_tensor_dimension, 0);
-		fn0001<std::vector<S>, TENSOR, WIDTH> ff(ans);
-		std::for_each(arg.begin(), arg.end(), ff);
-		//std::copy(ans.begin(), ans.end(), snk);
-		//return ans;
-		for(npy_intp i=0; i<(npy_intp) unpacked_tensor_dimension; ++i)
-		  *((double *)PyArray_GETPTR1(snk,i)) = ans[i];
-	}
-
-	template <class VECTOR>
-	struct fn0002 {
-		VECTOR& _ans;
-		fn0002(VECTOR& ans):_ans(ans)
-		{
+		if (threads == 0)
+			threads = sigcore::get_num_threads();
+		const size_t increments = (rows > 0) ? rows - 1 : 0;
+		const size_t chunks = std::min(threads, increments / std::max<size_t>(min_chunk_rows, 1));
+		if (chunks < 2)
+			return false;
+
+		const size_t size = layout.size();
+		sigcore::arena_scope scope;
+		S* partial = scope.allocate<S>(chunks * size);
+		std::exception_ptr error;
+		Py_BEGIN_ALLOW_THREADS
+		try {
+			sigcore::parallel_for(chunks, [&](size_t c) {
+				sigcore::arena_scope task_scope;
+				S* scratch = task_scope.allocate<S>(dense::scratch_size(layout));
+				const size_t begin = increments * c / chunks, end = increments * (c + 1) / chunks;
+				dense::signature(layout, &partial[c * size], stream + begin * layout.width,
+					end - begin + 1, scratch);
+			}, chunks);
+
+			// pairs at distance stride are combined independently, halving the partials each round
+			for (size_t stride = 1; stride < chunks; stride *= 2) {
+				const size_t pairs = (chunks - stride + 2 * stride - 1) / (2 * stride);
+				sigcore::parallel_for(pairs, [&](size_t p) {
+					const size_t c = 2 * stride * p;
+					dense::mul_inplace(layout, &partial[c * size], &partial[(c + stride) * size], layout.depth);
+				}, pairs);
+			}
+		} catch (...) {
+			error = std::current_exception();
 		}
-
-#ifndef LIBALGEBRA_VECTORS_H
-		template <class T>
-        void operator()(T& element)
-        {
-            _ans[element.first - 1] = element.second;
-        }
-#else
-        template <class T>
-        void operator()(T& element)
-        {
-            _ans[element.key() - 1] = element.value();
-        }
-#endif
-	};
-
-	template <class S, class LIE, size_t WIDTH, size_t DEPTH>
-	void unpack_lie_to_SNK(const LIE& arg, PyArrayObject *snk)
-	{
-		// basis is a static public element of every object derived from algebra
-		// expand the basis so it spans the lie elements of our degree to fix the basis
-		LIE::basis.growup(DEPTH);
-		size_t basis_size = LIE::basis.size();
-		std::vector<S> ans(basis_size);
-		fn0002<std::vector<S> > ff(ans);
-		std::for_each(arg.begin(), arg.end(), ff);
-		//std::copy(ans.begin(), ans.end(), snk);
-		//return ans;
-		for(npy_intp i=0; i<(npy_intp) basis_size; ++i)
-		  *((double *)PyArray_GETPTR1(snk,i)) = ans[i];
-	}
-
-	template <size_t WIDTH, size_t DEPTH>
-	std::string liebasis2stringT()
-	{
-		typedef double S;
-		typedef double Q;
-		//typedef alg::free_tensor<S, Q, WIDTH, DEPTH> TENSOR;
-		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
-
-		LIE::basis.growup(DEPTH);
-
-		std::string ans;
-		for (typename LIE::BASIS::KEY k = LIE::basis.begin(); k != LIE::basis.end();
-			k = LIE::basis.nextkey(k))
-			ans += std::string(" ") + LIE::basis.key2string(k);
-		return ans;
-	}
-
-	template <size_t WIDTH, size_t DEPTH>
-	std::string tensorbasis2stringT()
-	{
-		typedef double S;
-		typedef double Q;
-		typedef alg::free_tensor<S, Q, WIDTH, DEPTH> TENSOR;
-		//typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
-
-		std::string ans;
-		for (typename TENSOR::BASIS::KEY k = TENSOR::basis.begin();
-			k < TENSOR::basis.end(); k = TENSOR::basis.nextkey(k))
-			ans += std::string(" (") + TENSOR::basis.key2string(k) +
-				std::string(")");
-		return ans;
+		Py_END_ALLOW_THREADS
+		if (error)
+			std::rethrow_exception(error);
+		std::copy(partial, partial + size, out);
+		return true;
 	}
 
   /**
    * GetSigT - computes the signature of a stream into snk
-   * @param stream pointer to stream as PyArrayObject, assumed to have two dimensions, the row is assumed to be of length WIDTH
+   * the Chen update is applied increment by increment on the dense tensor, using the
+   * vectorised kernels selected for this cpu, rather than going through the log-signature
+   * @param stream pointer to stream as PyArrayObject, assumed to be a C-contiguous array of doubles with two dimensions, the row is assumed to be of length WIDTH
    * @param snk pointer to C array, the result is written into this array
+   * @param threads if not 1, long streams are split into chunks reduced in parallel (0 uses get_num_threads())
+   * @param min_chunk_rows the fewest increments worth giving a thread of their own
    */
 	template <size_t WIDTH, size_t DEPTH>
-	bool GetSigT(PyArrayObject *stream, PyArrayObject *snk)
+	bool GetSigT(PyArrayObject *stream, PyArrayObject *snk, size_t threads, size_t min_chunk_rows)
 	{
-		typedef alg::free_tensor<S, Q, WIDTH, DEPTH> TENSOR;
-		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
-		typedef alg::maps<S, Q, WIDTH, DEPTH> MAPS;
-		typedef alg::cbh<S, Q, WIDTH, DEPTH> CBH;
-		LIE logans = GetLogSignature<LIE, CBH, WIDTH>(stream);
-		MAPS maps;
-		TENSOR signature = exp(maps.l2t(logans));
-		unpack_tensor_to_SNK<S, TENSOR, WIDTH, DEPTH>(signature, snk);
+		const dense::tensor_layout layout(WIDTH, DEPTH);
+		sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_signature);
+		S* out = (S*) PyArray_DATA(snk);
+		const S* in = (const S*) PyArray_DATA(stream);
+		const size_t rows = (size_t) PyArray_DIM(stream, 0);
+		if (threads != 1 && chunked_signature(layout, out, in, rows, threads, min_chunk_rows))
+			return true;
+		released_gil unlocked;
+		sigcore::arena_scope scope;
+		dense::signature(layout, out, in, rows, scope.allocate<S>(dense::scratch_size(layout)));
 		return true;
 	}
 
@@ -298,36 +247,124 @@ namespace {
 	}
 
   /**
-   * GetLogSigT - computes size of the vectorised log-signature
-   * @return size of the vectorised log-signature
+   * GetLogSigT - computes the log-signature of a stream into snk
+   * @param stream pointer to stream as PyArrayObject, assumed to have two dimensions, the row is assumed to be of length WIDTH
+   * @param snk pointer to C array, the result is written into this array
    */
 	template <size_t WIDTH, size_t DEPTH>
-	size_t GetLogSigT()
+	bool GetLogSigT(PyArrayObject *stream, PyArrayObject *snk)
 	{
-		typedef const double array[WIDTH];
-		typedef double S;
-		typedef double Q;
-		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
-		LIE::basis.growup(DEPTH);
-		return LIE::basis.size();
+		GetLogSignature<WIDTH, DEPTH>(stream, (S*) PyArray_DATA(snk));
+		return true;
 	}
 
   /**
-   * GetLogSigT - computes the log-signature of a stream into snk
-   * @param stream pointer to stream as PyArrayObject, assumed to have two dimensions, the row is assumed to be of length WIDTH
+   * SigToLogSigT - computes the log-signature corresponding to a signature into snk
+   * @param sig pointer to the signature as a C-contiguous array of doubles in the layout of GetSigT
    * @param snk pointer to C array, the result is written into this array
    */
 	template <size_t WIDTH, size_t DEPTH>
-	bool GetLogSigT(PyArrayObject *stream, PyArrayObject *snk)
+	bool SigToLogSigT(PyArrayObject *sig, PyArrayObject *snk)
 	{
-		typedef alg::lie<S, Q, WIDTH, DEPTH> LIE;
-		typedef alg::cbh<S, Q, WIDTH, DEPTH> CBH;
-		LIE logans = GetLogSignature<LIE, CBH, WIDTH>(stream);
-		unpack_lie_to_SNK<S, LIE, WIDTH, DEPTH>(logans, snk);
+		const dense::tensor_layout layout(WIDTH, DEPTH);
+		const sigcore::log_projection& projection = sigcore::get_log_projection(WIDTH, DEPTH);
+		sigcore::arena_scope scope;
+		S* logsig = scope.allocate<S>(layout.size());
+		{
+			sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_log);
+			dense::log(layout, logsig, (const S*) PyArray_DATA(sig));
+		}
+		sigcore::scoped_phase_timer timer(WIDTH, DEPTH, sigcore::phase_project);
+		projection.apply(logsig, (S*) PyArray_DATA(snk));
 		return true;
 	}
 
-  /*
+    /**
+   * apply_to_tensors - applies a dense tensor function to every tensor held along the last axis of src
+   * @param fn one of dense::exp, dense::log or dense::inverse
+   * @param src contiguous double array of one or two dimensions, the last having the size of the signature
+   * @param snk contiguous double array of the same shape as src, the result is written into this array
+   */
+	bool apply_to_tensors(void (*fn)(const dense::tensor_layout&, S*, const S*),
+		PyArrayObject *src, PyArrayObject *snk, size_t width, size_t depth)
+	{
+		if (width == 0 || depth == 0)
+			throw std::invalid_argument("Width and depth must be at least 1");
+		dense::tensor_layout layout(width, depth);
+		const npy_intp size = (npy_intp) layout.size();
+		if (PyArray_NDIM(src) < 1 || PyArray_DIM(src, PyArray_NDIM(src) - 1) != size)
+			throw std::invalid_argument("The last axis of the tensor array must have length sigdim(width, depth)");
+
+		const S* in = (const S*) PyArray_DATA(src);
+		S* out = (S*) PyArray_DATA(snk);
+		// PyArray_SIZE goes through the numpy API table, which is only imported in tosig_module.cpp
+		npy_intp count = 1;
+		for (int d = 0; d + 1 < PyArray_NDIM(src); ++d)
+			count *= PyArray_DIM(src, d);
+		for (npy_intp i = 0; i < count; ++i)
+			fn(layout, out + i * size, in + i * size);
+		return true;
+	}
+
+  /**
+   * moments - running mean and sum of squared deviations of a number of signatures
+   */
+	struct moments
+	{
+		double count;
+		std::vector<S> mean;
+		std::vector<S> m2;
+
+		moments(size_t size, bool with_m2) : count(0), mean(size, S(0)), m2(with_m2 ? size : 0, S(0))
+		{
+		}
+
+		// Welford's update with one more signature
+		void add(const S* sig)
+		{
+			count += 1;
+			for (size_t i = 0; i < mean.size(); ++i) {
+				const S delta = sig[i] - mean[i];
+				mean[i] += delta / count;
+				if (!m2.empty())
+					m2[i] += delta * (sig[i] - mean[i]);
+			}
+		}
+	};
+
+  /**
+   * merge_moments - Chan's pairwise update folding the moments in rhs into (count, mean, m2)
+   */
+	void merge_moments(double& count, S* mean, S* m2, const moments& rhs)
+	{
+		if (rhs.count == 0)
+			return;
+		const double total = count + rhs.count;
+		for (size_t i = 0; i < rhs.mean.size(); ++i) {
+			const S delta = rhs.mean[i] - mean[i];
+			mean[i] += delta * (rhs.count / total);
+			if (m2)
+				m2[i] += rhs.m2[i] + delta * delta * (count * rhs.count / total);
+		}
+		count = total;
+	}
+
+  /**
+   * accumulate_block - the moments of the signatures of streams [begin, end), one task of the pool
+   */
+	void accumulate_block(const dense::tensor_layout& layout, const double *const *streams,
+		const size_t *rows, size_t begin, size_t end, moments& ans)
+	{
+		sigcore::arena_scope scope;
+		S* sig = scope.allocate<S>(layout.size());
+		S* scratch = scope.allocate<S>(dense::scratch_size(layout));
+		for (size_t i = begin; i < end; ++i) {
+			dense::signature(layout, sig, streams[i], rows[i], scratch);
+			ans.add(sig);
+		}
+	}
+
+/*
 	template <size_t WIDTH, size_t DEPTH>
 	bool GetLogSigT(const double* src, double* snk, size_t recs)
 	{
@@ -348,30 +385,24 @@ namespace {
 // A C++ function returning a string of labels
 extern TOSIG_API std::string ShowLogSigLabels(size_t width, size_t depth)
 {
-	//execute the correct Templated Function and return the value
+	// the keys come from the libalgebra basis in the shared object of the range of width
 	try {
-#define TemplatedFn(depth,width) liebasis2stringT<depth,width>()
-#include "switch.h"
-#undef TemplatedFn
+		return sigcore::get_shape_kernels(width, depth).log_sig_keys();
     } catch (std::exception& exc) {
         PyErr_SetString(PyExc_RuntimeError, exc.what());
     }
-	// only get here if the template arguments are out of range
 	return std::string();
 }
 
 // A C++ function returning a string of labels
 extern TOSIG_API std::string ShowSigLabels(size_t width, size_t depth)
 {
-	//execute the correct Templated Function and return the value
+	// the keys come from the libalgebra basis in the shared object of the range of width
 	try {
-#define TemplatedFn(depth,width) tensorbasis2stringT<depth,width>()
-#include "switch.h"
-#undef TemplatedFn
+		return sigcore::get_shape_kernels(width, depth).sig_keys();
     } catch (std::exception& exc) {
         PyErr_SetString(PyExc_RuntimeError, exc.what());
     }
-	// only get here if the template arguments are out of range
 	return std::string();
 }
 
@@ -381,6 +412,9 @@ TOSIG_API int GetLogSig(PyArrayObject *stream, PyArrayObject *snk,
     size_t width, size_t depth)
  {
     try {
+        sigcore::memory_call_scope memory_scope(sigcore::memory_log_signature);
+        // the numpy array of the answer, made for the call
+        sigcore::external_bytes output(array_bytes(snk));
     //execute the correct Templated Function and return the value
 #define TemplatedFn(depth,width) GetLogSigT<depth,width>(stream, snk)
 #include "switch.h"
@@ -392,28 +426,46 @@ TOSIG_API int GetLogSig(PyArrayObject *stream, PyArrayObject *snk,
     return false;
  }
 
-// get required size for snk
-TOSIG_API size_t GetLogSigSize(size_t width, size_t depth)
+// a wrapper un-templated function that calls the correct template instance
+TOSIG_API int GetLogSigFromSig(PyArrayObject *sig, PyArrayObject *snk,
+    size_t width, size_t depth)
  {
     //execute the correct Templated Function and return the value
     try {
-#define TemplatedFn(depth,width) GetLogSigT<depth,width>()
+        sigcore::memory_call_scope memory_scope(sigcore::memory_log_signature);
+        // the numpy array of the answer, made for the call
+        sigcore::external_bytes output(array_bytes(snk));
+#define TemplatedFn(depth,width) SigToLogSigT<depth,width>(sig, snk)
 #include "switch.h"
 #undef TemplatedFn
     } catch (std::exception& exc) {
         PyErr_SetString(PyExc_RuntimeError, exc.what());
     }
     // only get here if the template arguments are out of range
+    return false;
+ }
+
+// get required size for snk
+TOSIG_API size_t GetLogSigSize(size_t width, size_t depth)
+ {
+    try {
+        return sigcore::get_shape_kernels(width, depth).log_sig_size();
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
     return 0;
  }
 
 // a wrapper un-templated function that calls the correct template instance
 TOSIG_API int GetSig(PyArrayObject *stream, PyArrayObject *snk,
-    size_t width, size_t depth)
+    size_t width, size_t depth, size_t threads, size_t min_chunk_rows)
  {
     //execute the correct Templated Function and return the value
     try {
-#define TemplatedFn(depth,width) GetSigT<depth,width>(stream, snk)
+        sigcore::memory_call_scope memory_scope(sigcore::memory_signature);
+        // the numpy array of the answer, made for the call
+        sigcore::external_bytes output(array_bytes(snk));
+#define TemplatedFn(depth,width) GetSigT<depth,width>(stream, snk, threads, min_chunk_rows)
 #include "switch.h"
 #undef TemplatedFn
     } catch (std::exception& exc) {
@@ -423,6 +475,72 @@ TOSIG_API int GetSig(PyArrayObject *stream, PyArrayObject *snk,
     return false;
  }
 
+// the chosen coordinates of a signature, computed with no template so any width and depth will do
+TOSIG_API int GetSigSubset(const double *stream, size_t no_rows, size_t width, size_t depth,
+    const size_t *indices, size_t no_indices, double *snk)
+ {
+    try {
+        sigcore::memory_call_scope memory_scope(sigcore::memory_signature);
+        sigcore::external_bytes output(no_indices * sizeof(double));
+        sigcore::word_tree tree(width);
+        std::vector<size_t> nodes(no_indices);
+        for (size_t i = 0; i < no_indices; ++i) {
+            const std::vector<size_t> word = sigcore::index_to_word(indices[i], width, depth);
+            nodes[i] = tree.insert(word.data(), word.size());
+        }
+        std::vector<double> values(tree.size());
+        // the tree and the vectors of its nodes and values
+        sigcore::external_bytes held(tree.heap_bytes() + nodes.capacity() * sizeof(size_t)
+            + values.capacity() * sizeof(double), sigcore::heap_memory);
+        sigcore::tree_signature(tree, stream, no_rows, values.data());
+        for (size_t i = 0; i < no_indices; ++i)
+            snk[i] = values[nodes[i]];
+        return true;
+    } catch (std::out_of_range& exc) {
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_IndexError, exc.what());
+        PyGILState_Release(state);
+    } catch (std::exception& exc) {
+        // called with the interpreter lock released
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+        PyGILState_Release(state);
+    }
+    return false;
+ }
+
+// the size of the signature truncated at a weighted length
+TOSIG_API size_t GetWeightedSigSize(const size_t *weights, size_t width, size_t budget)
+ {
+    try {
+        return sigcore::get_weighted_words(weights, width, budget)->tree.size();
+    } catch (std::invalid_argument& exc) {
+        PyErr_SetString(PyExc_ValueError, exc.what());
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    return 0;
+ }
+
+// the signature truncated at a weighted length, its nodes numbered in the order of the output
+TOSIG_API int GetWeightedSig(const double *stream, size_t no_rows, size_t width,
+    const size_t *weights, size_t budget, double *snk)
+ {
+    try {
+        sigcore::memory_call_scope memory_scope(sigcore::memory_signature);
+        std::shared_ptr<const sigcore::weighted_words> words = sigcore::get_weighted_words(weights, width, budget);
+        sigcore::external_bytes output(words->tree.size() * sizeof(double));
+        sigcore::weighted_signature(*words, stream, no_rows, snk);
+        return true;
+    } catch (std::exception& exc) {
+        // called with the interpreter lock released
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+        PyGILState_Release(state);
+    }
+    return false;
+ }
+
 // get required size for snk
 TOSIG_API const size_t GetSigSize(size_t width, size_t depth)
  {
@@ -438,3 +556,124 @@ TOSIG_API const size_t GetSigSize(size_t width, size_t depth)
     return 0;
  }
 
+
+
+// exponential of each tensor in src placed in snk
+TOSIG_API int TensorExp(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth)
+ {
+    try {
+        return apply_to_tensors(&dense::exp, src, snk, width, depth);
+    } catch (std::invalid_argument& exc) {
+        PyErr_SetString(PyExc_ValueError, exc.what());
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    return false;
+ }
+
+// logarithm of each tensor in src placed in snk
+TOSIG_API int TensorLog(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth)
+ {
+    try {
+        return apply_to_tensors(&dense::log, src, snk, width, depth);
+    } catch (std::invalid_argument& exc) {
+        PyErr_SetString(PyExc_ValueError, exc.what());
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    return false;
+ }
+
+// inverse of each tensor in src placed in snk
+TOSIG_API int TensorInverse(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth)
+ {
+    try {
+        return apply_to_tensors(&dense::inverse, src, snk, width, depth);
+    } catch (std::invalid_argument& exc) {
+        PyErr_SetString(PyExc_ValueError, exc.what());
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    return false;
+ }
+
+
+// fold the signatures of a batch of streams into running moments
+TOSIG_API int AccumulateSigMoments(const double *const *streams, const size_t *rows,
+    size_t no_streams, size_t width, size_t depth,
+    double *mean, double *m2, double *count, size_t threads)
+ {
+    try {
+        dense::tensor_layout layout(width, depth);
+        if (threads == 0)
+            threads = sigcore::get_num_threads();
+        threads = std::max<size_t>(std::min(threads, no_streams), 1);
+
+        // one accumulator per block of the streams, each block a task of the pool
+        std::vector<moments> partial(threads, moments(layout.size(), m2 != NULL));
+        sigcore::parallel_for(threads, [&](size_t t) {
+            accumulate_block(layout, streams, rows, no_streams * t / threads,
+                no_streams * (t + 1) / threads, partial[t]);
+        }, threads);
+
+        for (size_t t = 0; t < threads; ++t)
+            merge_moments(*count, mean, m2, partial[t]);
+        return true;
+    } catch (std::exception& exc) {
+        // called with the interpreter lock released
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+        PyGILState_Release(state);
+    }
+    return false;
+ }
+
+// multiply the signature in sig by that of the rows, continuing from previous
+TOSIG_API int ExtendSig(const double *rows, size_t no_rows, const double *previous,
+    size_t width, size_t depth, double *sig)
+ {
+    try {
+        dense::tensor_layout layout(width, depth);
+        sigcore::arena_scope scope;
+        dense::extend_signature(layout, sig, previous, rows, no_rows,
+            scope.allocate<S>(dense::scratch_size(layout)));
+        return true;
+    } catch (std::exception& exc) {
+        // called with the interpreter lock released
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+        PyGILState_Release(state);
+    }
+    return false;
+ }
+
+// tabulate the map from signatures to log signatures used by GetSigRagged
+TOSIG_API size_t PrepareLogSigProjection(size_t width, size_t depth)
+ {
+    try {
+        return sigcore::get_log_projection(width, depth).size;
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    return 0;
+ }
+
+// the signatures or log signatures of the segments of a ragged batch
+TOSIG_API int GetSigRagged(const double *data, const size_t *offsets, size_t no_streams,
+    size_t width, size_t depth, double *snk, int log_signature, size_t threads)
+ {
+    try {
+        sigcore::ragged_signatures(data, offsets, no_streams, width, depth, snk,
+            log_signature != 0, threads);
+        return true;
+    } catch (std::exception& exc) {
+        // called with the interpreter lock released
+        PyGILState_STATE state = PyGILState_Ensure();
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+        PyGILState_Release(state);
+    }
+    return false;
+ }
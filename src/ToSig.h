@@ -32,15 +32,80 @@
 
 // get required size for snk
 TOSIG_API const size_t GetSigSize(size_t width, size_t depth);
-// compute signature of path at src and place answer in snk
+// the default for the fewest increments of a stream given a thread of their own by GetSig
+#define TOSIG_MIN_CHUNK_ROWS 65536
+// compute signature of path at src and place answer in snk; unless threads
+// is 1, a stream of at least 2 min_chunk_rows increments is split into chunks
+// whose signatures are computed in parallel and multiplied together (0 uses
+// every thread of the pool, see ThreadPool.h)
 TOSIG_API int GetSig(PyArrayObject *stream, PyArrayObject *snk,
-    size_t width, size_t depth);
+    size_t width, size_t depth, size_t threads = 1,
+    size_t min_chunk_rows = TOSIG_MIN_CHUNK_ROWS);
 
-// get required size for snk
+// compute the coordinates indices[0 .. no_indices) of the signature, laid out as
+// by GetSig, of the no_rows rows of width doubles at stream and place them in snk;
+// only those coordinates and their prefixes are computed, so the cost grows with
+// the number and length of the words asked for and not with the signature; may be
+// called with the interpreter lock released
+TOSIG_API int GetSigSubset(const double *stream, size_t no_rows, size_t width, size_t depth,
+    const size_t *indices, size_t no_indices, double *snk);
+
+// get required size for snk in GetWeightedSig, 0 if a weight is 0
+TOSIG_API size_t GetWeightedSigSize(const size_t *weights, size_t width, size_t budget);
+// compute the signature of the no_rows rows of width doubles at stream truncated
+// at weighted length budget, letter i weighing weights[i], and place it in snk:
+// the coordinates of the full signature whose words weigh at most budget, in the
+// same order; may be called with the interpreter lock released
+TOSIG_API int GetWeightedSig(const double *stream, size_t no_rows, size_t width,
+    const size_t *weights, size_t budget, double *snk);
+
+// get required size for snk, loading the shape kernels of width on first use
 TOSIG_API size_t GetLogSigSize(size_t width, size_t depth);
 // compute signature of path at src and place answer in snk
 TOSIG_API int GetLogSig(PyArrayObject *stream, PyArrayObject *snk,
     size_t width, size_t depth);
 
+// compute the log signature corresponding to the signature at sig and place
+// answer in snk
+TOSIG_API int GetLogSigFromSig(PyArrayObject *sig, PyArrayObject *snk,
+    size_t width, size_t depth);
+
+// multiply the signature at sig by the signature of no_rows rows of width
+// doubles, including the increment from the row previous if it is not NULL,
+// so that a stream can be processed in pieces; may be called with the
+// interpreter lock released
+TOSIG_API int ExtendSig(const double *rows, size_t no_rows, const double *previous,
+    size_t width, size_t depth, double *sig);
+
+// tabulate, with the interpreter lock held, the map from signatures to log
+// signatures used by GetSigRagged; returns the size of the log signature or 0
+TOSIG_API size_t PrepareLogSigProjection(size_t width, size_t depth);
+
+// compute the signatures, or if log_signature is non-zero the log signatures,
+// of no_streams streams stored one after another in data, stream i being the
+// rows [offsets[i], offsets[i + 1]) of width doubles, and place them in the
+// rows of snk; the streams are scheduled on threads threads of the pool (0 uses
+// every thread) by work stealing, long streams being split into pieces; may be
+// called with the interpreter lock released
+TOSIG_API int GetSigRagged(const double *data, const size_t *offsets, size_t no_streams,
+    size_t width, size_t depth, double *snk, int log_signature, size_t threads);
+
+// apply exp, log or the inverse to each tensor (in the layout of the
+// signature) along the last axis of the contiguous double array src
+TOSIG_API int TensorExp(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth);
+TOSIG_API int TensorLog(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth);
+TOSIG_API int TensorInverse(PyArrayObject *src, PyArrayObject *snk,
+    size_t width, size_t depth);
+
+// fold the signatures of no_streams streams (stream i has rows[i] rows of
+// width doubles) into the running mean and, if m2 is not NULL, the running
+// sum of squared deviations of *count signatures; one accumulator is kept per
+// block of streams, the blocks run on threads threads of the pool (0 uses
+// every thread) and are merged at the end, *count is updated
+TOSIG_API int AccumulateSigMoments(const double *const *streams, const size_t *rows,
+    size_t no_streams, size_t width, size_t depth,
+    double *mean, double *m2, double *count, size_t threads);
 
 #endif // ToSig_h__
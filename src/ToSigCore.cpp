@@ -0,0 +1,330 @@
+// ToSigCore.cpp : the parts of tosig that do not need Python
+//
+#include "stdafx.h"
+
+#include <string.h>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include "Arena.h"
+#include "DenseTensor.h"
+#include "Memory.h"
+#include "Profile.h"
+#include "ShapeKernels.h"
+#include "ToSigCore.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	typedef double S;
+	using sigcore::log_projection;
+	using sigcore::shape_range;
+
+#ifndef _WIN32
+  /**
+   * executable_path - the file the process was started from, or empty where /proc/self/exe
+   * does not name it
+   */
+	std::string executable_path()
+	{
+		char path[PATH_MAX];
+		const ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+		return (length > 0) ? std::string(path, (size_t) length) : std::string();
+	}
+
+	bool same_file(const char* a, const std::string& b)
+	{
+		struct stat sa, sb;
+		return stat(a, &sa) == 0 && stat(b.c_str(), &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+	}
+#endif
+
+  /**
+   * module_path - the file this code was loaded from, the tosig module or tosig_batch; on
+   * Windows GetModuleFileName already gives the full path of either
+   */
+	std::string module_path()
+	{
+#ifdef _WIN32
+		HMODULE self = NULL;
+		char path[MAX_PATH];
+		if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+				reinterpret_cast<LPCSTR>(&module_path), &self)
+			&& GetModuleFileNameA(self, path, MAX_PATH) > 0)
+			return path;
+#else
+		Dl_info info;
+		if (dladdr(reinterpret_cast<void*>(&module_path), &info) == 0 || info.dli_fname == NULL)
+			return std::string();
+		// in an executable dladdr gives the name it was started by, with no directory when it
+		// was found on the PATH, so the executable is looked up in /proc/self/exe instead
+		const std::string executable = executable_path();
+		if (!executable.empty() && (strchr(info.dli_fname, '/') == NULL || same_file(info.dli_fname, executable)))
+			return executable;
+		return info.dli_fname;
+#endif
+		return std::string();
+	}
+
+  /**
+   * open_shapes - loads tosig_shapes_<min>_<max> from the directory of module_path(), with the
+   * extension suffix of the tosig module, as setup.py names it, or the plain one CMake uses
+   * @return its entry point; throws std::runtime_error if it cannot be loaded
+   */
+	shape_kernels_entry open_shapes(const shape_range& range)
+	{
+		const std::string path = module_path();
+		const size_t slash = path.find_last_of("/\\");
+		const std::string dir = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+		const std::string base = (slash == std::string::npos) ? path : path.substr(slash + 1);
+		std::vector<std::string> suffixes;
+		if (base.compare(0, 6, "tosig.") == 0)
+			suffixes.push_back(base.substr(5));
+#ifdef _WIN32
+		suffixes.push_back(".dll");
+#else
+		suffixes.push_back(".so");
+#endif
+		std::ostringstream name;
+		name << dir << "tosig_shapes_" << range.min_width << "_" << range.max_width;
+
+		std::string errors;
+		for (size_t i = 0; i < suffixes.size(); ++i) {
+			const std::string file = name.str() + suffixes[i];
+#ifdef _WIN32
+			HMODULE handle = LoadLibraryA(file.c_str());
+			if (handle != NULL) {
+				FARPROC entry = GetProcAddress(handle, ESIG_SHAPE_KERNELS_ENTRY);
+				if (entry != NULL)
+					return reinterpret_cast<shape_kernels_entry>(entry);
+			}
+			errors += "; cannot load " + file;
+#else
+			void* handle = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+			void* entry = (handle != NULL) ? dlsym(handle, ESIG_SHAPE_KERNELS_ENTRY) : NULL;
+			if (entry != NULL)
+				return reinterpret_cast<shape_kernels_entry>(entry);
+			const char* error = dlerror();
+			errors += "; " + ((error != NULL) ? std::string(error) : "cannot load " + file);
+#endif
+		}
+		std::ostringstream message;
+		message << "Cannot load the kernels of widths " << range.min_width << " to " << range.max_width << errors;
+		throw std::runtime_error(message.str());
+	}
+
+  /**
+   * ragged_piece - one task of ragged_signatures, the rows [begin, end) of segment stream;
+   * a long segment is split into pieces sharing their boundary rows, whose signatures are
+   * left in partial to be multiplied together afterwards, otherwise partial is NULL
+   */
+	struct ragged_piece
+	{
+		size_t stream;
+		size_t begin;
+		size_t end;
+		S* partial;
+	};
+
+  /**
+   * ragged_split - the pieces [first, first + count) of a segment split by ragged_signatures
+   */
+	struct ragged_split
+	{
+		size_t stream;
+		size_t first;
+		size_t count;
+	};
+
+  /**
+   * ragged_worker - the buffers of one worker of ragged_signatures
+   */
+	struct ragged_worker
+	{
+		S* sig;
+		S* logsig;
+		S* scratch;
+	};
+
+  /**
+   * store_segment - writes the signature sig, or its log-signature if projection is not NULL, to out
+   */
+	void store_segment(const dense::tensor_layout& layout, const log_projection* projection,
+		const S* sig, S* logsig, S* out)
+	{
+		if (projection == NULL) {
+			std::copy(sig, sig + layout.size(), out);
+		} else {
+			{
+				sigcore::scoped_phase_timer timer(layout.width, layout.depth, sigcore::phase_log);
+				dense::log(layout, logsig, sig);
+			}
+			sigcore::scoped_phase_timer timer(layout.width, layout.depth, sigcore::phase_project);
+			projection->apply(logsig, out);
+		}
+	}
+
+} // namespace
+
+namespace sigcore {
+
+	const shape_kernels& get_shape_kernels(size_t width, size_t depth)
+	{
+		// the shared objects stay loaded for the life of the process
+		static std::mutex lock;
+		static std::map<const shape_range*, shape_kernels_entry> entries;
+		const shape_range* range = find_shape_range(width);
+		if (range == NULL)
+			throw std::runtime_error("Legitimate width 2 <-> 256 exceeded");
+
+		shape_kernels_entry entry;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			std::map<const shape_range*, shape_kernels_entry>::iterator it = entries.find(range);
+			if (it == entries.end())
+				it = entries.insert(std::make_pair(range, open_shapes(*range))).first;
+			entry = it->second;
+		}
+		const shape_kernels* ans = entry(width, depth);
+		if (ans == NULL)
+			throw std::runtime_error("No kernels are available for this width and depth");
+		return *ans;
+	}
+
+  /**
+   * get_log_projection - the log_projection for width and depth, tabulated on first use
+   * the tables are built under a lock because libalgebra's bases are not thread safe
+   */
+	const log_projection& get_log_projection(size_t width, size_t depth)
+	{
+		static std::mutex lock;
+		static std::map<std::pair<size_t, size_t>, log_projection> cache;
+		std::lock_guard<std::mutex> guard(lock);
+		std::map<std::pair<size_t, size_t>, log_projection>::iterator it = cache.find(std::make_pair(width, depth));
+		if (it == cache.end()) {
+			log_projection ans;
+			get_shape_kernels(width, depth).log_projection(ans);
+			it = cache.insert(std::make_pair(std::make_pair(width, depth), ans)).first;
+			const log_projection& kept = it->second;
+			count_heap_allocation(kept.start.capacity() * sizeof(size_t) + kept.row.capacity() * sizeof(size_t)
+				+ kept.value.capacity() * sizeof(S));
+		}
+		return it->second;
+	}
+
+	void ragged_signatures(const double* data, const size_t* offsets, size_t no_streams,
+		size_t width, size_t depth, double* snk, bool log_signature, size_t threads)
+	{
+		memory_call_scope memory_scope(log_signature ? memory_log_signature : memory_signature);
+		scoped_trace_event trace("ragged_signatures", (long long) no_streams);
+		dense::tensor_layout layout(width, depth);
+		const log_projection* projection = log_signature ? &get_log_projection(width, depth) : NULL;
+		const size_t out_size = (projection != NULL) ? projection->size : layout.size();
+		// the answers, made by the caller for the call
+		external_bytes output(no_streams * out_size * sizeof(double));
+		if (threads == 0)
+			threads = get_num_threads();
+
+		// a segment much longer than a fair share of the work is split into pieces of
+		// about grain increments, so that no one segment holds the others up
+		size_t increments = 0;
+		for (size_t i = 0; i < no_streams; ++i)
+			increments += std::max<size_t>(offsets[i + 1] - offsets[i], 1) - 1;
+		const size_t grain = std::max(increments / (4 * threads), min_piece_increments);
+		// everything is laid out in the arena of the calling thread, so a call allocates
+		// nothing once the thread has seen a batch as large
+		arena_scope scope;
+		size_t no_pieces = 0;
+		for (size_t i = 0; i < no_streams; ++i) {
+			const size_t length = std::max<size_t>(offsets[i + 1] - offsets[i], 1) - 1;
+			no_pieces += (threads == 1 || length <= 2 * grain) ? 1 : (length + grain - 1) / grain;
+		}
+		std::vector<ragged_piece, arena_allocator<ragged_piece> > pieces;
+		std::vector<ragged_split, arena_allocator<ragged_split> > splits;
+		pieces.reserve(no_pieces);
+		splits.reserve(no_pieces - no_streams);
+		for (size_t i = 0; i < no_streams; ++i) {
+			const size_t length = std::max<size_t>(offsets[i + 1] - offsets[i], 1) - 1;
+			if (threads == 1 || length <= 2 * grain) {
+				ragged_piece piece = { i, offsets[i], offsets[i + 1], NULL };
+				pieces.push_back(piece);
+				continue;
+			}
+			const size_t count = (length + grain - 1) / grain;
+			ragged_split split = { i, pieces.size(), count };
+			splits.push_back(split);
+			for (size_t c = 0; c < count; ++c) {
+				ragged_piece piece = { i, offsets[i] + length * c / count,
+					offsets[i] + length * (c + 1) / count + 1, NULL };
+				pieces.push_back(piece);
+			}
+		}
+		size_t split_pieces = 0;
+		for (size_t s = 0; s < splits.size(); ++s)
+			split_pieces += splits[s].count;
+		S* partial = scope.allocate<S>(split_pieces * layout.size());
+		for (size_t s = 0, next = 0; s < splits.size(); ++s)
+			for (size_t c = 0; c < splits[s].count; ++c, ++next)
+				pieces[splits[s].first + c].partial = &partial[next * layout.size()];
+
+		// the pieces weigh their rows, plus one for the cost of starting a segment
+		size_t* cumulative = scope.allocate<size_t>(pieces.size() + 1);
+		cumulative[0] = 0;
+		for (size_t p = 0; p < pieces.size(); ++p)
+			cumulative[p + 1] = cumulative[p] + pieces[p].end - pieces[p].begin + 1;
+		const size_t no_workers = stealing_workers(pieces.size(), threads);
+		ragged_worker* workers = scope.allocate<ragged_worker>(no_workers);
+		for (size_t w = 0; w < no_workers; ++w) {
+			workers[w].sig = scope.allocate<S>(layout.size());
+			workers[w].logsig = scope.allocate<S>(layout.size());
+			workers[w].scratch = scope.allocate<S>(dense::scratch_size(layout));
+		}
+		parallel_for_stealing(pieces.size(), cumulative, [&](size_t p, size_t w) {
+			const ragged_piece& piece = pieces[p];
+			const ragged_worker& worker = workers[w];
+			// a stream split into pieces shows as pieces and then a merge
+			scoped_trace_event trace((piece.partial != NULL) ? "piece" : log_signature ? "log_signature" : "signature",
+				(long long) piece.stream);
+			S* sig = (piece.partial != NULL) ? piece.partial : worker.sig;
+			{
+				scoped_phase_timer timer(width, depth, phase_signature);
+				dense::signature(layout, sig, data + piece.begin * width, piece.end - piece.begin,
+					worker.scratch);
+			}
+			if (piece.partial == NULL)
+				store_segment(layout, projection, sig, worker.logsig, snk + piece.stream * out_size);
+		}, threads);
+
+		// the Chen product is associative, so the pieces of a segment multiply to its signature
+		parallel_for(splits.size(), [&](size_t s) {
+			const ragged_split& split = splits[s];
+			scoped_trace_event trace("merge", (long long) split.stream);
+			S* sig = pieces[split.first].partial;
+			{
+				scoped_phase_timer timer(width, depth, phase_signature);
+				for (size_t c = 1; c < split.count; ++c)
+					dense::mul_inplace(layout, sig, pieces[split.first + c].partial, layout.depth);
+			}
+			arena_scope task_scope;
+			store_segment(layout, projection, sig, task_scope.allocate<S>(layout.size()),
+				snk + split.stream * out_size);
+		}, threads);
+	}
+
+} // namespace sigcore
@@ -0,0 +1,59 @@
+#ifndef ToSigCore_h__
+#define ToSigCore_h__
+// ToSigCore.h : the parts of tosig that do not need Python, shared by the
+// extension module and the tosig_batch command line tool; errors are
+// reported by throwing std::exception
+//
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+
+namespace sigcore {
+
+	typedef double S;
+
+  /**
+   * log_projection - the linear map t2l taking the logarithm of a signature, held as a dense
+   * tensor, to the coordinates of the log-signature; stored column by column, the entries of
+   * tensor coordinate i being [start[i], start[i + 1]) so the map can be applied without libalgebra
+   */
+	struct log_projection
+	{
+		size_t size;
+		std::vector<size_t> start;
+		std::vector<size_t> row;
+		std::vector<S> value;
+
+		log_projection() : size(0)
+		{
+		}
+
+		void apply(const S* tensor, S* out) const
+		{
+			std::fill(out, out + size, S(0));
+			for (size_t i = 0; i + 1 < start.size(); ++i)
+				if (tensor[i] != S(0))
+					for (size_t e = start[i]; e < start[i + 1]; ++e)
+						out[row[e]] += value[e] * tensor[i];
+		}
+	};
+
+	// the log_projection for width and depth, tabulated by the shape kernels on first use;
+	// safe to call from several threads
+	const log_projection& get_log_projection(size_t width, size_t depth);
+
+	// the fewest increments in a piece of a long stream split up by ragged_signatures
+	const size_t min_piece_increments = 1024;
+
+	// the signatures, or the log signatures if log_signature is true, of no_streams
+	// streams stored one after another in data, stream i being the rows
+	// [offsets[i], offsets[i + 1]) of width doubles, placed in the rows of snk;
+	// the streams are scheduled on threads threads of the pool (0 uses every thread)
+	// by work stealing, a stream much longer than the others being split into pieces
+	// whose signatures are multiplied together afterwards
+	void ragged_signatures(const double* data, const size_t* offsets, size_t no_streams,
+		size_t width, size_t depth, double* snk, bool log_signature, size_t threads);
+
+} // namespace sigcore
+
+#endif // ToSigCore_h__
@@ -0,0 +1,284 @@
+// Trace.cpp : the buffers behind Trace.h
+//
+// Each thread owns a list of chunks of events that only it appends to, publishing
+// each event by a release store of the count of its chunk, so get_trace_json can read
+// them while it goes on. The lock is only taken by a thread recording its first
+// event, by one giving up its chunks after a reset_trace, by one exiting, which retires
+// its buffer, and by get_trace_json and reset_trace, which is what keeps a chunk alive
+// while it is being read. The events of a retired buffer stay in the trace until the
+// next reset_trace, which frees the buffer
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+#include "Trace.h"
+
+namespace {
+
+	typedef std::chrono::steady_clock clock;
+
+	// a thread records at most this many events between resets, and drops the rest
+	const size_t max_thread_events = size_t(1) << 20;
+
+	const size_t chunk_events = 4096;
+
+	struct trace_event
+	{
+		const char* name;
+		long long index;
+		clock::time_point begin;
+		clock::time_point end;
+	};
+
+	struct trace_chunk
+	{
+		trace_event events[chunk_events];
+		std::atomic<size_t> used;
+		std::atomic<trace_chunk*> next;
+
+		trace_chunk() : used(0), next(NULL)
+		{
+		}
+	};
+
+	struct trace_buffer
+	{
+		size_t thread;
+		std::atomic<unsigned> generation;
+		std::atomic<trace_chunk*> head;
+		std::atomic<size_t> dropped;
+		// set under the lock when the owning thread exits
+		bool retired;
+		// touched by the owning thread alone
+		trace_chunk* tail;
+		size_t events;
+
+		trace_buffer(size_t thread_, unsigned generation_)
+			: thread(thread_), generation(generation_), head(NULL), dropped(0), retired(false), tail(NULL), events(0)
+		{
+		}
+	};
+
+	struct trace_registry
+	{
+		std::mutex lock;
+		std::vector<trace_buffer*> buffers;
+		// the chunks given up by threads since the last reset_trace
+		std::vector<trace_chunk*> garbage;
+		std::atomic<unsigned> generation;
+		// the number of the next thread to record, so none is reused after a buffer is freed
+		size_t next_thread;
+
+		trace_registry() : generation(0), next_thread(0)
+		{
+		}
+	};
+
+	// the times of the trace count from the loading of the library
+	const clock::time_point origin = clock::now();
+
+	// never destroyed, as pool threads may still record while the process exits
+	trace_registry& registry()
+	{
+		static trace_registry* ans = new trace_registry;
+		return *ans;
+	}
+
+	void free_chunks(trace_chunk* chunk)
+	{
+		while (chunk != NULL) {
+			trace_chunk* next = chunk->next.load();
+			delete chunk;
+			chunk = next;
+		}
+	}
+
+	// set once the calling thread's thread_trace is destroyed, after which it records nothing
+	thread_local bool thread_exited = false;
+
+  /**
+   * thread_trace - the buffer of a thread, retired when the thread exits
+   */
+	struct thread_trace
+	{
+		trace_buffer* buffer;
+
+		thread_trace() : buffer(NULL)
+		{
+		}
+
+		~thread_trace()
+		{
+			thread_exited = true;
+			if (buffer == NULL)
+				return;
+			trace_registry& reg = registry();
+			std::lock_guard<std::mutex> guard(reg.lock);
+			buffer->retired = true;
+		}
+	};
+
+	// the buffer of the calling thread, NULL once it is exiting
+	trace_buffer* thread_buffer()
+	{
+		if (thread_exited)
+			return NULL;
+		static thread_local thread_trace mine;
+		if (mine.buffer == NULL) {
+			trace_registry& reg = registry();
+			std::lock_guard<std::mutex> guard(reg.lock);
+			mine.buffer = new trace_buffer(reg.next_thread++, reg.generation.load());
+			reg.buffers.push_back(mine.buffer);
+		}
+		return mine.buffer;
+	}
+
+	bool trace_from_environment()
+	{
+		const char* value = getenv("ESIG_TRACE");
+		return value != NULL && *value != '\0' && strcmp(value, "0") != 0;
+	}
+
+	void append_json_string(std::string& out, const char* text)
+	{
+		out += '"';
+		for (; *text != '\0'; ++text)
+			if (*text == '"' || *text == '\\') {
+				out += '\\';
+				out += *text;
+			} else if ((unsigned char) *text >= 0x20) {
+				out += *text;
+			}
+		out += '"';
+	}
+
+	double microseconds(clock::duration d)
+	{
+		return std::chrono::duration<double, std::micro>(d).count();
+	}
+
+} // namespace
+
+namespace sigcore {
+
+	std::atomic<bool> tracing_enabled(trace_from_environment());
+
+	bool set_tracing(bool on)
+	{
+		return tracing_enabled.exchange(on);
+	}
+
+	void add_trace_event(const char* name, long long index, clock::time_point begin, clock::time_point end)
+	{
+		trace_buffer* mine = thread_buffer();
+		if (mine == NULL)
+			return;
+		trace_buffer& buffer = *mine;
+		trace_registry& reg = registry();
+		if (buffer.generation.load(std::memory_order_relaxed) != reg.generation.load(std::memory_order_acquire)) {
+			// the trace was reset since this thread last recorded: give up the old chunks
+			std::lock_guard<std::mutex> guard(reg.lock);
+			for (trace_chunk* c = buffer.head.load(); c != NULL; c = c->next.load())
+				reg.garbage.push_back(c);
+			buffer.head.store(NULL);
+			buffer.tail = NULL;
+			buffer.events = 0;
+			buffer.dropped.store(0);
+			buffer.generation.store(reg.generation.load());
+		}
+		if (buffer.events >= max_thread_events) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (buffer.tail == NULL || buffer.tail->used.load(std::memory_order_relaxed) == chunk_events) {
+			trace_chunk* chunk = new trace_chunk;
+			if (buffer.tail == NULL)
+				buffer.head.store(chunk, std::memory_order_release);
+			else
+				buffer.tail->next.store(chunk, std::memory_order_release);
+			buffer.tail = chunk;
+		}
+		const size_t used = buffer.tail->used.load(std::memory_order_relaxed);
+		trace_event& event = buffer.tail->events[used];
+		event.name = name;
+		event.index = index;
+		event.begin = begin;
+		event.end = end;
+		buffer.tail->used.store(used + 1, std::memory_order_release);
+		++buffer.events;
+	}
+
+	std::string get_trace_json()
+	{
+		trace_registry& reg = registry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+		const unsigned generation = reg.generation.load();
+		std::string out("{\"traceEvents\": [");
+		size_t dropped = 0;
+		char text[256];
+		bool first = true;
+		for (size_t b = 0; b < reg.buffers.size(); ++b) {
+			trace_buffer& buffer = *reg.buffers[b];
+			// a buffer still holding the events of before a reset is left out
+			if (buffer.generation.load() != generation)
+				continue;
+			trace_chunk* chunk = buffer.head.load(std::memory_order_acquire);
+			if (chunk == NULL)
+				continue;
+			dropped += buffer.dropped.load(std::memory_order_relaxed);
+			snprintf(text, sizeof(text), "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, "
+				"\"args\": {\"name\": \"esig thread %zu\"}}", first ? "" : ",", buffer.thread, buffer.thread);
+			out += text;
+			first = false;
+			for (; chunk != NULL; chunk = chunk->next.load(std::memory_order_acquire)) {
+				const size_t used = chunk->used.load(std::memory_order_acquire);
+				for (size_t e = 0; e < used; ++e) {
+					const trace_event& event = chunk->events[e];
+					out += ",\n{\"name\": ";
+					append_json_string(out, event.name);
+					snprintf(text, sizeof(text), ", \"cat\": \"esig\", \"ph\": \"X\", \"pid\": 1, \"tid\": %zu, "
+						"\"ts\": %.3f, \"dur\": %.3f", buffer.thread, microseconds(event.begin - origin),
+						microseconds(event.end - event.begin));
+					out += text;
+					if (event.index >= 0) {
+						snprintf(text, sizeof(text), ", \"args\": {\"index\": %lld}", event.index);
+						out += text;
+					}
+					out += "}";
+				}
+			}
+		}
+		snprintf(text, sizeof(text), "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": %zu, "
+			"\"thread_buffers\": %zu}}\n", dropped, reg.buffers.size());
+		out += text;
+		return out;
+	}
+
+	void reset_trace()
+	{
+		trace_registry& reg = registry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+		// no thread reads the chunks given up before, as reading takes the lock
+		for (size_t c = 0; c < reg.garbage.size(); ++c)
+			delete reg.garbage[c];
+		reg.garbage.clear();
+		// nor records into the buffers of threads that have exited
+		size_t kept = 0;
+		for (size_t b = 0; b < reg.buffers.size(); ++b) {
+			trace_buffer* buffer = reg.buffers[b];
+			if (buffer->retired) {
+				free_chunks(buffer->head.load());
+				delete buffer;
+			} else {
+				reg.buffers[kept++] = buffer;
+			}
+		}
+		reg.buffers.resize(kept);
+		reg.generation.fetch_add(1, std::memory_order_release);
+	}
+
+} // namespace sigcore
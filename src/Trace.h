@@ -0,0 +1,62 @@
+#ifndef Trace_h__
+#define Trace_h__
+// Trace.h : an optional timeline of the tasks of the batch and recombine computations,
+// which thread ran each and when, dumped as Chrome trace JSON (chrome://tracing or
+// Perfetto); off unless set_tracing(true) is called or ESIG_TRACE is set in the
+// environment, in which case a trace point costs one relaxed atomic load. Each thread
+// appends its events to a buffer of its own without taking a lock
+//
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace sigcore {
+
+	// whether events are being recorded
+	extern std::atomic<bool> tracing_enabled;
+
+	// starts or stops recording, returning whether it was on
+	bool set_tracing(bool on);
+
+	// appends a task named name that ran from begin to end to the buffer of the calling
+	// thread; name must be a string literal, index identifies the task, such as the
+	// stream it computed, or is negative if nothing does
+	void add_trace_event(const char* name, long long index,
+		std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+	// the events recorded since the last reset_trace, as Chrome trace JSON
+	std::string get_trace_json();
+
+	// forgets the events recorded so far, freeing the buffers of the threads that have
+	// exited; each other thread frees its chunks the next time it records an event
+	void reset_trace();
+
+  /**
+   * scoped_trace_event - records the time from its construction to its destruction as
+   * a task of the calling thread
+   */
+	class scoped_trace_event
+	{
+		std::chrono::steady_clock::time_point begin;
+		const char* name;
+		long long index;
+		bool on;
+	public:
+		scoped_trace_event(const char* name_, long long index_ = -1)
+			: name(name_), index(index_), on(tracing_enabled.load(std::memory_order_relaxed))
+		{
+			if (on)
+				begin = std::chrono::steady_clock::now();
+		}
+
+		~scoped_trace_event()
+		{
+			if (on)
+				add_trace_event(name, index, begin, std::chrono::steady_clock::now());
+		}
+	};
+
+} // namespace sigcore
+
+#endif // Trace_h__
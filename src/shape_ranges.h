@@ -0,0 +1,9 @@
+// generated by tools/switch_generator.py: the ranges of widths compiled
+// into shared objects of their own, as { min_width, max_width, max_depth },
+{ 2, 2, 16 },
+{ 3, 3, 10 },
+{ 4, 4, 8 },
+{ 5, 6, 6 },
+{ 7, 9, 5 },
+{ 10, 16, 4 },
+{ 17, 40, 3 },
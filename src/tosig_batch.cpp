@@ -0,0 +1,427 @@
+// tosig_batch.cpp : command line tool computing the signatures or log signatures
+// of streams held in .npy files without going through Python
+//
+// usage: tosig_batch [-l] [-t threads] [-b batch] [-r rows] [-T trace.json] depth output.npy input...
+//
+// Each input is a .npy file of float64 or float32 values in C order holding a
+// single stream (rows x width) or a batch of streams of equal length (streams x
+// rows x width), or a directory whose .npy files are read in name order. The
+// answers are written, one row per stream in input order, to output.npy as a
+// float64 array (streams x sigdim) or (streams x logsigdim); its header is
+// written first and the rows are appended batch by batch as they are computed,
+// while the next batch is being computed, so the memory used does not depend on
+// the number of streams. Streams are read in blocks of rows, so nor does it
+// depend on their length. With -T, the stream each thread computed and when, and
+// the writes, are saved as Chrome trace JSON to trace.json.
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include "DenseTensor.h"
+#include "ToSigCore.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define ESIG_FSEEK _fseeki64
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#define ESIG_FSEEK fseeko
+#endif
+
+namespace {
+
+	typedef double S;
+
+	const char usage[] =
+		"usage: tosig_batch [-l] [-t threads] [-b batch] [-r rows] [-T trace.json] depth output.npy input...\n"
+		"  -l          compute log signatures instead of signatures\n"
+		"  -t threads  number of threads, 0 (the default) uses the cores available\n"
+		"  -b batch    number of streams computed between writes (default 1024)\n"
+		"  -r rows     number of rows of a stream read at a time (default 65536)\n"
+		"  -T file     write a timeline of the tasks of each thread as Chrome trace JSON\n"
+		"  each input is a .npy file holding a stream (rows x width) or a batch of\n"
+		"  streams (streams x rows x width), or a directory of such files\n";
+
+  /**
+   * npy_file - the header of a .npy file holding a C ordered array of float64 or float32
+   */
+	struct npy_file
+	{
+		std::string path;
+		long long data_offset;
+		size_t item_size;
+		std::vector<size_t> shape;
+	};
+
+  /**
+   * stream_ref - where the rows of one stream are found
+   */
+	struct stream_ref
+	{
+		size_t file;
+		long long offset;
+		size_t rows;
+	};
+
+	// the value following key in the header dictionary of a .npy file
+	std::string header_value(const std::string& header, const std::string& key, const std::string& path)
+	{
+		const size_t at = header.find("'" + key + "'");
+		const size_t colon = (at == std::string::npos) ? at : header.find(':', at);
+		if (colon == std::string::npos)
+			throw std::runtime_error(path + ": the .npy header has no " + key);
+		const size_t begin = header.find_first_not_of(' ', colon + 1);
+		const size_t end = (header[begin] == '(') ? header.find(')', begin) + 1
+			: header.find_first_of(",}", begin);
+		return header.substr(begin, end - begin);
+	}
+
+  /**
+   * read_npy_header - parses the header of a .npy file
+   */
+	npy_file read_npy_header(const std::string& path)
+	{
+		FILE* in = fopen(path.c_str(), "rb");
+		if (in == NULL)
+			throw std::runtime_error(path + ": cannot open");
+		unsigned char preamble[12];
+		size_t got = fread(preamble, 1, 10, in);
+		if (got != 10 || memcmp(preamble, "\x93NUMPY", 6) != 0) {
+			fclose(in);
+			throw std::runtime_error(path + ": not a .npy file");
+		}
+		size_t header_length = preamble[8] | (size_t(preamble[9]) << 8);
+		long long data_offset = 10;
+		if (preamble[6] >= 2) {
+			got = fread(preamble + 10, 1, 2, in);
+			header_length |= (size_t(preamble[10]) << 16) | (size_t(preamble[11]) << 24);
+			data_offset = 12;
+		}
+		std::string header(header_length, ' ');
+		got = fread(&header[0], 1, header_length, in);
+		fclose(in);
+		if (got != header_length)
+			throw std::runtime_error(path + ": truncated .npy header");
+
+		npy_file ans;
+		ans.path = path;
+		ans.data_offset = data_offset + (long long) header_length;
+		const std::string descr = header_value(header, "descr", path);
+		if (descr == "'<f8'")
+			ans.item_size = 8;
+		else if (descr == "'<f4'")
+			ans.item_size = 4;
+		else
+			throw std::runtime_error(path + ": the values must be little endian float64 or float32, not " + descr);
+		if (header_value(header, "fortran_order", path) != "False")
+			throw std::runtime_error(path + ": the array must be in C order");
+		std::string shape = header_value(header, "shape", path);
+		std::replace(shape.begin(), shape.end(), ',', ' ');
+		std::istringstream dims(shape.substr(1, shape.size() - 2));
+		size_t dim;
+		while (dims >> dim)
+			ans.shape.push_back(dim);
+		if (ans.shape.size() != 2 && ans.shape.size() != 3)
+			throw std::runtime_error(path + ": the array must have 2 or 3 dimensions");
+		return ans;
+	}
+
+	bool is_directory(const std::string& path)
+	{
+#ifdef _WIN32
+		const DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+	}
+
+	// the .npy files in a directory, in name order
+	std::vector<std::string> list_npy_files(const std::string& directory)
+	{
+		std::vector<std::string> names;
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		HANDLE search = FindFirstFileA((directory + "\\*.npy").c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE) {
+			do
+				names.push_back(found.cFileName);
+			while (FindNextFileA(search, &found));
+			FindClose(search);
+		}
+		const char separator = '\\';
+#else
+		DIR* dir = opendir(directory.c_str());
+		if (dir == NULL)
+			throw std::runtime_error(directory + ": cannot open the directory");
+		while (struct dirent* entry = readdir(dir)) {
+			const std::string name(entry->d_name);
+			if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+				names.push_back(name);
+		}
+		closedir(dir);
+		const char separator = '/';
+#endif
+		std::sort(names.begin(), names.end());
+		for (size_t i = 0; i < names.size(); ++i)
+			names[i] = directory + separator + names[i];
+		return names;
+	}
+
+	void write_npy_header(FILE* out, size_t rows, size_t cols)
+	{
+		std::ostringstream dict;
+		dict << "{'descr': '<f8', 'fortran_order': False, 'shape': (" << rows << ", " << cols << "), }";
+		std::string header = dict.str();
+		// the data starts on a 64 byte boundary, the header ends with a newline
+		header.append(63 - (10 + header.size()) % 64, ' ');
+		header += '\n';
+		const unsigned char preamble[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+			(unsigned char) (header.size() & 0xff), (unsigned char) (header.size() >> 8) };
+		if (fwrite(preamble, 1, 10, out) != 10 || fwrite(header.data(), 1, header.size(), out) != header.size())
+			throw std::runtime_error("cannot write the output header");
+	}
+
+  /**
+   * stream_worker - computes one stream at a time into a row of the answer
+   * reading the stream a block of rows at a time
+   */
+	struct stream_worker
+	{
+		const dense::tensor_layout& layout;
+		const sigcore::log_projection* projection;
+		bool log_signature;
+		size_t block_rows;
+		std::vector<S> sig, logsig, scratch, block, previous;
+		std::vector<float> narrow;
+
+		stream_worker(const dense::tensor_layout& layout_, const sigcore::log_projection* projection_,
+			bool log_signature_, size_t block_rows_)
+			: layout(layout_), projection(projection_), log_signature(log_signature_), block_rows(block_rows_),
+			sig(layout_.size()), logsig(layout_.size()), scratch(dense::scratch_size(layout_)),
+			previous(layout_.width)
+		{
+		}
+
+		void compute(const npy_file& file, const stream_ref& ref, S* out)
+		{
+			const size_t width = layout.width;
+			FILE* in = fopen(file.path.c_str(), "rb");
+			if (in == NULL || ESIG_FSEEK(in, ref.offset, SEEK_SET) != 0) {
+				if (in != NULL)
+					fclose(in);
+				throw std::runtime_error(file.path + ": cannot read");
+			}
+			std::fill(sig.begin(), sig.end(), S(0));
+			sig[0] = S(1);
+			for (size_t done = 0; done < ref.rows;) {
+				const size_t rows = std::min(block_rows, ref.rows - done);
+				block.resize(rows * width);
+				size_t got;
+				if (file.item_size == 8) {
+					got = fread(&block[0], sizeof(S), rows * width, in);
+				} else {
+					narrow.resize(rows * width);
+					got = fread(&narrow[0], sizeof(float), rows * width, in);
+					std::copy(narrow.begin(), narrow.end(), block.begin());
+				}
+				if (got != rows * width) {
+					fclose(in);
+					throw std::runtime_error(file.path + ": truncated data");
+				}
+				dense::extend_signature(layout, &sig[0], (done > 0) ? &previous[0] : NULL, &block[0], rows, &scratch[0]);
+				std::copy(block.end() - width, block.end(), previous.begin());
+				done += rows;
+			}
+			fclose(in);
+
+			if (!log_signature) {
+				std::copy(sig.begin(), sig.end(), out);
+			} else if (projection == NULL) {
+				// at depth 1 the log signature is the increment
+				std::copy(sig.begin() + 1, sig.end(), out);
+			} else {
+				dense::log(layout, &logsig[0], &sig[0]);
+				projection->apply(&logsig[0], out);
+			}
+		}
+	};
+
+  /**
+   * compute_batch - the streams [begin, end) computed by tasks of the pool taking the next stream in turn
+   */
+	void compute_batch(const dense::tensor_layout& layout, const sigcore::log_projection* projection,
+		bool log_signature, size_t block_rows, const std::vector<npy_file>& files,
+		const std::vector<stream_ref>& streams, size_t begin, size_t end, size_t out_size,
+		S* out, size_t threads)
+	{
+		std::atomic<size_t> next(begin);
+		sigcore::parallel_for(threads, [&](size_t) {
+			stream_worker worker(layout, projection, log_signature, block_rows);
+			for (size_t i = next++; i < end; i = next++) {
+				sigcore::scoped_trace_event trace(log_signature ? "log_signature" : "signature", (long long) i);
+				worker.compute(files[streams[i].file], streams[i], out + (i - begin) * out_size);
+			}
+		}, threads);
+	}
+
+	size_t parse_size(const char* text, const char* what)
+	{
+		char* end = NULL;
+		const long long value = strtoll(text, &end, 10);
+		if (end == text || *end != '\0' || value < 0)
+			throw std::invalid_argument(std::string("invalid ") + what + ": " + text);
+		return (size_t) value;
+	}
+
+	int run(int argc, char** argv)
+	{
+		bool log_signature = false;
+		size_t threads = 0, batch = 1024, block_rows = 65536;
+		std::string trace;
+		int arg = 1;
+		for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; ++arg) {
+			const std::string option(argv[arg]);
+			if (option == "-l")
+				log_signature = true;
+			else if (option == "-t" && arg + 1 < argc)
+				threads = parse_size(argv[++arg], "thread count");
+			else if (option == "-b" && arg + 1 < argc)
+				batch = std::max<size_t>(parse_size(argv[++arg], "batch size"), 1);
+			else if (option == "-r" && arg + 1 < argc)
+				block_rows = std::max<size_t>(parse_size(argv[++arg], "block size"), 1);
+			else if (option == "-T" && arg + 1 < argc)
+				trace = argv[++arg];
+			else
+				throw std::invalid_argument("unknown option " + option);
+		}
+		if (argc - arg < 3)
+			throw std::invalid_argument("missing arguments");
+		const size_t depth = parse_size(argv[arg++], "depth");
+		if (depth == 0)
+			throw std::invalid_argument("the depth must be at least 1");
+		const std::string output(argv[arg++]);
+
+		// gather the streams from the headers alone
+		std::vector<npy_file> files;
+		std::vector<stream_ref> streams;
+		size_t width = 0;
+		for (; arg < argc; ++arg) {
+			std::vector<std::string> paths(1, argv[arg]);
+			if (is_directory(paths[0]))
+				paths = list_npy_files(paths[0]);
+			for (size_t p = 0; p < paths.size(); ++p) {
+				const npy_file file = read_npy_header(paths[p]);
+				const size_t file_width = file.shape.back();
+				if (files.empty())
+					width = file_width;
+				else if (file_width != width)
+					throw std::runtime_error(file.path + ": the streams must all have the same width");
+				const size_t count = (file.shape.size() == 3) ? file.shape[0] : 1;
+				const size_t rows = file.shape[file.shape.size() - 2];
+				for (size_t i = 0; i < count; ++i) {
+					stream_ref ref = { files.size(), file.data_offset + (long long) (i * rows * width * file.item_size), rows };
+					streams.push_back(ref);
+				}
+				files.push_back(file);
+			}
+		}
+		if (width == 0)
+			throw std::runtime_error("the streams must have at least one column");
+
+		const char* kernels = getenv("ESIG_KERNELS");
+		if (kernels != NULL && !dense::select_kernels(kernels))
+			std::cerr << "tosig_batch: kernels " << kernels << " are not supported, using "
+				<< dense::kernels().name << "\n";
+		if (threads == 0)
+			threads = sigcore::get_num_threads();
+		else
+			sigcore::set_num_threads(threads);
+		if (!trace.empty())
+			sigcore::set_tracing(true);
+
+		const dense::tensor_layout layout(width, depth);
+		const sigcore::log_projection* projection = (log_signature && depth > 1)
+			? &sigcore::get_log_projection(width, depth) : NULL;
+		const size_t out_size = !log_signature ? layout.size() : (projection != NULL) ? projection->size : width;
+
+		FILE* out = fopen(output.c_str(), "wb");
+		if (out == NULL)
+			throw std::runtime_error(output + ": cannot open for writing");
+		// each batch is written on its own thread while the next one is computed
+		std::vector<S> answers[2] = { std::vector<S>(batch * out_size), std::vector<S>(batch * out_size) };
+		std::exception_ptr write_error;
+		std::thread writer;
+		try {
+			write_npy_header(out, streams.size(), out_size);
+			for (size_t begin = 0, b = 0; begin < streams.size(); begin += batch, b ^= 1) {
+				const size_t end = std::min(begin + batch, streams.size());
+				compute_batch(layout, projection, log_signature, block_rows, files, streams, begin, end,
+					out_size, &answers[b][0], threads);
+				if (writer.joinable())
+					writer.join();
+				if (write_error)
+					std::rethrow_exception(write_error);
+				const S* rows = &answers[b][0];
+				const size_t count = (end - begin) * out_size;
+				writer = std::thread([out, rows, count, begin, &write_error, &output]() {
+					sigcore::scoped_trace_event trace("write", (long long) begin);
+					if (fwrite(rows, sizeof(S), count, out) != count)
+						write_error = std::make_exception_ptr(std::runtime_error(output + ": write failed"));
+				});
+			}
+			if (writer.joinable())
+				writer.join();
+			if (write_error)
+				std::rethrow_exception(write_error);
+		} catch (...) {
+			if (writer.joinable())
+				writer.join();
+			fclose(out);
+			throw;
+		}
+		if (fclose(out) != 0)
+			throw std::runtime_error(output + ": write failed");
+		std::cerr << "tosig_batch: " << streams.size() << (log_signature ? " log signatures" : " signatures")
+			<< " of width " << width << " and depth " << depth << " written to " << output << "\n";
+		if (!trace.empty()) {
+			const std::string json = sigcore::get_trace_json();
+			FILE* file = fopen(trace.c_str(), "wb");
+			if (file == NULL)
+				throw std::runtime_error(trace + ": cannot open for writing");
+			const bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+			if (fclose(file) != 0 || !written)
+				throw std::runtime_error(trace + ": write failed");
+		}
+		return 0;
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	try {
+		return run(argc, argv);
+	} catch (std::invalid_argument& exc) {
+		std::cerr << "tosig_batch: " << exc.what() << "\n" << usage;
+		return 2;
+	} catch (std::exception& exc) {
+		std::cerr << "tosig_batch: " << exc.what() << "\n";
+		return 1;
+	}
+}
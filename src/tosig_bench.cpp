@@ -0,0 +1,292 @@
+// tosig_bench.cpp : command line microbenchmark of the signature and log signature
+// kernels behind GetSigT and GetLogSigT, without going through Python
+//
+// usage: tosig_bench [-k kinds] [-w widths] [-d depths] [-n rows] [-s seconds] [-c cells] [-o output.json]
+//
+// By default the grid has the two end widths of each range of tools/switch_generator.py
+// (shape_ranges.h), at depth 2, at the greatest depth of the range and half way between,
+// for streams of 100 and 1000 rows. A case is timed one call at a time, on one thread,
+// until it has run for the given number of seconds and at least min_repeats times; its
+// latency percentiles, rows and signatures per second and the heap memory its first call
+// took, on a fresh thread, tables and arena included, are written as JSON to output.json,
+// or to stdout, with the peak resident memory of the process over the whole run, so that
+// two runs can be compared. Progress is reported on stderr.
+//
+#include "stdafx.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include "Arena.h"
+#include "BenchSupport.h"
+#include "DenseKernels.h"
+#include "DenseTensor.h"
+#include "Memory.h"
+#include "ShapeKernels.h"
+#include "ToSigCore.h"
+
+namespace {
+
+	typedef double S;
+
+	const char usage[] =
+		"usage: tosig_bench [-k kinds] [-w widths] [-d depths] [-n rows] [-s seconds] [-c cells] [-o output.json]\n"
+		"  -k kinds    sig, logsig or sig,logsig (the default)\n"
+		"  -w widths   comma separated widths (default the ends of each range of widths)\n"
+		"  -d depths   comma separated depths (default 2, the greatest depth of the range and between)\n"
+		"  -n rows     comma separated stream lengths (default 100,1000)\n"
+		"  -s seconds  the least time spent on each case (default 0.5)\n"
+		"  -c cells    skip default cases whose rows times signature size exceeds this (default 2^27)\n"
+		"  -o file     write the JSON results to file rather than stdout\n";
+
+	// the fewest calls timed in a case
+	const size_t min_repeats = 5;
+
+  /**
+   * bench_case - one point of the grid and what was measured on it
+   */
+	struct bench_case
+	{
+		bool log_signature;
+		size_t width;
+		size_t depth;
+		size_t rows;
+		size_t repeats;
+		double total_seconds;
+		double p50, p90, p99, min, max;
+		// what the first call, which builds the tables and an arena from empty, allocated
+		sigcore::memory_counters memory;
+	};
+
+  /**
+   * time_case - times the signature, or the log signature, of a random walk of rows rows
+   * as GetSigT and GetLogSigT compute them: one fold of the increments into a dense tensor,
+   * followed for the log signature by its logarithm and the projection onto the Hall basis;
+   * the memory of the first call, which is not timed, is counted as a call of its entry
+   */
+	void time_case(bench_case& ans, bool log_signature, size_t width, size_t depth, size_t rows, double seconds)
+	{
+		const dense::tensor_layout layout(width, depth);
+
+		std::vector<S> stream(rows * width);
+		std::mt19937 engine(unsigned(width * 1000003 + depth * 1009 + rows));
+		std::normal_distribution<S> step(0., 1. / double(rows));
+		for (size_t i = width; i < stream.size(); ++i)
+			stream[i] = stream[i - width] + step(engine);
+
+		const sigcore::log_projection* projection = NULL;
+		struct buffers
+		{
+			S *sig, *scratch, *logsig, *out;
+		};
+		auto take = [&](sigcore::arena_scope& scope) -> buffers {
+			buffers b = { scope.allocate<S>(layout.size()), scope.allocate<S>(dense::scratch_size(layout)), NULL, NULL };
+			if (log_signature) {
+				b.logsig = scope.allocate<S>(layout.size());
+				b.out = scope.allocate<S>(projection->size);
+			}
+			return b;
+		};
+		auto call = [&](const buffers& b) {
+			dense::signature(layout, b.sig, stream.data(), rows, b.scratch);
+			if (log_signature) {
+				dense::log(layout, b.logsig, b.sig);
+				projection->apply(b.logsig, b.out);
+			}
+		};
+
+		// the first call builds the projection and warms the caches, on a thread of its own
+		// whose arena starts empty, so that what it takes does not depend on the cases before
+		std::exception_ptr failed;
+		std::thread cold([&]() {
+			try {
+				sigcore::memory_call_scope memory_scope(log_signature ? sigcore::memory_log_signature : sigcore::memory_signature);
+				if (log_signature)
+					projection = &sigcore::get_log_projection(width, depth);
+				sigcore::arena_scope scope;
+				call(take(scope));
+			} catch (...) {
+				failed = std::current_exception();
+			}
+		});
+		cold.join();
+		if (failed)
+			std::rethrow_exception(failed);
+
+		sigcore::arena_scope scope;
+		const buffers warm = take(scope);
+		call(warm);
+
+		typedef std::chrono::steady_clock clock;
+		std::vector<double> latencies;
+		double total = 0.;
+		while (latencies.size() < min_repeats || total < seconds) {
+			const clock::time_point start = clock::now();
+			call(warm);
+			const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			latencies.push_back(elapsed);
+			total += elapsed;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		ans.log_signature = log_signature;
+		ans.width = width;
+		ans.depth = depth;
+		ans.rows = rows;
+		ans.repeats = latencies.size();
+		ans.total_seconds = total;
+		ans.p50 = bench::percentile(latencies, 0.5);
+		ans.p90 = bench::percentile(latencies, 0.9);
+		ans.p99 = bench::percentile(latencies, 0.99);
+		ans.min = latencies.front();
+		ans.max = latencies.back();
+	}
+
+  /**
+   * run_case - time_case with the heap memory its first call took
+   */
+	bench_case run_case(bool log_signature, size_t width, size_t depth, size_t rows, double seconds)
+	{
+		sigcore::reset_memory_stats();
+		bench_case ans;
+		time_case(ans, log_signature, width, depth, rows, seconds);
+		ans.memory = sigcore::get_memory_stats().entries[log_signature ? sigcore::memory_log_signature : sigcore::memory_signature];
+		return ans;
+	}
+
+	void write_json(std::ostream& out, const std::vector<bench_case>& cases, double seconds)
+	{
+		out.precision(9);
+		out << "{\n  \"tool\": \"tosig_bench\",\n  \"kernels\": \"" << dense::kernels().name << "\",\n"
+			<< "  \"threads\": 1,\n  \"min_seconds\": " << seconds << ",\n"
+			<< "  \"process_peak_rss_bytes\": " << sigcore::peak_rss_bytes() << ",\n  \"cases\": [";
+		for (size_t i = 0; i < cases.size(); ++i) {
+			const bench_case& c = cases[i];
+			const double mean = c.total_seconds / double(c.repeats);
+			out << (i > 0 ? "," : "") << "\n    {\"kind\": \"" << (c.log_signature ? "logsig" : "sig")
+				<< "\", \"width\": " << c.width << ", \"depth\": " << c.depth << ", \"rows\": " << c.rows
+				<< ", \"repeats\": " << c.repeats
+				<< ", \"rows_per_second\": " << double(c.rows) / mean
+				<< ", \"signatures_per_second\": " << 1. / mean
+				<< ", \"latency_seconds\": {\"mean\": " << mean << ", \"min\": " << c.min
+				<< ", \"p50\": " << c.p50 << ", \"p90\": " << c.p90 << ", \"p99\": " << c.p99
+				<< ", \"max\": " << c.max << "}"
+				<< ", \"first_call\": {\"allocations\": " << c.memory.allocations
+				<< ", \"bytes_allocated\": " << c.memory.bytes_allocated
+				<< ", \"peak_bytes_in_use\": " << c.memory.peak_bytes_in_use << "}}";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	int run(int argc, char** argv)
+	{
+		std::vector<bool> kinds;
+		std::vector<size_t> widths, depths, lengths(1, 100);
+		lengths.push_back(1000);
+		double seconds = 0.5;
+		size_t max_cells = size_t(1) << 27;
+		std::string output;
+		for (int arg = 1; arg < argc; ++arg) {
+			const std::string option(argv[arg]);
+			if (arg + 1 >= argc)
+				throw std::invalid_argument("unknown option " + option);
+			const std::string value(argv[++arg]);
+			if (option == "-k") {
+				std::istringstream in(value);
+				std::string kind;
+				while (std::getline(in, kind, ','))
+					if (kind == "sig" || kind == "logsig")
+						kinds.push_back(kind == "logsig");
+					else
+						throw std::invalid_argument("invalid kind: " + kind);
+			} else if (option == "-w") {
+				widths = bench::parse_sizes(value, "width");
+			} else if (option == "-d") {
+				depths = bench::parse_sizes(value, "depth");
+			} else if (option == "-n") {
+				lengths = bench::parse_sizes(value, "stream length");
+			} else if (option == "-s") {
+				seconds = atof(value.c_str());
+			} else if (option == "-c") {
+				max_cells = bench::parse_size(value, "cell count");
+			} else if (option == "-o") {
+				output = value;
+			} else {
+				throw std::invalid_argument("unknown option " + option);
+			}
+		}
+		if (kinds.empty()) {
+			kinds.push_back(false);
+			kinds.push_back(true);
+		}
+
+		const char* kernels = getenv("ESIG_KERNELS");
+		if (kernels != NULL && !dense::select_kernels(kernels))
+			std::cerr << "tosig_bench: kernels " << kernels << " are not supported, using "
+				<< dense::kernels().name << "\n";
+
+		// the shapes of the grid, each within the depths switch.h allows for its width
+		std::vector<std::pair<size_t, size_t> > shapes;
+		const bool default_widths = widths.empty();
+		if (default_widths)
+			for (size_t r = 0; r < sigcore::no_shape_ranges; ++r) {
+				widths.push_back(sigcore::shape_ranges[r].min_width);
+				if (sigcore::shape_ranges[r].max_width != sigcore::shape_ranges[r].min_width)
+					widths.push_back(sigcore::shape_ranges[r].max_width);
+			}
+		for (size_t i = 0; i < widths.size(); ++i) {
+			const sigcore::shape_range* range = sigcore::find_shape_range(widths[i]);
+			if (range == NULL)
+				throw std::invalid_argument("width " + std::to_string(widths[i]) + " is outside the ranges of switch_generator.py");
+			std::vector<size_t> shape_depths = depths;
+			if (shape_depths.empty()) {
+				shape_depths.push_back(2);
+				shape_depths.push_back((2 + range->max_depth) / 2);
+				shape_depths.push_back(range->max_depth);
+				shape_depths.erase(std::unique(shape_depths.begin(), shape_depths.end()), shape_depths.end());
+			}
+			for (size_t j = 0; j < shape_depths.size(); ++j)
+				if (shape_depths[j] < 2 || shape_depths[j] > range->max_depth)
+					std::cerr << "tosig_bench: skipping width " << widths[i] << " at depth " << shape_depths[j]
+						<< ", outside the depths 2 to " << range->max_depth << " of its range\n";
+				else
+					shapes.push_back(std::make_pair(widths[i], shape_depths[j]));
+		}
+
+		std::vector<bench_case> cases;
+		for (size_t s = 0; s < shapes.size(); ++s)
+			for (size_t n = 0; n < lengths.size(); ++n) {
+				const size_t width = shapes[s].first, depth = shapes[s].second, rows = lengths[n];
+				if (depths.empty() && double(rows) * double(dense::tensor_layout(width, depth).size()) > double(max_cells)) {
+					std::cerr << "tosig_bench: skipping width " << width << " depth " << depth << " rows " << rows
+						<< ", raise -c or give -d to run it\n";
+					continue;
+				}
+				for (size_t k = 0; k < kinds.size(); ++k) {
+					cases.push_back(run_case(kinds[k], width, depth, rows, seconds));
+					const bench_case& c = cases.back();
+					std::cerr << "tosig_bench: " << (c.log_signature ? "logsig" : "sig") << " width " << width
+						<< " depth " << depth << " rows " << rows << ": p50 " << c.p50 * 1e6 << " us, "
+						<< double(rows) * double(c.repeats) / c.total_seconds << " rows/s\n";
+				}
+			}
+
+		bench::write_output(output, [&](std::ostream& out) { write_json(out, cases, seconds); });
+		return 0;
+	}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	return bench::run_tool("tosig_bench", usage, run, argc, argv);
+}
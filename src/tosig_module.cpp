@@ -15,7 +15,17 @@
 #include <numpy/arrayobject.h>
 
 #include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
 #include "ToSig.h"
+#include "DenseKernels.h"
+#include "Latency.h"
+#include "Memory.h"
+#include "Profile.h"
+#include "SigWords.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 #ifndef ESIG_NO_RECOMBINE
 #include "_recombine.h"
@@ -30,9 +40,37 @@ extern "C" {
 /* ==== Prototypes ================================== */
 /* .... The ToSig Functionality ......................*/
 static PyObject *tologsig(PyObject *self, PyObject *args);
-static PyObject *tosig(PyObject *self, PyObject *args);
+static PyObject *tosig(PyObject *self, PyObject *args, PyObject *keywds);
+static PyObject *tosigsubset(PyObject *self, PyObject *args);
+static PyObject *tosigweighted(PyObject *self, PyObject *args);
+static PyObject *getweightedsigsize(PyObject *self, PyObject *args);
+static PyObject *showweightedsigkeys(PyObject *self, PyObject *args);
 static PyObject *getlogsigsize(PyObject *self, PyObject *args);
 static PyObject *getsigsize(PyObject *self, PyObject *args);
+static PyObject *tensorexp(PyObject *self, PyObject *args);
+static PyObject *tensorlog(PyObject *self, PyObject *args);
+static PyObject *tensorinverse(PyObject *self, PyObject *args);
+static PyObject *accumulatesig(PyObject *self, PyObject *args, PyObject *keywds);
+static PyObject *extendsig(PyObject *self, PyObject *args, PyObject *keywds);
+static PyObject *tosigragged(PyObject *self, PyObject *args, PyObject *keywds);
+static PyObject *tologsigragged(PyObject *self, PyObject *args, PyObject *keywds);
+static PyObject *sig2logsig(PyObject *self, PyObject *args);
+static PyObject *getkernels(PyObject *self, PyObject *args);
+static PyObject *setkernels(PyObject *self, PyObject *args);
+static PyObject *availablekernels(PyObject *self, PyObject *args);
+static PyObject *getnumthreads(PyObject *self, PyObject *args);
+static PyObject *setnumthreads(PyObject *self, PyObject *args);
+static PyObject *getprofile(PyObject *self, PyObject *args);
+static PyObject *resetprofile(PyObject *self, PyObject *args);
+static PyObject *setprofiling(PyObject *self, PyObject *args);
+static PyObject *getmemorystats(PyObject *self, PyObject *args);
+static PyObject *resetmemorystats(PyObject *self, PyObject *args);
+static PyObject *gettrace(PyObject *self, PyObject *args);
+static PyObject *resettrace(PyObject *self, PyObject *args);
+static PyObject *settracing(PyObject *self, PyObject *args);
+static PyObject *getlatencyhistograms(PyObject *self, PyObject *args);
+static PyObject *resetlatencyhistograms(PyObject *self, PyObject *args);
+static PyObject *setlatencyrecording(PyObject *self, PyObject *args);
 #ifndef ESIG_NO_RECOMBINE
 static PyObject *pyrecombine(PyObject *self, PyObject *args, PyObject *keywds);
 #endif
@@ -87,11 +125,26 @@ PyDoc_STRVAR(stream2logsig_doc,
 );
 
 PyDoc_STRVAR(stream2sig_doc,
-"stream2logsig(array(no_of_ticks x signal_dimension),"
-" signature_degree) reads a 2 dimensional numpy array"
+"stream2sig(array(no_of_ticks x signal_dimension),"
+" signature_degree, num_threads=1, min_chunk_rows=65536)"
+" reads a 2 dimensional numpy array"
 " of floats, \"the data in stream space\" and returns"
 " a numpy vector containing the signature of the vector"
-" series up to given signature degree"
+" series up to given signature degree. Unless num_threads"
+" is 1, a stream with at least 2 min_chunk_rows increments"
+" is split into chunks whose signatures are computed on"
+" up to num_threads threads (0 uses get_num_threads()) and"
+" multiplied together"
+);
+
+PyDoc_STRVAR(stream2sig_subset_doc,
+"stream2sig_subset(array(no_of_ticks x signal_dimension),"
+" signature_degree, indices) returns a numpy vector holding"
+" the coordinates of the signature at the given indices into"
+" the output of stream2sig. Only those coordinates and the"
+" ones of the prefixes of their words are computed, so the"
+" cost grows with the number of coordinates asked for and not"
+" with the size of the signature"
 );
 
 PyDoc_STRVAR(logsigdim_doc,
@@ -119,6 +172,222 @@ PyDoc_STRVAR(sigkeys_doc,
 " string containing the keys associated the entries in"
 " the signature returned by stream2sig"
 );
+PyDoc_STRVAR(stream2sig_weighted_doc,
+"stream2sig_weighted(array(no_of_ticks x signal_dimension),"
+" weights, budget) returns a numpy vector containing the"
+" signature of the stream truncated by weighted length: a"
+" word is kept while the sum of the positive integer weights"
+" of its letters, channel i weighing weights[i], is at most"
+" budget. The coordinates are those of the full signature"
+" with the other words left out, in the same order, and only"
+" they are computed"
+);
+
+PyDoc_STRVAR(weightedsigdim_doc,
+"weightedsigdim(weights, budget) returns the length of the"
+" vector returned by stream2sig_weighted"
+);
+
+PyDoc_STRVAR(weightedsigkeys_doc,
+"weightedsigkeys(weights, budget) returns, in the order"
+" used by stream2sig_weighted, a space separated ascii string"
+" containing the keys associated the entries in the"
+" signature returned by stream2sig_weighted"
+);
+
+PyDoc_STRVAR(tensorexp_doc,
+"tensorexp(tensors, signal_dimension, signature_degree)"
+" reads a numpy array whose last axis holds tensors laid"
+" out as in the output of stream2sig and returns an array"
+" of the same shape containing their truncated exponentials"
+);
+
+PyDoc_STRVAR(tensorlog_doc,
+"tensorlog(tensors, signal_dimension, signature_degree)"
+" reads a numpy array whose last axis holds tensors laid"
+" out as in the output of stream2sig and returns an array"
+" of the same shape containing their truncated logarithms;"
+" the scalar term of each tensor must be positive"
+);
+
+PyDoc_STRVAR(tensorinverse_doc,
+"tensorinverse(tensors, signal_dimension, signature_degree)"
+" reads a numpy array whose last axis holds tensors laid"
+" out as in the output of stream2sig and returns an array"
+" of the same shape containing their truncated inverses;"
+" the inverse of a signature is the signature of the"
+" reversed path"
+);
+
+PyDoc_STRVAR(accumulatesig_doc,
+"accumulatesig(streams, signature_degree, count, mean, m2=None,"
+" num_threads=0) folds the signatures of a batch of streams,"
+" given as a 3 dimensional numpy array (no_streams x no_of_ticks"
+" x signal_dimension) or a sequence of 2 dimensional arrays, into"
+" the running mean of count signatures held in the contiguous"
+" numpy vector mean and, if m2 is given, the running sum of"
+" squared deviations from the mean held in m2. Both vectors are"
+" updated in place and the new count is returned. The work is"
+" shared by num_threads threads (0 uses get_num_threads()), each keeping"
+" one accumulator, so the memory used does not depend on the"
+" number of streams"
+);
+
+PyDoc_STRVAR(stream2sig_ragged_doc,
+"stream2sig_ragged(array(total_no_of_ticks x signal_dimension),"
+" offsets, signature_degree, num_threads=0) reads a batch of"
+" streams of different lengths stored one after another in a"
+" 2 dimensional numpy array of floats, stream i being the rows"
+" offsets[i]:offsets[i+1], and returns a numpy array"
+" (len(offsets) - 1 x sigdim) whose rows are their signatures,"
+" computed on num_threads threads (0 uses get_num_threads());"
+" the threads steal work from each other and a stream much"
+" longer than the rest is split into pieces computed in parallel"
+);
+
+PyDoc_STRVAR(stream2logsig_ragged_doc,
+"stream2logsig_ragged(array(total_no_of_ticks x signal_dimension),"
+" offsets, signature_degree, num_threads=0) returns, as"
+" stream2sig_ragged does for signatures, a numpy array"
+" (len(offsets) - 1 x logsigdim) whose rows are the log"
+" signatures of the streams"
+);
+
+PyDoc_STRVAR(extendsig_doc,
+"extendsig(sig, array(no_of_ticks x signal_dimension),"
+" signature_degree, previous=None) multiplies, in place,"
+" the signature held in the contiguous numpy vector sig by"
+" the signature of the rows of the array, including the"
+" increment from the row previous if it is given, so that"
+" the signature of a stream too large for memory can be"
+" computed piece by piece starting from the signature of"
+" a single point, (1, 0, 0, ...)"
+);
+
+PyDoc_STRVAR(sig2logsig_doc,
+"sig2logsig(sig, signal_dimension, signature_degree)"
+" reads a numpy vector holding a signature laid out as"
+" in the output of stream2sig and returns a numpy vector"
+" containing the corresponding log signature laid out as"
+" in the output of stream2logsig"
+);
+
+PyDoc_STRVAR(get_kernels_doc,
+"get_kernels() returns the name of the vectorised kernels"
+" used for the tensor products in stream2sig, tensorexp,"
+" tensorlog, tensorinverse and accumulatesig"
+);
+
+PyDoc_STRVAR(set_kernels_doc,
+"set_kernels(name=None) selects the vectorised kernels by"
+" name, one of available_kernels(); None selects the fastest"
+" the cpu supports, which is also the choice made at import"
+" unless the environment variable ESIG_KERNELS names another."
+" Raises ValueError if the cpu does not support the kernels"
+);
+
+PyDoc_STRVAR(available_kernels_doc,
+"available_kernels() returns a tuple with the names of the"
+" vectorised kernels the cpu supports, slowest first"
+);
+
+PyDoc_STRVAR(get_num_threads_doc,
+"get_num_threads() returns the number of threads of the"
+" pool shared by every parallel computation in tosig, used"
+" wherever num_threads is 0"
+);
+
+PyDoc_STRVAR(set_num_threads_doc,
+"set_num_threads(n=0) sets the number of threads of the"
+" pool shared by every parallel computation in tosig; 0"
+" restores the default, the environment variable"
+" ESIG_NUM_THREADS if it is set and otherwise the cores this"
+" process may run on, capped by any cgroup cpu quota"
+);
+
+PyDoc_STRVAR(get_profile_doc,
+"get_profile() returns a dict mapping (width, depth) to a"
+" dict mapping each phase of the signature computations,"
+" 'convert', 'signature', 'log' and 'project', to a pair"
+" (calls, seconds) accumulated since the last reset_profile()"
+" while profiling was on"
+);
+
+PyDoc_STRVAR(reset_profile_doc,
+"reset_profile() clears the counters of get_profile()"
+);
+
+PyDoc_STRVAR(set_profiling_doc,
+"set_profiling(on=True) starts or stops timing the phases of"
+" the signature computations, returning whether they were"
+" timed before; profiling is off unless the environment"
+" variable ESIG_PROFILE is set"
+);
+
+PyDoc_STRVAR(get_memory_stats_doc,
+"get_memory_stats() returns a dict of the heap memory taken by"
+" tosig since the last reset_memory_stats(): 'allocations',"
+" 'bytes_allocated', 'bytes_in_use', 'peak_bytes_in_use',"
+" 'peak_rss_bytes', the peak resident memory of the process"
+" over its life, and, under 'calls', a dict for each of"
+" 'signature', 'log_signature' and 'recombine' of the 'calls',"
+" their 'allocations' and 'bytes_allocated', and the most bytes"
+" one call held at once, over all calls, 'peak_bytes_in_use',"
+" and in the last, 'last_peak_bytes_in_use'. Everything tosig"
+" allocates is counted, tables, arenas and work buffers, with"
+" the numpy arrays of the answers by their size"
+);
+
+PyDoc_STRVAR(reset_memory_stats_doc,
+"reset_memory_stats() zeroes the counters of get_memory_stats()"
+);
+
+PyDoc_STRVAR(get_trace_doc,
+"get_trace() returns, as a Chrome trace JSON string, the tasks"
+" of the ragged batch functions and of recombine recorded since"
+" the last reset_trace() while tracing was on: for each thread"
+" of the pool, the stream each task computed and when. Save it"
+" to a file and open it in chrome://tracing or Perfetto. The events"
+" of threads that have exited are kept until reset_trace()"
+);
+
+PyDoc_STRVAR(reset_trace_doc,
+"reset_trace() forgets the events of get_trace() and frees the"
+" buffers of the threads that have exited"
+);
+
+PyDoc_STRVAR(set_tracing_doc,
+"set_tracing(on=True) starts or stops recording the tasks of"
+" the batch computations, returning whether they were recorded"
+" before; tracing is off unless the environment variable"
+" ESIG_TRACE is set to something other than 0"
+);
+
+PyDoc_STRVAR(get_latency_histograms_doc,
+"get_latency_histograms() returns a dict of the time taken by the"
+" calls of stream2sig, stream2logsig and recombine since the last"
+" reset_latency_histograms() while recording was on: 'bounds', a"
+" numpy array of the edges of the buckets in seconds, one more than"
+" the buckets, and 'histograms', a dict from (entry, width, depth),"
+" entry being 'signature', 'log_signature' or 'recombine' and width"
+" and depth its dimension and degree for recombine, to a dict of"
+" 'calls', 'total_seconds', 'max_seconds' and 'counts', a numpy"
+" array of the calls in each bucket. esig.latency.percentiles"
+" reads percentiles off it"
+);
+
+PyDoc_STRVAR(reset_latency_histograms_doc,
+"reset_latency_histograms() zeroes the counts of"
+" get_latency_histograms()"
+);
+
+PyDoc_STRVAR(set_latency_recording_doc,
+"set_latency_recording(on=True) starts or stops counting the time"
+" of each call of stream2sig, stream2logsig and recombine, returning"
+" whether it was counted before; it is not unless the environment"
+" variable ESIG_LATENCY is set to something other than 0"
+);
+
 #ifndef ESIG_NO_RECOMBINE
 PyDoc_STRVAR(recombine_doc,
 "recombine(ensemble, selector=(0,1,2,...no_points-1),"
@@ -152,11 +421,39 @@ PyDoc_STRVAR(recombine_doc,
 /* ==== Set up the methods table ====================== */
 static PyMethodDef _C_tosigMethods[] = {
         {"stream2logsig", tologsig, METH_VARARGS, stream2logsig_doc},
-        {"stream2sig", tosig, METH_VARARGS, stream2sig_doc},
+        {"stream2sig", (PyCFunction) tosig, METH_VARARGS | METH_KEYWORDS, stream2sig_doc},
+        {"stream2sig_subset", tosigsubset, METH_VARARGS, stream2sig_subset_doc},
+        {"stream2sig_weighted", tosigweighted, METH_VARARGS, stream2sig_weighted_doc},
+        {"weightedsigdim", getweightedsigsize, METH_VARARGS, weightedsigdim_doc},
+        {"weightedsigkeys", showweightedsigkeys, METH_VARARGS, weightedsigkeys_doc},
         {"logsigdim", getlogsigsize, METH_VARARGS, logsigdim_doc},
         {"sigdim", getsigsize, METH_VARARGS, sigdim_doc},
         {"logsigkeys",showlogsigkeys, METH_VARARGS, logsigkeys_doc},
         {"sigkeys",showsigkeys, METH_VARARGS, sigkeys_doc},
+        {"tensorexp", tensorexp, METH_VARARGS, tensorexp_doc},
+        {"tensorlog", tensorlog, METH_VARARGS, tensorlog_doc},
+        {"tensorinverse", tensorinverse, METH_VARARGS, tensorinverse_doc},
+        {"accumulatesig", (PyCFunction) accumulatesig, METH_VARARGS | METH_KEYWORDS, accumulatesig_doc},
+        {"stream2sig_ragged", (PyCFunction) tosigragged, METH_VARARGS | METH_KEYWORDS, stream2sig_ragged_doc},
+        {"stream2logsig_ragged", (PyCFunction) tologsigragged, METH_VARARGS | METH_KEYWORDS, stream2logsig_ragged_doc},
+        {"extendsig", (PyCFunction) extendsig, METH_VARARGS | METH_KEYWORDS, extendsig_doc},
+        {"sig2logsig", sig2logsig, METH_VARARGS, sig2logsig_doc},
+        {"get_kernels", getkernels, METH_NOARGS, get_kernels_doc},
+        {"set_kernels", setkernels, METH_VARARGS, set_kernels_doc},
+        {"available_kernels", availablekernels, METH_NOARGS, available_kernels_doc},
+        {"get_num_threads", getnumthreads, METH_NOARGS, get_num_threads_doc},
+        {"set_num_threads", setnumthreads, METH_VARARGS, set_num_threads_doc},
+        {"get_profile", getprofile, METH_NOARGS, get_profile_doc},
+        {"reset_profile", resetprofile, METH_NOARGS, reset_profile_doc},
+        {"set_profiling", setprofiling, METH_VARARGS, set_profiling_doc},
+        {"get_memory_stats", getmemorystats, METH_NOARGS, get_memory_stats_doc},
+        {"reset_memory_stats", resetmemorystats, METH_NOARGS, reset_memory_stats_doc},
+        {"get_trace", gettrace, METH_NOARGS, get_trace_doc},
+        {"reset_trace", resettrace, METH_NOARGS, reset_trace_doc},
+        {"set_tracing", settracing, METH_VARARGS, set_tracing_doc},
+        {"get_latency_histograms", getlatencyhistograms, METH_NOARGS, get_latency_histograms_doc},
+        {"reset_latency_histograms", resetlatencyhistograms, METH_NOARGS, reset_latency_histograms_doc},
+        {"set_latency_recording", setlatencyrecording, METH_VARARGS, set_latency_recording_doc},
 #ifndef ESIG_NO_RECOMBINE
         {"recombine", (PyCFunction) pyrecombine, METH_VARARGS | METH_KEYWORDS, recombine_doc},
 #endif
@@ -187,6 +484,8 @@ PyInit_tosig(void){
     // Needed for using numpy arrays in the module
     import_array();
 
+    // an unsupported choice is ignored, leaving the fastest kernels in place
+    dense::select_kernels(getenv("ESIG_KERNELS"));
 
 
 
@@ -197,6 +496,25 @@ PyInit_tosig(void){
 
 
 
+/* ==== Read a stream as a contiguous array of doubles ========================
+    PyArray_FROMANY timed as the convert phase of the profile of the width,
+    its last dimension, and depth when profiling is on                       */
+static PyArrayObject* stream_from_any(PyObject* in, int min_dims, int max_dims, Py_ssize_t depth)
+{
+    std::chrono::steady_clock::time_point start;
+    PyArrayObject *ans;
+
+    if (!sigcore::profiling_enabled.load(std::memory_order_relaxed))
+        return (PyArrayObject*) PyArray_FROMANY(in, NPY_DOUBLE, min_dims, max_dims, NPY_ARRAY_IN_ARRAY);
+    start = std::chrono::steady_clock::now();
+    ans = (PyArrayObject*) PyArray_FROMANY(in, NPY_DOUBLE, min_dims, max_dims, NPY_ARRAY_IN_ARRAY);
+    if (ans != NULL && depth > 0)
+        sigcore::add_to_profile((size_t) PyArray_DIM(ans, PyArray_NDIM(ans) - 1), (size_t) depth,
+            sigcore::phase_convert,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return ans;
+}
+
 /* ==== Operate on Matrix as a vector time series returning a vectorlog signature ==
     Returns a NEW NumPy vector
     interface:  tologsig(series1, depth)
@@ -206,6 +524,7 @@ PyInit_tosig(void){
 
 static PyObject* tologsig(PyObject* self, PyObject* args)
 {
+    sigcore::scoped_latency_timer latency(sigcore::latency_log_signature);
     PyArrayObject *seriesin, *vecout;
     //double *cout;
     //Py_ssize_t width, depth, recs;
@@ -236,29 +555,44 @@ static PyObject* tologsig(PyObject* self, PyObject* args)
     // to be handled here
     if (!GetLogSig(seriesin, vecout, width, depth))
         return NULL;
+    latency.shape((size_t) width, (size_t) depth);
 
     return PyArray_Return(vecout);
 }
 
 /* ==== Operate on Matrix as a vector time series returning a vector signature ==
     Returns a NEW NumPy vector
-    interface:  tosig(series1, depth)
+    interface:  tosig(series1, depth, num_threads=1, min_chunk_rows=65536)
                 series1 is NumPy matrix
 				depth is a positive integer of Py_ssize_t
+                num_threads and min_chunk_rows are non-negative Py_ssize_t
                 returns a NumPy vector                                       */
 
-static PyObject* tosig(PyObject* self, PyObject* args)
+static PyObject* tosig(PyObject* self, PyObject* args, PyObject* keywds)
 {
-    PyArrayObject *seriesin, *vecout;
+    sigcore::scoped_latency_timer latency(sigcore::latency_signature);
+    PyArrayObject *arrayin, *seriesin, *vecout;
     //double *cout;
     //Py_ssize_t width, depth, recs;
-    Py_ssize_t depth;
+    Py_ssize_t depth, num_threads = 1, min_chunk_rows = TOSIG_MIN_CHUNK_ROWS;
     npy_intp width;
     npy_intp dims[2];
+    int ok;
 
     /* Parse tuple */
-    if (!PyArg_ParseTuple(args, "O!n",
-                          &PyArray_Type, &seriesin, &depth))  return NULL;
+    static char* kwlist[] = { "stream", "depth", "num_threads", "min_chunk_rows", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!n|nn:stream2sig", kwlist,
+                                     &PyArray_Type, &arrayin, &depth, &num_threads, &min_chunk_rows))
+        return NULL;
+    if (NULL == arrayin)  return NULL;
+    if (num_threads < 0 || min_chunk_rows < 0) {
+        PyErr_SetString(PyExc_ValueError, "num_threads and min_chunk_rows must not be negative");
+        return NULL;
+    }
+
+    /* The signature is computed straight from the buffer, so it must be
+       a contiguous matrix of doubles; this copies only if it is not */
+    seriesin = stream_from_any((PyObject*) arrayin, 2, 2, depth);
     if (NULL == seriesin)  return NULL;
 
     /* Check that object input is 'double' type and a matrix*/
@@ -268,21 +602,474 @@ static PyObject* tosig(PyObject* self, PyObject* args)
     //width = seriesin->dimensions[1];
     //recs = seriesin->dimensions[0];
     width = PyArray_DIM(seriesin, 1);
-    GetLogSigSize((size_t)width, (size_t)depth); //initialise basis
     dims[0] = (npy_intp) GetSigSize((size_t)width, (size_t)depth);
 
     /* Make a new double vector of correct dimension */
     vecout=(PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (NULL == vecout) {
+        Py_DECREF(seriesin);
+        return NULL;
+    }
 
     /* Do the calculation. */
     // SM 8/10/20: added error handling to the switch statement
     // to be handled here
-    if (!GetSig(seriesin, vecout, width, depth))
+    ok = GetSig(seriesin, vecout, width, depth, (size_t) num_threads, (size_t) min_chunk_rows);
+    Py_DECREF(seriesin);
+    if (!ok) {
+        Py_DECREF(vecout);
         return NULL;
+    }
+    latency.shape((size_t) width, (size_t) depth);
 
     return PyArray_Return(vecout);
 }
 
+/* ==== Chosen coordinates of the signature =================================
+    Returns a NEW NumPy vector
+    interface:  tosigsubset(stream, depth, indices)
+                stream is a NumPy matrix of doubles
+                depth is a positive integer of Py_ssize_t
+                indices is a NumPy vector of indexes into the signature
+                returns a NumPy vector with a coordinate per index        */
+static PyObject* tosigsubset(PyObject* self, PyObject* args)
+{
+    PyObject *streamin, *indicesin;
+    PyArrayObject *stream = NULL, *indices = NULL, *out = NULL;
+    size_t *keys = NULL;
+    Py_ssize_t depth;
+    npy_intp no_indices, i;
+    const npy_intp *index;
+    int ok;
+
+    if (!PyArg_ParseTuple(args, "OnO:stream2sig_subset", &streamin, &depth, &indicesin))
+        return NULL;
+    if (depth < 0) {
+        PyErr_SetString(PyExc_ValueError, "depth must not be negative");
+        return NULL;
+    }
+
+    stream = (PyArrayObject*) PyArray_FROMANY(streamin, NPY_DOUBLE, 2, 2, NPY_ARRAY_IN_ARRAY);
+    if (NULL == stream)  goto exit;
+    indices = (PyArrayObject*) PyArray_FROMANY(indicesin, NPY_INTP, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if (NULL == indices)  goto exit;
+    no_indices = PyArray_DIM(indices, 0);
+
+// CHECK THE INDEXES ARE NOT NEGATIVE, THE REST IS CHECKED AGAINST THE DEPTH
+    index = (const npy_intp*) PyArray_DATA(indices);
+    keys = (size_t*) malloc((no_indices + 1) * sizeof(size_t));
+    if (NULL == keys) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    for (i = 0; i < no_indices; ++i) {
+        if (index[i] < 0) {
+            PyErr_SetString(PyExc_IndexError, "signature indices must not be negative");
+            goto exit;
+        }
+        keys[i] = (size_t) index[i];
+    }
+
+    out = (PyArrayObject*) PyArray_SimpleNew(1, &no_indices, NPY_DOUBLE);
+    if (NULL == out)  goto exit;
+
+// DO THE CALCULATION WITHOUT THE INTERPRETER LOCK
+    Py_BEGIN_ALLOW_THREADS
+    ok = GetSigSubset((const double*) PyArray_DATA(stream), (size_t) PyArray_DIM(stream, 0),
+                      (size_t) PyArray_DIM(stream, 1), (size_t) depth, keys, (size_t) no_indices,
+                      (double*) PyArray_DATA(out));
+    Py_END_ALLOW_THREADS
+    if (!ok)
+        Py_CLEAR(out);
+
+    exit:
+    free(keys);
+    Py_XDECREF(stream);
+    Py_XDECREF(indices);
+    return (PyObject*) out;
+}
+
+/* ==== Signature truncated at a weighted length ============================
+    interface:  tosigweighted(stream, weights, budget)
+                getweightedsigsize(weights, budget)
+                showweightedsigkeys(weights, budget)
+                stream is a NumPy matrix of doubles
+                weights is a NumPy vector of a positive integer per channel
+                budget is a non-negative integer of Py_ssize_t             */
+
+/* the weights as a new array of size_t, or NULL with an exception set */
+static size_t* read_weights(PyObject* weightsin, npy_intp* width)
+{
+    PyArrayObject *weights;
+    const npy_intp *weight;
+    size_t *ans;
+    npy_intp i;
+
+    weights = (PyArrayObject*) PyArray_FROMANY(weightsin, NPY_INTP, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if (NULL == weights)  return NULL;
+    *width = PyArray_DIM(weights, 0);
+    weight = (const npy_intp*) PyArray_DATA(weights);
+    ans = (size_t*) malloc((*width + 1) * sizeof(size_t));
+    if (NULL == ans) {
+        Py_DECREF(weights);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (i = 0; i < *width; ++i) {
+        if (weight[i] <= 0) {
+            Py_DECREF(weights);
+            free(ans);
+            PyErr_SetString(PyExc_ValueError, "letter weights must be positive");
+            return NULL;
+        }
+        ans[i] = (size_t) weight[i];
+    }
+    Py_DECREF(weights);
+    return ans;
+}
+
+static PyObject* tosigweighted(PyObject* self, PyObject* args)
+{
+    PyObject *streamin, *weightsin;
+    PyArrayObject *stream = NULL, *out = NULL;
+    size_t *weights = NULL;
+    Py_ssize_t budget;
+    npy_intp width, dims[1];
+    int ok;
+
+    if (!PyArg_ParseTuple(args, "OOn:stream2sig_weighted", &streamin, &weightsin, &budget))
+        return NULL;
+    if (budget < 0) {
+        PyErr_SetString(PyExc_ValueError, "budget must not be negative");
+        return NULL;
+    }
+    weights = read_weights(weightsin, &width);
+    if (NULL == weights)  goto exit;
+    stream = (PyArrayObject*) PyArray_FROMANY(streamin, NPY_DOUBLE, 2, 2, NPY_ARRAY_IN_ARRAY);
+    if (NULL == stream)  goto exit;
+    if (PyArray_DIM(stream, 1) != width) {
+        PyErr_SetString(PyExc_ValueError, "there must be a weight for each channel of the stream");
+        goto exit;
+    }
+
+    dims[0] = (npy_intp) GetWeightedSigSize(weights, (size_t) width, (size_t) budget);
+    if (dims[0] == 0)  goto exit;
+    out = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (NULL == out)  goto exit;
+
+// DO THE CALCULATION WITHOUT THE INTERPRETER LOCK
+    Py_BEGIN_ALLOW_THREADS
+    ok = GetWeightedSig((const double*) PyArray_DATA(stream), (size_t) PyArray_DIM(stream, 0),
+                        (size_t) width, weights, (size_t) budget, (double*) PyArray_DATA(out));
+    Py_END_ALLOW_THREADS
+    if (!ok)
+        Py_CLEAR(out);
+
+    exit:
+    free(weights);
+    Py_XDECREF(stream);
+    return (PyObject*) out;
+}
+
+static PyObject* getweightedsigsize(PyObject* self, PyObject* args)
+{
+    PyObject *weightsin;
+    size_t *weights, size;
+    Py_ssize_t budget;
+    npy_intp width;
+
+    if (!PyArg_ParseTuple(args, "On:weightedsigdim", &weightsin, &budget))  return NULL;
+    if (budget < 0) {
+        PyErr_SetString(PyExc_ValueError, "budget must not be negative");
+        return NULL;
+    }
+    weights = read_weights(weightsin, &width);
+    if (NULL == weights)  return NULL;
+    size = GetWeightedSigSize(weights, (size_t) width, (size_t) budget);
+    free(weights);
+    if (size == 0)  return NULL;
+    return PyLong_FromSize_t(size);
+}
+
+static PyObject* showweightedsigkeys(PyObject* self, PyObject* args)
+{
+    PyObject *weightsin, *out = NULL;
+    size_t *weights;
+    Py_ssize_t budget;
+    npy_intp width;
+
+    if (!PyArg_ParseTuple(args, "On:weightedsigkeys", &weightsin, &budget))  return NULL;
+    if (budget < 0) {
+        PyErr_SetString(PyExc_ValueError, "budget must not be negative");
+        return NULL;
+    }
+    weights = read_weights(weightsin, &width);
+    if (NULL == weights)  return NULL;
+    try {
+        std::shared_ptr<const sigcore::weighted_words> words
+            = sigcore::get_weighted_words(weights, (size_t) width, (size_t) budget);
+        const sigcore::word_tree& tree = words->tree;
+        std::string keys;
+        for (size_t node = 0; node < tree.size(); ++node)
+            keys += " " + sigcore::word_key(tree, node);
+        out = PyUnicode_FromString(keys.c_str());
+    } catch (std::exception& exc) {
+        PyErr_SetString(PyExc_RuntimeError, exc.what());
+    }
+    free(weights);
+    return out;
+}
+
+/* ==== Choose the vectorised tensor product kernels =========================
+    interface:  get_kernels()
+                set_kernels(name=None)
+                available_kernels()
+                name is a str or None                                       */
+static PyObject* getkernels(PyObject* self, PyObject* args)
+{
+    return PyUnicode_FromString(dense::kernels().name);
+}
+
+static PyObject* setkernels(PyObject* self, PyObject* args)
+{
+    const char *name = NULL;
+
+    if (!PyArg_ParseTuple(args, "|z", &name))  return NULL;
+    if (!dense::select_kernels(name)) {
+        PyErr_Format(PyExc_ValueError, "kernels '%s' are not supported on this cpu", name);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* availablekernels(PyObject* self, PyObject* args)
+{
+    const char* const* names = dense::available_kernels();
+    Py_ssize_t no_names = 0, i;
+    PyObject *ans;
+
+    while (names[no_names] != NULL)
+        ++no_names;
+    ans = PyTuple_New(no_names);
+    if (NULL == ans)  return NULL;
+    for (i = 0; i < no_names; ++i) {
+        PyObject *name = PyUnicode_FromString(names[i]);
+        if (NULL == name) {
+            Py_DECREF(ans);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(ans, i, name);
+    }
+    return ans;
+}
+
+/* ==== Size the thread pool shared by the parallel computations ============
+    interface:  get_num_threads()
+                set_num_threads(n=0)
+                n is a non-negative integer                                  */
+static PyObject* getnumthreads(PyObject* self, PyObject* args)
+{
+    return PyLong_FromSize_t(sigcore::get_num_threads());
+}
+
+static PyObject* setnumthreads(PyObject* self, PyObject* args)
+{
+    Py_ssize_t n = 0;
+
+    if (!PyArg_ParseTuple(args, "|n", &n))  return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "the number of threads must not be negative");
+        return NULL;
+    }
+    sigcore::set_num_threads((size_t) n);
+    Py_RETURN_NONE;
+}
+
+/* ==== Time the phases of the signature computations ========================
+    interface:  get_profile()
+                reset_profile()
+                set_profiling(on=True)
+                on is a bool                                                 */
+static PyObject* getprofile(PyObject* self, PyObject* args)
+{
+    const sigcore::profile counters = sigcore::get_profile();
+    PyObject *ans = PyDict_New(), *key = NULL, *phases = NULL;
+    int phase;
+
+    if (NULL == ans)  return NULL;
+    for (sigcore::profile::const_iterator it = counters.begin(); it != counters.end(); ++it) {
+        key = Py_BuildValue("(nn)", (Py_ssize_t) it->first.first, (Py_ssize_t) it->first.second);
+        phases = PyDict_New();
+        if (NULL == key || NULL == phases)
+            goto fail;
+        for (phase = 0; phase < sigcore::no_profile_phases; ++phase) {
+            PyObject *value = Py_BuildValue("(nd)", (Py_ssize_t) it->second.calls[phase],
+                                            it->second.seconds[phase]);
+            if (NULL == value || PyDict_SetItemString(phases, sigcore::profile_phase_names[phase], value) < 0) {
+                Py_XDECREF(value);
+                goto fail;
+            }
+            Py_DECREF(value);
+        }
+        if (PyDict_SetItem(ans, key, phases) < 0)
+            goto fail;
+        Py_CLEAR(key);
+        Py_CLEAR(phases);
+    }
+    return ans;
+
+fail:
+    Py_XDECREF(key);
+    Py_XDECREF(phases);
+    Py_DECREF(ans);
+    return NULL;
+}
+
+static PyObject* resetprofile(PyObject* self, PyObject* args)
+{
+    sigcore::reset_profile();
+    Py_RETURN_NONE;
+}
+
+static PyObject* setprofiling(PyObject* self, PyObject* args)
+{
+    int on = 1;
+
+    if (!PyArg_ParseTuple(args, "|p", &on))  return NULL;
+    return PyBool_FromLong(sigcore::set_profiling(on != 0));
+}
+
+/* ==== Account for the heap memory taken by the computations ================
+    interface:  get_memory_stats()
+                reset_memory_stats()                                         */
+static PyObject* getmemorystats(PyObject* self, PyObject* args)
+{
+    const sigcore::memory_stats stats = sigcore::get_memory_stats();
+    PyObject *ans = NULL, *calls = NULL, *entry;
+    int e;
+
+    calls = PyDict_New();
+    if (NULL == calls)  return NULL;
+    for (e = 0; e < sigcore::no_memory_entries; ++e) {
+        const sigcore::memory_counters& counters = stats.entries[e];
+        entry = Py_BuildValue("{s:n,s:n,s:n,s:n,s:n}",
+                              "calls", (Py_ssize_t) counters.calls,
+                              "allocations", (Py_ssize_t) counters.allocations,
+                              "bytes_allocated", (Py_ssize_t) counters.bytes_allocated,
+                              "peak_bytes_in_use", (Py_ssize_t) counters.peak_bytes_in_use,
+                              "last_peak_bytes_in_use", (Py_ssize_t) counters.last_peak_bytes_in_use);
+        if (NULL == entry || PyDict_SetItemString(calls, sigcore::memory_entry_names[e], entry) < 0) {
+            Py_XDECREF(entry);
+            Py_DECREF(calls);
+            return NULL;
+        }
+        Py_DECREF(entry);
+    }
+    ans = Py_BuildValue("{s:n,s:n,s:n,s:n,s:n,s:O}",
+                        "allocations", (Py_ssize_t) stats.allocations,
+                        "bytes_allocated", (Py_ssize_t) stats.bytes_allocated,
+                        "bytes_in_use", (Py_ssize_t) stats.bytes_in_use,
+                        "peak_bytes_in_use", (Py_ssize_t) stats.peak_bytes_in_use,
+                        "peak_rss_bytes", (Py_ssize_t) sigcore::peak_rss_bytes(),
+                        "calls", calls);
+    Py_DECREF(calls);
+    return ans;
+}
+
+static PyObject* resetmemorystats(PyObject* self, PyObject* args)
+{
+    sigcore::reset_memory_stats();
+    Py_RETURN_NONE;
+}
+
+/* ==== Record a timeline of the tasks of the batch computations =============
+    interface:  get_trace()
+                reset_trace()
+                set_tracing(on=True)                                         */
+static PyObject* gettrace(PyObject* self, PyObject* args)
+{
+    const std::string json = sigcore::get_trace_json();
+    return PyUnicode_FromStringAndSize(json.data(), (Py_ssize_t) json.size());
+}
+
+static PyObject* resettrace(PyObject* self, PyObject* args)
+{
+    sigcore::reset_trace();
+    Py_RETURN_NONE;
+}
+
+static PyObject* settracing(PyObject* self, PyObject* args)
+{
+    int on = 1;
+
+    if (!PyArg_ParseTuple(args, "|p", &on))  return NULL;
+    return PyBool_FromLong(sigcore::set_tracing(on != 0));
+}
+
+/* ==== Count the time of each call by entry point and shape ==================
+    interface:  get_latency_histograms()
+                reset_latency_histograms()
+                set_latency_recording(on=True)                               */
+static PyObject* getlatencyhistograms(PyObject* self, PyObject* args)
+{
+    const std::vector<sigcore::latency_histogram> copies = sigcore::get_latency_histograms();
+    PyObject *ans = NULL, *histograms = NULL, *key = NULL, *value = NULL;
+    PyArrayObject *bounds = NULL, *counts = NULL;
+    npy_intp dims[1];
+    size_t h, b;
+
+    dims[0] = (npy_intp) sigcore::latency_buckets + 1;
+    bounds = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    histograms = PyDict_New();
+    if (NULL == bounds || NULL == histograms)
+        goto fail;
+    for (b = 0; b <= sigcore::latency_buckets; ++b)
+        ((double*) PyArray_DATA(bounds))[b] = 1e-9 * (double) sigcore::latency_bucket_lower(b);
+    dims[0] = (npy_intp) sigcore::latency_buckets;
+    for (h = 0; h < copies.size(); ++h) {
+        const sigcore::latency_histogram& copy = copies[h];
+        counts = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_UINT64);
+        if (NULL == counts)
+            goto fail;
+        std::copy(copy.counts.begin(), copy.counts.end(), (npy_uint64*) PyArray_DATA(counts));
+        key = Py_BuildValue("(snn)", sigcore::latency_entry_names[copy.entry],
+                            (Py_ssize_t) copy.width, (Py_ssize_t) copy.depth);
+        value = Py_BuildValue("{s:K,s:d,s:d,s:O}",
+                              "calls", (unsigned long long) copy.calls,
+                              "total_seconds", 1e-9 * (double) copy.total_nanoseconds,
+                              "max_seconds", 1e-9 * (double) copy.max_nanoseconds,
+                              "counts", (PyObject*) counts);
+        Py_CLEAR(counts);
+        if (NULL == key || NULL == value || PyDict_SetItem(histograms, key, value) < 0)
+            goto fail;
+        Py_CLEAR(key);
+        Py_CLEAR(value);
+    }
+    ans = Py_BuildValue("{s:O,s:O}", "bounds", (PyObject*) bounds, "histograms", histograms);
+
+fail:
+    Py_XDECREF(key);
+    Py_XDECREF(value);
+    Py_XDECREF(counts);
+    Py_XDECREF(bounds);
+    Py_XDECREF(histograms);
+    return ans;
+}
+
+static PyObject* resetlatencyhistograms(PyObject* self, PyObject* args)
+{
+    sigcore::reset_latency_histograms();
+    Py_RETURN_NONE;
+}
+
+static PyObject* setlatencyrecording(PyObject* self, PyObject* args)
+{
+    int on = 1;
+
+    if (!PyArg_ParseTuple(args, "|p", &on))  return NULL;
+    return PyBool_FromLong(sigcore::set_latency_recording(on != 0));
+}
+
 /* ==== Determines the size of log signature =========================
     Returns a NEW  NumPy vector array
     interface:  getlogsigsize(width,depth)
@@ -329,7 +1116,373 @@ static PyObject* getsigsize(PyObject* self, PyObject* args)
     return Py_BuildValue("n", ans);
 }
 
+/* ==== Applies a dense tensor function to an array of flattened tensors =========================
+    Returns a NEW NumPy array of the same shape as the input
+    interface:  apply_tensor_fn(fn, args) with args = (tensors, width, depth)
+                tensors is a NumPy array of one or two dimensions whose last axis has length sigdim(width, depth)
+                returns a NumPy array                                       */
+static PyObject* apply_tensor_fn(int (*fn)(PyArrayObject*, PyArrayObject*, size_t, size_t), PyObject* args)
+{
+    PyObject *tensorsin;
+    PyArrayObject *tensors, *arrout;
+    Py_ssize_t width, depth;
+
+    /* Parse tuple */
+    if (!PyArg_ParseTuple(args, "Onn",
+                          &tensorsin, &width, &depth))  return NULL;
+    if (width < 1 || depth < 1) {
+        PyErr_SetString(PyExc_ValueError, "Width and depth must be at least 1");
+        return NULL;
+    }
+
+    /* Make a contiguous double copy of the input if it is not one already */
+    tensors = (PyArrayObject*) PyArray_FROMANY(tensorsin, NPY_DOUBLE, 1, 2, NPY_ARRAY_IN_ARRAY);
+    if (NULL == tensors)  return NULL;
+
+    arrout = (PyArrayObject*) PyArray_SimpleNew(PyArray_NDIM(tensors), PyArray_DIMS(tensors), NPY_DOUBLE);
+    if (NULL == arrout || !fn(tensors, arrout, (size_t)width, (size_t)depth)) {
+        Py_XDECREF(arrout);
+        Py_DECREF(tensors);
+        return NULL;
+    }
+
+    Py_DECREF(tensors);
+    return PyArray_Return(arrout);
+}
+
+static PyObject* tensorexp(PyObject* self, PyObject* args)
+{
+    return apply_tensor_fn(&TensorExp, args);
+}
+
+static PyObject* tensorlog(PyObject* self, PyObject* args)
+{
+    return apply_tensor_fn(&TensorLog, args);
+}
+
+static PyObject* tensorinverse(PyObject* self, PyObject* args)
+{
+    return apply_tensor_fn(&TensorInverse, args);
+}
+
+/* ==== Checks that an accumulator is a writeable contiguous double vector of the given size ==============
+    return 1 if an error and raise exception */
+static int not_valid_accumulator(PyArrayObject* acc, npy_intp size)
+{
+    if (PyArray_TYPE(acc) != NPY_DOUBLE || PyArray_NDIM(acc) != 1 || PyArray_DIM(acc, 0) != size
+        || !PyArray_IS_C_CONTIGUOUS(acc) || !PyArray_ISWRITEABLE(acc)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "Accumulators must be writeable contiguous float64 vectors of length sigdim(width, depth).");
+        return 1;
+    }
+    return 0;
+}
+
+/* ==== Folds the signatures of a batch of streams into running moments =========================
+    Returns the new count, the accumulators are updated in place
+    interface:  accumulatesig(streams, depth, count, mean, m2=None, num_threads=0)
+                streams is a 3 dimensional NumPy array or a sequence of NumPy matrices of equal width
+                mean and m2 are contiguous NumPy vectors of length sigdim(width, depth)
+                returns a Py_ssize_t                                       */
+static PyObject* accumulatesig(PyObject* self, PyObject* args, PyObject* keywds)
+{
+    PyObject *streamsin, *m2in = Py_None, *seq = NULL, *out = NULL;
+    PyArrayObject *mean, *m2 = NULL, *batch = NULL;
+    PyArrayObject **arrays = NULL;
+    const double **streams = NULL;
+    size_t *rows = NULL;
+    Py_ssize_t depth, count, num_threads = 0, no_streams = 0, i;
+    npy_intp width = 0, size;
+    double dcount;
+    int ok;
+
+    static char* kwlist[] = { "streams", "depth", "count", "mean", "m2", "num_threads", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OnnO!|On:accumulatesig", kwlist,
+                                     &streamsin, &depth, &count, &PyArray_Type, &mean, &m2in, &num_threads))
+        return NULL;
+    if (m2in != Py_None) {
+        if (!PyArray_Check(m2in)) {
+            PyErr_SetString(PyExc_TypeError, "m2 must be a numpy array or None");
+            return NULL;
+        }
+        m2 = (PyArrayObject*) m2in;
+    }
+    if (depth < 1) {
+        PyErr_SetString(PyExc_ValueError, "depth must be at least 1");
+        return NULL;
+    }
+
+// GATHER THE STREAMS AS CONTIGUOUS DOUBLE ARRAYS
+    if (PyArray_Check(streamsin) && PyArray_NDIM((PyArrayObject*) streamsin) == 3) {
+        batch = stream_from_any(streamsin, 3, 3, depth);
+        if (NULL == batch)  goto exit;
+        no_streams = PyArray_DIM(batch, 0);
+        width = PyArray_DIM(batch, 2);
+        streams = (const double**) malloc((no_streams + 1) * sizeof(double*));
+        rows = (size_t*) malloc((no_streams + 1) * sizeof(size_t));
+        for (i = 0; i < no_streams; ++i) {
+            streams[i] = (const double*) PyArray_GETPTR3(batch, i, 0, 0);
+            rows[i] = (size_t) PyArray_DIM(batch, 1);
+        }
+    } else {
+        seq = PySequence_Fast(streamsin, "streams must be a 3 dimensional array or a sequence of 2 dimensional arrays");
+        if (NULL == seq)  goto exit;
+        no_streams = PySequence_Fast_GET_SIZE(seq);
+        arrays = (PyArrayObject**) calloc(no_streams + 1, sizeof(PyArrayObject*));
+        streams = (const double**) malloc((no_streams + 1) * sizeof(double*));
+        rows = (size_t*) malloc((no_streams + 1) * sizeof(size_t));
+        for (i = 0; i < no_streams; ++i) {
+            arrays[i] = stream_from_any(PySequence_Fast_GET_ITEM(seq, i), 2, 2, depth);
+            if (NULL == arrays[i])  goto exit;
+            if (i == 0)
+                width = PyArray_DIM(arrays[i], 1);
+            else if (PyArray_DIM(arrays[i], 1) != width) {
+                PyErr_SetString(PyExc_ValueError, "All streams must have the same width");
+                goto exit;
+            }
+            streams[i] = (const double*) PyArray_DATA(arrays[i]);
+            rows[i] = (size_t) PyArray_DIM(arrays[i], 0);
+        }
+    }
+
+// VALIDATE THE ACCUMULATORS, EVEN IF THERE IS NOTHING TO FOLD INTO THEM
+    if (seq != NULL && no_streams == 0) {
+        // an empty sequence has no width, so the accumulators need only agree with each other
+        size = (PyArray_NDIM(mean) == 1) ? PyArray_DIM(mean, 0) : -1;
+    } else {
+        if (width < 1) {
+            PyErr_SetString(PyExc_ValueError, "Width and depth must be at least 1");
+            goto exit;
+        }
+        size = (npy_intp) GetSigSize((size_t)width, (size_t)depth);
+        if (size == 0) {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_ValueError, "width and depth are beyond those this build of esig supports");
+            goto exit;
+        }
+    }
+    if (not_valid_accumulator(mean, size) || (m2 != NULL && not_valid_accumulator(m2, size)))  goto exit;
+    if (no_streams == 0) {
+        out = Py_BuildValue("n", count);
+        goto exit;
+    }
+
+// DO THE CALCULATION WITHOUT THE INTERPRETER LOCK
+    dcount = (double) count;
+    Py_BEGIN_ALLOW_THREADS
+    ok = AccumulateSigMoments(streams, rows, (size_t) no_streams, (size_t) width, (size_t) depth,
+                              (double*) PyArray_DATA(mean), (m2 != NULL) ? (double*) PyArray_DATA(m2) : NULL,
+                              &dcount, (size_t) ((num_threads > 0) ? num_threads : 0));
+    Py_END_ALLOW_THREADS
+    if (ok)
+        out = Py_BuildValue("n", (Py_ssize_t) dcount);
+
+    exit:
+// CLEANUP
+    if (arrays != NULL)
+        for (i = 0; i < no_streams; ++i)
+            Py_XDECREF(arrays[i]);
+    free(arrays);
+    free(streams);
+    free(rows);
+    Py_XDECREF(seq);
+    Py_XDECREF(batch);
+    return out;
+}
+
+/* ==== Signatures of a ragged batch of streams =============================
+    Returns a NEW NumPy matrix
+    interface:  tosigragged(data, offsets, depth, num_threads=0)
+                data is a NumPy matrix holding the streams one after another
+                offsets is a NumPy vector of len(streams) + 1 row indexes
+                depth is a positive integer of Py_ssize_t
+                returns a NumPy matrix with a row per stream              */
+static PyObject* ragged(PyObject* args, PyObject* keywds, int log_signature)
+{
+    PyObject *datain, *offsetsin;
+    PyArrayObject *data = NULL, *offsets = NULL, *out = NULL;
+    size_t *rows = NULL;
+    Py_ssize_t depth, num_threads = 0, no_streams, i;
+    npy_intp width, total, dims[2];
+    const npy_intp *off;
+    int ok;
+
+    static char* kwlist[] = { "data", "offsets", "depth", "num_threads", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOn|n", kwlist,
+                                     &datain, &offsetsin, &depth, &num_threads))
+        return NULL;
+
+    data = stream_from_any(datain, 2, 2, depth);
+    if (NULL == data)  goto exit;
+    offsets = (PyArrayObject*) PyArray_FROMANY(offsetsin, NPY_INTP, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if (NULL == offsets)  goto exit;
+    width = PyArray_DIM(data, 1);
+    total = PyArray_DIM(data, 0);
+    no_streams = PyArray_DIM(offsets, 0) - 1;
+    if (no_streams < 0) {
+        PyErr_SetString(PyExc_ValueError, "offsets must have at least one entry");
+        goto exit;
+    }
+
+// CHECK THE OFFSETS DESCRIBE SEGMENTS OF THE DATA
+    off = (const npy_intp*) PyArray_DATA(offsets);
+    rows = (size_t*) malloc((no_streams + 1) * sizeof(size_t));
+    if (NULL == rows) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    for (i = 0; i <= no_streams; ++i) {
+        if (off[i] < 0 || off[i] > total || (i > 0 && off[i] < off[i - 1])) {
+            PyErr_SetString(PyExc_ValueError, "offsets must be non-decreasing row indexes into data");
+            goto exit;
+        }
+        rows[i] = (size_t) off[i];
+    }
+
+    dims[0] = (npy_intp) no_streams;
+    dims[1] = (npy_intp) (log_signature ? PrepareLogSigProjection((size_t)width, (size_t)depth)
+                                        : GetSigSize((size_t)width, (size_t)depth));
+    if (dims[1] == 0)  goto exit;
+    out = (PyArrayObject*) PyArray_SimpleNew(2, dims, NPY_DOUBLE);
+    if (NULL == out)  goto exit;
+
+// DO THE CALCULATION WITHOUT THE INTERPRETER LOCK
+    Py_BEGIN_ALLOW_THREADS
+    ok = GetSigRagged((const double*) PyArray_DATA(data), rows, (size_t) no_streams, (size_t) width,
+                      (size_t) depth, (double*) PyArray_DATA(out), log_signature,
+                      (size_t) ((num_threads > 0) ? num_threads : 0));
+    Py_END_ALLOW_THREADS
+    if (!ok)
+        Py_CLEAR(out);
+
+    exit:
+    free(rows);
+    Py_XDECREF(data);
+    Py_XDECREF(offsets);
+    return (PyObject*) out;
+}
+
+static PyObject* tosigragged(PyObject* self, PyObject* args, PyObject* keywds)
+{
+    return ragged(args, keywds, 0);
+}
+
+static PyObject* tologsigragged(PyObject* self, PyObject* args, PyObject* keywds)
+{
+    return ragged(args, keywds, 1);
+}
+
+/* ==== Continue a signature with the next piece of a stream =================
+    Updates the signature in place and returns None
+    interface:  extendsig(sig, series1, depth, previous=None)
+                sig is a contiguous NumPy vector of doubles
+                series1 is NumPy matrix
+                depth is a positive integer of Py_ssize_t
+                previous is a NumPy vector or None                          */
+static PyObject* extendsig(PyObject* self, PyObject* args, PyObject* keywds)
+{
+    PyObject *seriesin, *previousin = Py_None, *out = NULL;
+    PyArrayObject *sig, *series = NULL, *previous = NULL;
+    Py_ssize_t depth;
+    npy_intp width, size;
+    int ok;
+
+    static char* kwlist[] = { "sig", "stream", "depth", "previous", NULL };
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!On|O:extendsig", kwlist,
+                                     &PyArray_Type, &sig, &seriesin, &depth, &previousin))
+        return NULL;
+
+    series = stream_from_any(seriesin, 2, 2, depth);
+    if (NULL == series)  goto exit;
+    width = PyArray_DIM(series, 1);
+    if (previousin != Py_None) {
+        previous = (PyArrayObject*) PyArray_FROMANY(previousin, NPY_DOUBLE, 1, 1, NPY_ARRAY_IN_ARRAY);
+        if (NULL == previous)  goto exit;
+        if (PyArray_DIM(previous, 0) != width) {
+            PyErr_SetString(PyExc_ValueError, "previous must have the width of the stream");
+            goto exit;
+        }
+    }
+    size = (npy_intp) GetSigSize((size_t)width, (size_t)depth);
+    if (size == 0)  goto exit;
+    if (not_valid_accumulator(sig, size))  goto exit;
+
+    Py_BEGIN_ALLOW_THREADS
+    ok = ExtendSig((const double*) PyArray_DATA(series), (size_t) PyArray_DIM(series, 0),
+                   (previous != NULL) ? (const double*) PyArray_DATA(previous) : NULL,
+                   (size_t) width, (size_t) depth, (double*) PyArray_DATA(sig));
+    Py_END_ALLOW_THREADS
+    if (ok) {
+        Py_INCREF(Py_None);
+        out = Py_None;
+    }
+
+    exit:
+    Py_XDECREF(series);
+    Py_XDECREF(previous);
+    return out;
+}
+
+/* ==== Convert a signature to a log signature ================================
+    Returns a NEW NumPy vector
+    interface:  sig2logsig(sig, width, depth)
+                sig is a NumPy vector
+                width and depth are positive integers of Py_ssize_t
+                returns a NumPy vector                                       */
+static PyObject* sig2logsig(PyObject* self, PyObject* args)
+{
+    PyObject *sigin;
+    PyArrayObject *sig, *vecout;
+    Py_ssize_t width, depth;
+    npy_intp dims[1];
+    int ok;
+
+    if (!PyArg_ParseTuple(args, "Onn", &sigin, &width, &depth))  return NULL;
+    if (width < 1 || depth < 1) {
+        PyErr_SetString(PyExc_ValueError, "Width and depth must be at least 1");
+        return NULL;
+    }
+    sig = (PyArrayObject*) PyArray_FROMANY(sigin, NPY_DOUBLE, 1, 1, NPY_ARRAY_IN_ARRAY);
+    if (NULL == sig)  return NULL;
+    if (PyArray_DIM(sig, 0) != (npy_intp) GetSigSize((size_t)width, (size_t)depth)) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "The signature must have length sigdim(width, depth)");
+        Py_DECREF(sig);
+        return NULL;
+    }
+    dims[0] = (npy_intp) GetLogSigSize((size_t)width, (size_t)depth);
+    vecout = (PyArrayObject*) PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (NULL == vecout) {
+        Py_DECREF(sig);
+        return NULL;
+    }
+    ok = GetLogSigFromSig(sig, vecout, (size_t)width, (size_t)depth);
+    Py_DECREF(sig);
+    if (!ok) {
+        Py_DECREF(vecout);
+        return NULL;
+    }
+    return PyArray_Return(vecout);
+}
+
 #ifndef ESIG_NO_RECOMBINE
+/* ==== Buffers counted by the memory accounting of sigcore =================
+    counted_malloc returns NULL when out of memory, counted_free is given
+    the size asked of counted_malloc and the hooks it used                   */
+static void* counted_malloc(size_t bytes, const sigcore::allocator_hooks& hooks)
+{
+    try {
+        return sigcore::counted_allocate(bytes, hooks);
+    } catch (std::bad_alloc&) {
+        return NULL;
+    }
+}
+
+static void counted_free(void* p, size_t bytes, const sigcore::allocator_hooks& hooks)
+{
+    sigcore::counted_deallocate(p, bytes, hooks);
+}
+
 /* ==== Reduces the support of a probability measure on vectors to the minimal support size with the same
  * expectation/ moments <= degree=========================
 	Returns two the new probability measure via two NEW scalar NumPy arrays of same length indices (Py_ssize_t) and weights (double)
@@ -342,6 +1495,12 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
 {
 // INTERNAL
     //
+    // the buffers are counted with the signature computations, see get_memory_stats
+    sigcore::memory_call_scope memory_scope(sigcore::memory_recombine);
+    sigcore::scoped_latency_timer latency(sigcore::latency_recombine);
+    const sigcore::allocator_hooks hooks = sigcore::get_allocator_hooks();
+    // the numpy arrays made by the call, counted by their size
+    sigcore::external_bytes arrays;
     int src_locations_built_internally = 0;
     int src_weights_built_internally = 0;
     // match the mean - or higher moments
@@ -394,6 +1553,8 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
         npy_intp* d = PyArray_DIMS(data);
         //d[0] = PyArray_DIM(data, 0);
         src_locations = (PyArrayObject*)PyArray_SimpleNew(1, d, NPY_INTP);
+        if (src_locations != NULL)
+            arrays.add((size_t) PyArray_NBYTES(src_locations));
         size_t* LOCS = reinterpret_cast<size_t*>(PyArray_DATA(src_locations));
         ptrdiff_t id;
         for (id = 0; id < d[0]; ++id)
@@ -405,6 +1566,8 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
         npy_intp d[1];
         d[0] = PyArray_DIM(src_locations, 0);
         src_weights = (PyArrayObject*)PyArray_SimpleNew(1, d, NPY_DOUBLE);
+        if (src_weights != NULL)
+            arrays.add((size_t) PyArray_NBYTES(src_weights));
         double* WTS = reinterpret_cast<double*>(PyArray_DATA(src_weights));
         ptrdiff_t id;
         for (id = 0; id < d[0]; ++id)
@@ -432,7 +1595,7 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
 
 // map locations from integer indexes to pointers to double
     no_locations = PyArray_DIM(src_locations, 0);
-    double** LOCATIONS2 = (double**)malloc(no_locations * sizeof(double*));
+    double** LOCATIONS2 = (double**)counted_malloc(no_locations * sizeof(double*), hooks);
     ptrdiff_t id;
     for (id = 0; id < no_locations; ++id)
     {
@@ -463,20 +1626,23 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
     // a variable that will eventually be amended to to indicate the actual number of points returned
     noKeptLocations = NoDimensionsToCubature;
     // a buffer of size iNoDimensionsToCubature big enough to store array of indexes to the kept points
-    KeptLocations = (size_t*)malloc(noKeptLocations * sizeof(size_t));
+    KeptLocations = (size_t*)counted_malloc(noKeptLocations * sizeof(size_t), hooks);
     // a buffer of size NoDimensionsToCubature to store the weights of the kept points
-    NewWeights = (double*)malloc(noKeptLocations * sizeof(double));
+    NewWeights = (double*)counted_malloc(noKeptLocations * sizeof(double), hooks);
 
-    _recombineC(
-            stCubatureDegree
-            , point_dimension
-            , no_locations
-            , &noKeptLocations
-            , (const void**) LOCATIONS2
-            , WEIGHTS
-            , KeptLocations
-            , NewWeights
-    );
+    {
+        sigcore::scoped_trace_event trace("recombine", (long long) no_locations);
+        _recombineC(
+                stCubatureDegree
+                , point_dimension
+                , no_locations
+                , &noKeptLocations
+                , (const void**) LOCATIONS2
+                , WEIGHTS
+                , KeptLocations
+                , NewWeights
+        );
+    }
     // un-normalise the weights
     for (id = 0; id < noKeptLocations; ++id)
         NewWeights[id] *= total_mass;
@@ -487,19 +1653,21 @@ pyrecombine(PyObject* self, PyObject* args, PyObject* keywds)
 
     snk_locations = (PyArrayObject *) PyArray_SimpleNew(1, d, NPY_INTP);
     snk_weights = (PyArrayObject *) PyArray_SimpleNew(1, d, NPY_DOUBLE);
+    arrays.add((size_t) noKeptLocations * (sizeof(size_t) + sizeof(double)));
     // MOVE OUTPUT FROM BUFFERS TO THESE OBJECTS
     memcpy(PyArray_DATA(snk_locations), KeptLocations, noKeptLocations * sizeof(size_t));
     memcpy(PyArray_DATA(snk_weights), NewWeights, noKeptLocations * sizeof(double));
     // RELEASE BUFFERS
-    free(KeptLocations);
-    free(NewWeights);
+    counted_free(KeptLocations, NoDimensionsToCubature * sizeof(size_t), hooks);
+    counted_free(NewWeights, NoDimensionsToCubature * sizeof(double), hooks);
     // CREATE OUTPUT
     out = PyTuple_Pack(2, snk_locations, snk_weights);
+    latency.shape((size_t) point_dimension, stCubatureDegree);
 
 
     exit:
 // CLEANUP
-    free(LOCATIONS2);
+    counted_free(LOCATIONS2, no_locations * sizeof(double*), hooks);
     Py_DECREF(data);
     Py_DECREF(src_locations);
     Py_DECREF(src_weights);
@@ -37,6 +37,8 @@ class InstallationConfiguration(object):
             raise Exception(reported_platform + " not a recognised platform.")
 
         self.no_recombine = "ESIG_WITH_RECOMBINE" not in os.environ
+        # replace operator new with a counting one, for tosig.get_memory_stats() to see the whole heap
+        self.count_heap = "ESIG_COUNT_HEAP" in os.environ
 
         self.platform = platform_map[reported_platform]
         self.is64bit = sys.maxsize > 2**32
@@ -129,6 +131,8 @@ class InstallationConfiguration(object):
         args = []
         if self.no_recombine:
             args.append(("ESIG_NO_RECOMBINE", None))
+        if self.count_heap:
+            args.append(("ESIG_COUNT_HEAP", None))
         return args
 
 	# Python extension code built with distutils is compiled with the same set of compiler options,
@@ -154,6 +158,7 @@ class InstallationConfiguration(object):
             # Clang will reject this when compiling C
             if self.platform == PLATFORM.LINUX:
                 args.append('-std=c++11') # want c99 as well, but not possible (see above)
+                args.append('-pthread') # std::thread in the batch signature code
                 args.extend(["-s", "-g0",
                              "--param=ggc-min-expand=20",
                              "--param=ggc-min-heapsize=8192"
@@ -172,6 +177,8 @@ class InstallationConfiguration(object):
         # How can we statically link for MACOS/LINUX? -static does not work on Linux.
         if self.platform == PLATFORM.MACOS:
             args.append('-static')
+        elif self.platform == PLATFORM.LINUX:
+            args.append('-pthread')
 
         return args
 
@@ -217,7 +224,7 @@ class InstallationConfiguration(object):
         elif self.platform == PLATFORM.MACOS:
             return ["boost_system-mt", "boost_thread-mt"]
         elif self.platform == PLATFORM.LINUX:
-            libs = ["boost_system", "boost_thread"]
+            libs = ["boost_system", "boost_thread", "dl"] # dl loads the shape kernels
             if not self.no_recombine:
                 libs.append("recombine")
             return libs
@@ -26,6 +26,23 @@ class SwitchGenerator:
         )
 
 
+    @property
+    def width_ranges(self):
+        """
+        The ranges of widths compiled into shared objects of their own,
+        those of _default_spec cut down to the widths in spec, and a range
+        for each width of spec outside them
+        """
+        ranges = []
+        covered = set()
+        for (mina, maxa) in sorted(self._default_spec):
+            widths = [w for w in range(mina, maxa+1) if w in self.spec]
+            if widths:
+                ranges.append((min(widths), max(widths)))
+                covered.update(widths)
+        ranges.extend((w, w) for w in self.spec if w not in covered)
+        return sorted(ranges)
+
     def __init__(self, spec=None, types=None, path=None):
         self.spec = spec or self.default_spec
         self.types = types or ["DPReal", "SPReal"]
@@ -34,14 +51,37 @@ class SwitchGenerator:
         self.path = path or self._path
 
 
-    def _write_file(self):
+    def _write_file(self, widths=None):
         self.enter_switch("width")
         for k, v in self.spec.items():
+            if widths is not None and k not in widths:
+                continue
             self.write_case(k)
             self.write_depth_switch(k, v)
         self.write_width_default()
         self.exit_switch()
 
+    def _write_shape_switch(self):
+        self.writeln("// generated by tools/switch_generator.py: the switch of switch.h cut down to")
+        self.writeln("// the widths ESIG_MIN_WIDTH to ESIG_MAX_WIDTH of one shared object")
+        directive = "#if"
+        for (mina, maxa) in self.width_ranges:
+            self._file.write("{} ESIG_MIN_WIDTH == {} && ESIG_MAX_WIDTH == {}{}".format(
+                directive, mina, maxa, self.endln))
+            self._write_file(range(mina, maxa+1))
+            directive = "#elif"
+        self._file.write("#else" + self.endln)
+        self._file.write("#error ESIG_MIN_WIDTH and ESIG_MAX_WIDTH are not a range of switch_generator.py"
+                         + self.endln)
+        self._file.write("#endif" + self.endln)
+
+    def _write_shape_ranges(self):
+        self.writeln("// generated by tools/switch_generator.py: the ranges of widths compiled")
+        self.writeln("// into shared objects of their own, as { min_width, max_width, max_depth },")
+        for (mina, maxa) in self.width_ranges:
+            max_depth = max(self.spec[w] for w in range(mina, maxa+1) if w in self.spec)
+            self.writeln("{{ {}, {}, {} }},".format(mina, maxa, max_depth))
+
     def write_depth_switch(self, w, max_depth):
         self.enter_switch("depth")
         for d in range(2, max_depth+1):
@@ -65,6 +105,12 @@ class SwitchGenerator:
         with open(path, "wt", encoding="UTF-8") as f:
             self._file = f
             self._write_file()
+        with open(os.path.join(self.path, "shape_switch.h"), "wt", encoding="UTF-8") as f:
+            self._file = f
+            self._write_shape_switch()
+        with open(os.path.join(self.path, "shape_ranges.h"), "wt", encoding="UTF-8") as f:
+            self._file = f
+            self._write_shape_ranges()
         self._file = None
         # self.write_config_bounds_header()
 
@@ -219,3 +265,6 @@ if __name__ == "__main__":
     import sys
     g = SwitchGenerator(path=sys.argv[1])
     g.write_file()
+    if "--ranges" in sys.argv[2:]:
+        # a CMake list naming the shared objects, e.g. 2_2;5_6
+        print(";".join("{}_{}".format(mina, maxa) for (mina, maxa) in g.width_ranges), end="")